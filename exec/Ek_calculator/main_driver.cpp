@@ -100,9 +100,8 @@ void main_driver(const char* argv)
 
     // reset and compute structure factor
     turbStructFact.FortStructure(vel,geom,1);
-    turbStructFact.CallFinalize(geom);
 
-    // integrate cov_mag over shells in k and write to file
+    // integrate the spectrum over shells in k and write to file
     turbStructFact.IntegratekShells(0,geom);
 
     // Call the timer again and compute the maximum difference between the start time
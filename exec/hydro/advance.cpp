@@ -134,7 +134,7 @@ void advance(std::array< MultiFab, AMREX_SPACEDIM >& umac,
   Real gmres_abs_tol_in = gmres_abs_tol; // save this
 
   // call GMRES to compute predictor
-  GMRES gmres(ba,dmap,geom);
+  GMRES& gmres = PersistentGMRES(ba,dmap,geom);
   gmres.Solve(gmres_rhs_u,gmres_rhs_p,umacNew,pres,
               alpha_fc,beta,beta_ed,gamma,
               theta_alpha,geom,norm_pre_rhs);
@@ -584,6 +584,20 @@ void main_driver(const char* argv)
 
         time = time + dt;
 
+        // time series of the instantaneous energy spectrum
+        if (turbForcing == 1 && struct_fact_shell_int > 0 && step%struct_fact_shell_int == 0) {
+
+            // copy velocities into structFactMF
+            for(int d=0; d<AMREX_SPACEDIM; d++) {
+                ShiftFaceToCC(umac[d], 0, structFactMF, d, 1);
+            }
+            // reset and compute structure factor
+            turbStructFact.FortStructure(structFactMF,geom,1);
+
+            // append the spectrum integrated over shells in k
+            turbStructFact.AppendkShells(step,time,geom,"turbSpectrum.txt");
+        }
+
         if (plot_int > 0 && step%plot_int == 0) {
             // write out umac, pres, and divergence to a plotfile
             WritePlotFile(step,time,geom,umac,pres);
@@ -605,9 +619,8 @@ void main_driver(const char* argv)
                 }
                 // reset and compute structure factor
                 turbStructFact.FortStructure(structFactMF,geom,1);
-                turbStructFact.CallFinalize(geom);
 
-                // integrate cov_mag over shells in k and write to file
+                // integrate the spectrum over shells in k and write to file
                 turbStructFact.IntegratekShells(step,geom);
             }
         }
@@ -781,6 +781,11 @@ void main_driver(const char* argv)
         max_range = max_es_range;
     }
 
+    // the real space part of P3M with Ewald splitting (es_tog=4) is summed over the neighbor list
+    if (es_tog==4 && ewald_rcut > max_range) {
+        max_range = ewald_rcut;
+    }
+
     int cRange = (int)ceil(max_range/dxc[0]);
 
     FhdParticleContainer particles(geomC, geom, dmap, bc, ba, cRange, ang);
@@ -798,6 +803,16 @@ void main_driver(const char* argv)
         ReadCheckPointParticles(particles, ionParticle, dxp);
     }
 
+    // wall mobility of the selected wall_mob model, tabulated per species for the dry move
+    particles.BuildWallMobTable(ionParticle);
+
+    // Ewald splitting parameter and assignment kernels for the mesh part of es_tog=4
+    EwaldInfluence ewald;
+    if (es_tog==4) {
+        ewald.alpha = particles.ewald_alpha;
+        particles.ESKernels(ewald.spread_kernel, ewald.interp_kernel, ewald.support);
+    }
+
     //Find coordinates of cell faces (fluid grid). May be used for interpolating fields to particle locations
     FindFaceCoords(RealFaceCoords, geom); //May not be necessary to pass Geometry?
     
@@ -1345,24 +1360,25 @@ void main_driver(const char* argv)
        // particles.forceFunction(dt);
 
         // sr_tog is short range forces
-        // es_tog is electrostatic solve (0=off, 1=Poisson, 2=Pairwise, 3=P3M)
+        // es_tog is electrostatic solve (0=off, 1=Poisson, 2=Pairwise, 3=P3M, 4=P3M with Ewald splitting)
 	
 
-        if (sr_tog != 0 || es_tog==3) {
+        if (sr_tog != 0 || es_tog==3 || es_tog==4) {
 
             // compute short range forces (if sr_tog=1)
             // compute P3M short range correction (if es_tog=3)
+            // compute Ewald real space forces (if es_tog=4)
             particles.computeForcesNLGPU(charge, RealCenteredCoords, dxp);
         }
 
-        if (es_tog==1 || es_tog==3) {
+        if (es_tog==1 || es_tog==3 || es_tog==4) {
             // spreads charge density from ions onto multifab 'charge'.
             particles.collectFieldsGPU(dt, dxp, RealCenteredCoords, geomP, charge, chargeTemp, massFrac, massFracTemp);
         }
         
         // do Poisson solve using 'charge' for RHS, and put potential in 'potential'.
         // Then calculate gradient and put in 'efieldCC', then add 'external'.
-        esSolve(potential, charge, efieldCC, external, geomP);
+        esSolve(potential, charge, efieldCC, external, geomP, es_tog==4 ? &ewald : nullptr);
 
         if (es_tog==2) {
             // compute pairwise Coulomb force (currently hard-coded to work with y-wall).
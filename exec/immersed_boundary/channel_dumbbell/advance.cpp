@@ -374,7 +374,7 @@ void advance(std::array< MultiFab, AMREX_SPACEDIM >& umac,
         MultiFab::Copy(umacNew[i], umac[i], 0, 0, 1, 1);
 
     // call GMRES to compute predictor
-    GMRES gmres(ba, dmap, geom);
+    GMRES& gmres = PersistentGMRES(ba, dmap, geom);
     gmres.Solve(gmres_rhs_u, gmres_rhs_p, umacNew, pres, alpha_fc, beta_wtd,
                 beta_ed_wtd, gamma_wtd, theta_alpha, geom, norm_pre_rhs);
 
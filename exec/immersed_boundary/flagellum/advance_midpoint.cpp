@@ -318,7 +318,7 @@ void advance(std::array< MultiFab, AMREX_SPACEDIM >& umac,
 
     // Call GMRES to compute u^(n+1/2). Lu^(n+1/2) is computed implicitly. Note
     // that we are using the un-weighted coefficients.
-    GMRES gmres(ba, dmap, geom);
+    GMRES& gmres = PersistentGMRES(ba, dmap, geom);
     gmres.Solve(gmres_rhs_u, gmres_rhs_p, umacNew, pres, alpha_fc, beta_old,
                 beta_ed_old, gamma_old, theta_alpha, geom, norm_pre_rhs);
 
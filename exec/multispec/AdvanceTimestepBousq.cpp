@@ -321,7 +321,7 @@ void AdvanceTimestepBousq(std::array< MultiFab, AMREX_SPACEDIM >& umac,
     // gmres_abs_tol = 0.d0 ! It is better to set gmres_abs_tol in namelist to a sensible value
 
     // call gmres to compute delta v and delta pi
-    GMRES gmres(ba,dmap,geom);
+    GMRES& gmres = PersistentGMRES(ba,dmap,geom);
     gmres.Solve(gmres_rhs_v, gmres_rhs_p, dumac, dpi, rhotot_fc_old, eta, eta_ed,
                 kappa, theta_alpha, geom, norm_pre_rhs);
 
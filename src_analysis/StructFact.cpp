@@ -5,6 +5,9 @@
 #include <AMReX_MultiFabUtil.H>
 #include "AMReX_PlotFileUtil.H"
 #include "AMReX_BoxArray.H"
+#include <AMReX_Utility.H>
+
+#include <limits>
 
 #ifdef AMREX_USE_CUDA
 std::string cufftErrorToString (const cufftResult& err)
@@ -25,6 +28,53 @@ std::string cufftErrorToString (const cufftResult& err)
 }
 #endif
 
+#ifndef AMREX_USE_CUDA
+#ifdef AMREX_USE_MPI
+// fftw_mpi_init() only needs to be called once per run
+static bool fftw_mpi_initialized = false;
+
+void InitFFTWMPI ()
+{
+    if (!fftw_mpi_initialized) {
+        fftw_mpi_init();
+        fftw_mpi_initialized = true;
+    }
+}
+#endif
+
+// read FFTW wisdom on the IOProcessor and share it with all ranks
+static void LoadFFTWWisdom (const std::string& filename)
+{
+    if (filename.empty()) return;
+
+    if (ParallelDescriptor::IOProcessor()) {
+        if (fftw_import_wisdom_from_filename(filename.c_str()) == 0) {
+            amrex::Print() << "StructFact: no FFTW wisdom read from " << filename << "\n";
+        }
+    }
+#ifdef AMREX_USE_MPI
+    InitFFTWMPI();
+    fftw_mpi_broadcast_wisdom(ParallelDescriptor::Communicator());
+#endif
+}
+
+// gather FFTW wisdom from all ranks and write it from the IOProcessor
+static void SaveFFTWWisdom (const std::string& filename)
+{
+    if (filename.empty()) return;
+
+#ifdef AMREX_USE_MPI
+    InitFFTWMPI();
+    fftw_mpi_gather_wisdom(ParallelDescriptor::Communicator());
+#endif
+    if (ParallelDescriptor::IOProcessor()) {
+        if (fftw_export_wisdom_to_filename(filename.c_str()) == 0) {
+            amrex::Print() << "StructFact: could not write FFTW wisdom to " << filename << "\n";
+        }
+    }
+}
+#endif
+
 StructFact::StructFact()
 {}
 
@@ -34,9 +84,10 @@ StructFact::StructFact()
 StructFact::StructFact(const BoxArray& ba_in, const DistributionMapping& dmap_in,
 		       const Vector< std::string >& var_names,
 		       const Vector< Real >& var_scaling_in,
-		       const int& verbosity_in) {
+		       const int& verbosity_in,
+		       const int& fft_type_in) {
 
-    this->define(ba_in,dmap_in,var_names,var_scaling_in,verbosity_in);
+    this->define(ba_in,dmap_in,var_names,var_scaling_in,verbosity_in,fft_type_in);
 
 }
 
@@ -48,34 +99,42 @@ StructFact::StructFact(const BoxArray& ba_in, const DistributionMapping& dmap_in
 		       const Vector< Real >& var_scaling_in,
 		       const Vector< int >& s_pairA_in,
 		       const Vector< int >& s_pairB_in,
-		       const int& verbosity_in) {
+		       const int& verbosity_in,
+		       const int& fft_type_in) {
 
-    this->define(ba_in,dmap_in,var_names,var_scaling_in,s_pairA_in,s_pairB_in,verbosity_in);
+    this->define(ba_in,dmap_in,var_names,var_scaling_in,s_pairA_in,s_pairB_in,verbosity_in,fft_type_in);
 
 }
 
 
-// this builds a list of all possible pairs of variables and calls define()
-void StructFact::define(const BoxArray& ba_in, const DistributionMapping& dmap_in,
-                        const Vector< std::string >& var_names,
-                        const Vector< Real >& var_scaling_in,
-                        const int& verbosity_in) {
-
-    NVAR = var_names.size();
-
-    Vector<int> l_s_pairA(NVAR*(NVAR+1)/2);
-    Vector<int> l_s_pairB(NVAR*(NVAR+1)/2);
+// list of all possible pairs of variables
+static void AllPairs (const int& nvar, Vector<int>& l_s_pairA, Vector<int>& l_s_pairB)
+{
+    l_s_pairA.resize(nvar*(nvar+1)/2);
+    l_s_pairB.resize(nvar*(nvar+1)/2);
 
     int counter=0;
-    for (int i=0; i<NVAR; ++i) {
-        for (int j=i; j<NVAR; ++j) {
+    for (int i=0; i<nvar; ++i) {
+        for (int j=i; j<nvar; ++j) {
             l_s_pairA[counter] = j;
             l_s_pairB[counter] = i;
             ++counter;
         }
     }      
+}
+
+// this builds a list of all possible pairs of variables and calls define()
+void StructFact::define(const BoxArray& ba_in, const DistributionMapping& dmap_in,
+                        const Vector< std::string >& var_names,
+                        const Vector< Real >& var_scaling_in,
+                        const int& verbosity_in,
+                        const int& fft_type_in) {
+
+    Vector<int> l_s_pairA;
+    Vector<int> l_s_pairB;
+    AllPairs(var_names.size(), l_s_pairA, l_s_pairB);
 
-    define(ba_in, dmap_in, var_names, var_scaling_in, l_s_pairA, l_s_pairB, verbosity_in);
+    define(ba_in, dmap_in, var_names, var_scaling_in, l_s_pairA, l_s_pairB, verbosity_in, fft_type_in);
 
 }
 
@@ -84,11 +143,79 @@ void StructFact::define(const BoxArray& ba_in, const DistributionMapping& dmap_i
                         const Vector< Real >& var_scaling_in,
                         const Vector< int >& s_pairA_in,
                         const Vector< int >& s_pairB_in,
-                        const int& verbosity_in) {
+                        const int& verbosity_in,
+                        const int& fft_type_in) {
+
+    defineImpl(ba_in, dmap_in, var_names, var_scaling_in, s_pairA_in, s_pairB_in,
+               verbosity_in, fft_type_in, false);
+
+}
+
+// ba_in covers a 3D domain; every xy plane is treated as an independent 2D sample
+// the 2D transforms of all planes are batched together, and with fft_type=1 the planes
+// are split over the ranks in z slabs so each rank transforms its own planes
+void StructFact::defineSlices(const BoxArray& ba_in, const DistributionMapping& dmap_in,
+                              const Vector< std::string >& var_names,
+                              const Vector< Real >& var_scaling_in,
+                              const int& verbosity_in,
+                              const int& fft_type_in) {
+
+    Vector<int> l_s_pairA;
+    Vector<int> l_s_pairB;
+    AllPairs(var_names.size(), l_s_pairA, l_s_pairB);
+
+    defineImpl(ba_in, dmap_in, var_names, var_scaling_in, l_s_pairA, l_s_pairB,
+               verbosity_in, fft_type_in, true);
+
+}
+
+void StructFact::defineImpl(const BoxArray& ba_in, const DistributionMapping& dmap_in,
+                            const Vector< std::string >& var_names,
+                            const Vector< Real >& var_scaling_in,
+                            const Vector< int >& s_pairA_in,
+                            const Vector< int >& s_pairB_in,
+                            const int& verbosity_in,
+                            const int& fft_type_in,
+                            const bool& stack_slices_in) {
 
   BL_PROFILE_VAR("StructFact::define()",StructFactDefine);
 
   verbosity = verbosity_in;
+
+  // fft_type_in = -1 means use struct_fact_fft_type from the inputs file
+  fft_type = (fft_type_in == -1) ? struct_fact_fft_type : fft_type_in;
+
+  if (fft_type != 0 && fft_type != 1) {
+      amrex::Error("StructFact::define() - fft_type must be 0 (single grid) or 1 (distributed)");
+  }
+
+  stack_slices = stack_slices_in;
+
+  if (stack_slices && AMREX_SPACEDIM != 3) {
+      amrex::Error("StructFact::defineSlices() - a stack of 2D slices requires a 3D domain");
+  }
+
+  // a stack of slices is distributed by giving each rank whole planes, which only needs local plans
+  if (fft_type == 1 && !stack_slices) {
+#if defined(AMREX_USE_CUDA) || !defined(AMREX_USE_MPI)
+      Print() << "StructFact::define() - distributed FFT requires an MPI build with FFTW; using single grid FFT\n";
+      fft_type = 0;
+#else
+      // fftw3-mpi distributes the slowest direction, so we need at least a 2D transform
+      Box domain = ba_in.minimalBox();
+      if (AMREX_SPACEDIM == 2 && domain.bigEnd(AMREX_SPACEDIM-1) == domain.smallEnd(AMREX_SPACEDIM-1)) {
+          Print() << "StructFact::define() - distributed FFT not supported for 1D transforms; using single grid FFT\n";
+          fft_type = 0;
+      }
+      else {
+          InitFFTWMPI();
+      }
+#endif
+  }
+
+  if (struct_fact_plan_rigor < 0 || struct_fact_plan_rigor > 2) {
+      amrex::Error("StructFact::define() - struct_fact_plan_rigor must be 0, 1, or 2");
+  }
   
   if (s_pairA_in.size() != s_pairB_in.size())
         amrex::Error("StructFact::define() - Must have an equal number of components");
@@ -195,12 +322,60 @@ void StructFact::define(const BoxArray& ba_in, const DistributionMapping& dmap_i
     if(s_pairA[n]<0 || s_pairA[n]>=NVAR || s_pairB[n]<0 || s_pairB[n]>=NVAR)
        amrex::Error("StructFact::StructFact() - Invalid pair select values: must be between 0 and (num of varibles - 1)");
   }
+
+  // component of each pair in the spectrum, which only holds the NVARU unique variables
+  {
+      Vector<int> ucomp(NVAR,-1);
+      for (int n=0; n<NVARU; ++n) {
+          ucomp[var_u[n]] = n;
+      }
+
+      Vector<int> pairA_host(NCOV);
+      Vector<int> pairB_host(NCOV);
+      for (int n=0; n<NCOV; ++n) {
+          pairA_host[n] = ucomp[s_pairA[n]];
+          pairB_host[n] = ucomp[s_pairB[n]];
+      }
+
+      s_pairA_spec.resize(NCOV);
+      s_pairB_spec.resize(NCOV);
+      Gpu::copy(Gpu::hostToDevice, pairA_host.begin(), pairA_host.end(), s_pairA_spec.begin());
+      Gpu::copy(Gpu::hostToDevice, pairB_host.begin(), pairB_host.end(), s_pairB_spec.begin());
+  }
   //////////////////////////////////////////////////////
 
+  // build the FFT plans and work buffers once for this domain
+  Box domain = ba_in.minimalBox();
+  InitFFT(domain);
+
   // Note that we are defining with NO ghost cells
 
-  cov_real.define(ba_in, dmap_in, NCOV, 0);
-  cov_imag.define(ba_in, dmap_in, NCOV, 0);
+  // the running sums only cover the half spectrum (x index 0..nx/2)
+  // the other half follows from Hermitian symmetry and is only built for output
+  if (fft_type == 1) {
+      // distributed FFT - accumulate directly on the slabs the spectrum is computed on
+      cov_real.define(fft_cache->ba_spec, fft_cache->dmap_spec, NCOV, 0);
+      cov_imag.define(fft_cache->ba_spec, fft_cache->dmap_spec, NCOV, 0);
+  } else {
+      // single grid FFT - keep the distribution of ba_in, restricted to the half spectrum
+      Box half_domain = domain;
+      half_domain.setBig(0, domain.smallEnd(0) + domain.length(0)/2);
+
+      BoxList bl_half;
+      Vector<int> pmap_half;
+      for (int i=0; i<ba_in.size(); ++i) {
+          Box bx = ba_in[i] & half_domain;
+          if (bx.ok()) {
+              bl_half.push_back(bx);
+              pmap_half.push_back(dmap_in[i]);
+          }
+      }
+      BoxArray ba_half(bl_half);
+      DistributionMapping dmap_half(pmap_half);
+
+      cov_real.define(ba_half, dmap_half, NCOV, 0);
+      cov_imag.define(ba_half, dmap_half, NCOV, 0);
+  }
   cov_mag.define( ba_in, dmap_in, NCOV, 0);
   cov_real.setVal(0.0);
   cov_imag.setVal(0.0);
@@ -225,65 +400,62 @@ void StructFact::FortStructure(const MultiFab& variables, const Geometry& geom,
 
   BL_PROFILE_VAR("StructFact::FortStructure()",FortStructure);
 
-  const BoxArray& ba = variables.boxArray();
-  const DistributionMapping& dm = variables.DistributionMap();
-  
-  MultiFab variables_dft_real, variables_dft_imag;
-  variables_dft_real.define(ba, dm, NVAR, 0);
-  variables_dft_imag.define(ba, dm, NVAR, 0);
-
-  ComputeFFT(variables, variables_dft_real, variables_dft_imag, geom);
-
-  // temporary storage built on BoxArray and DistributionMapping of "variables"
-  // One case where "variables" and "cov_real/imag/mag" may have different DistributionMappings
-  // is for flattened MFs with one grid newly built flattened MFs may be on a different
-  // processor than the flattened MF used to build cov_real/imag/mag
-  // or in general, problems that are not perfectly load balanced
-  MultiFab cov_temp;
-  cov_temp.define(ba, dm, 1, 0);
-
-  // temporary storage built on BoxArray and DistributionMapping of "cov_real/imag/mag"
-  MultiFab cov_temp2;
-  cov_temp2.define(cov_real.boxArray(), cov_real.DistributionMap(), 1, 0);
-  
-  int index = 0;
-  for (int n=0; n<NCOV; n++) {
-    int i = s_pairA[n];
-    int j = s_pairB[n];
-    
-    // Compute temporary real and imaginary components of covariance
-
-    // Real component of covariance
-    cov_temp.setVal(0.0);
-    MultiFab::AddProduct(cov_temp,variables_dft_real,i,variables_dft_real,j,0,1,0);
-    MultiFab::AddProduct(cov_temp,variables_dft_imag,i,variables_dft_imag,j,0,1,0);
-
-    // copy into a MF with same ba and dm as cov_real/imag/mag
-    cov_temp2.ParallelCopy(cov_temp,0,0,1);
-        
-    if (reset == 1) {
-        MultiFab::Copy(cov_real,cov_temp2,0,index,1,0);
-    } else {        
-        MultiFab::Add(cov_real,cov_temp2,0,index,1,0);
-    }
-
-    // Imaginary component of covariance
-    cov_temp.setVal(0.0);
-    MultiFab::AddProduct(cov_temp,variables_dft_imag,i,variables_dft_real,j,0,1,0);
-    cov_temp.mult(-1.0,0);
-    MultiFab::AddProduct(cov_temp,variables_dft_real,i,variables_dft_imag,j,0,1,0);
-
-    // copy into a MF with same ba and dm as cov_real/imag/mag
-    cov_temp2.ParallelCopy(cov_temp,0,0,1);
-    
-    if (reset == 1) {
-        MultiFab::Copy(cov_imag,cov_temp2,0,index,1,0);
-    } else {
-        MultiFab::Add(cov_imag,cov_temp2,0,index,1,0);
-    }
+  // half spectrum of the selected variables; real parts in [0,NVARU), imaginary parts in [NVARU,2*NVARU)
+  ComputeSpectrum(variables, geom);
 
-    index++;
+  StructFactFFTCache& fc = *fft_cache;
 
+  // the kernel below needs the spectrum on the BoxArray and DistributionMapping of cov_real/imag
+  // with the distributed FFT they already match; otherwise the spectrum is moved with one ParallelCopy
+  const MultiFab* spectrum_ptr = &fc.variables_dft_fft;
+  if (fc.variables_dft_fft.boxArray() != cov_real.boxArray() ||
+      fc.variables_dft_fft.DistributionMap() != cov_real.DistributionMap()) {
+      if (!fc.spectrum_cov.ok()) {
+          fc.spectrum_cov.define(cov_real.boxArray(), cov_real.DistributionMap(), 2*NVARU, 0);
+      }
+      fc.spectrum_cov.ParallelCopy(fc.variables_dft_fft,0,0,2*NVARU);
+      spectrum_ptr = &fc.spectrum_cov;
+  }
+  const MultiFab& spectrum = *spectrum_ptr;
+
+  int nvaru = NVARU;
+  int ncov = NCOV;
+  int const * const AMREX_RESTRICT pairA = s_pairA_spec.dataPtr();
+  int const * const AMREX_RESTRICT pairB = s_pairB_spec.dataPtr();
+
+  // update the running sums of every pair in a single pass over the spectrum
+  // cov = conj(A)*B, so real = Ar*Br + Ai*Bi and imag = Ar*Bi - Ai*Br
+  for (MFIter mfi(cov_real,TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+
+      const Box& bx = mfi.tilebox();
+
+      const Array4<const Real>& dft = spectrum.const_array(mfi);
+      const Array4<      Real>& cr  = cov_real.array(mfi);
+      const Array4<      Real>& ci  = cov_imag.array(mfi);
+
+      amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+      {
+          for (int n=0; n<ncov; ++n) {
+              int a = pairA[n];
+              int b = pairB[n];
+
+              Real ar = dft(i,j,k,a);
+              Real ai = dft(i,j,k,nvaru+a);
+              Real br = dft(i,j,k,b);
+              Real bi = dft(i,j,k,nvaru+b);
+
+              Real re = ar*br + ai*bi;
+              Real im = ar*bi - ai*br;
+
+              if (reset == 1) {
+                  cr(i,j,k,n) = re;
+                  ci(i,j,k,n) = im;
+              } else {
+                  cr(i,j,k,n) += re;
+                  ci(i,j,k,n) += im;
+              }
+          }
+      });
   }
 
   bool write_data = false;
@@ -315,6 +487,271 @@ void StructFact::Reset() {
     
 }
 
+void StructFactFFTCache::clear() {
+
+    for (int i = 0; i < forward_plan.size(); ++i) {
+#ifdef AMREX_USE_CUDA
+        cufftDestroy(forward_plan[i]);
+#else
+        fftw_destroy_plan(forward_plan[i]);
+#endif
+    }
+    forward_plan.clear();
+    spectral_field.clear();
+
+#ifndef AMREX_USE_CUDA
+    if (dist_plan) {
+        fftw_destroy_plan(dist_plan);
+        dist_plan = nullptr;
+    }
+    if (fft_in) {
+        fftw_free(fft_in);
+        fft_in = nullptr;
+    }
+    if (fft_out) {
+        fftw_free(fft_out);
+        fft_out = nullptr;
+    }
+#endif
+}
+
+// build the FFT plans and work buffers for this domain; called from define()
+// all NVARU selected variables are transformed together by a single batched plan
+void StructFact::InitFFT(const Box& domain) {
+
+    BL_PROFILE_VAR("StructFact::InitFFT()", InitFFT);
+
+    // any previous plans and buffers are destroyed here
+    fft_cache.reset(new StructFactFFTCache);
+    StructFactFFTCache& fc = *fft_cache;
+
+    fc.domain = domain;
+
+    bool is_flattened = (domain.bigEnd(AMREX_SPACEDIM-1) == domain.smallEnd(AMREX_SPACEDIM-1));
+
+    // dimensionality of the transform
+    // for flattened data the last direction only has one cell
+    // a stack of slices is a batch of 2D transforms in the xy plane
+    int fft_dim = (is_flattened || stack_slices) ? AMREX_SPACEDIM-1 : AMREX_SPACEDIM;
+
+    // one plan per local box, unless the fftw3-mpi plan spans all ranks
+    bool local_plans = (fft_type == 0 || stack_slices);
+
+    // the spectrum is only stored for x index 0..nx/2
+    // the other half follows from Hermitian symmetry of the real-to-complex transform
+    Box half_domain = domain;
+    half_domain.setBig(0, domain.smallEnd(0) + domain.length(0)/2);
+
+#ifndef AMREX_USE_CUDA
+    unsigned fftw_flag = FFTW_ESTIMATE;
+    if (struct_fact_plan_rigor == 1) {
+        fftw_flag = FFTW_MEASURE;
+    } else if (struct_fact_plan_rigor == 2) {
+        fftw_flag = FFTW_PATIENT;
+    }
+
+    LoadFFTWWisdom(struct_fact_wisdom_file);
+#endif
+
+    if (fft_type == 1 && stack_slices) {
+
+        // split the planes as evenly as possible over the ranks
+        // ranks beyond the number of planes do not own a box
+        int nz = domain.length(2);
+        int nslab = std::min(ParallelDescriptor::NProcs(), nz);
+
+        BoxList bl_slab;
+        BoxList bl_slab_half;
+        Vector<int> pmap_slab;
+        for (int p=0; p<nslab; ++p) {
+            Box bx = domain;
+            bx.setSmall(2, domain.smallEnd(2) + ( p   *nz)/nslab);
+            bx.setBig  (2, domain.smallEnd(2) + ((p+1)*nz)/nslab - 1);
+            bl_slab.push_back(bx);
+            bl_slab_half.push_back(bx & half_domain);
+            pmap_slab.push_back(p);
+        }
+        fc.ba_fft.define(bl_slab);
+        fc.ba_spec.define(bl_slab_half);
+        fc.dmap_fft.define(pmap_slab);
+
+    } else if (fft_type == 1) {
+
+#if !defined(AMREX_USE_CUDA) && defined(AMREX_USE_MPI)
+        MPI_Comm comm = ParallelDescriptor::Communicator();
+
+        // the slowest direction of the transform is split into slabs
+        int slab_dir = fft_dim-1;
+
+        // FFTW is row-major, so the dimensions are reversed compared to AMReX
+        // n_cplx is the size of the complex output, which is halved in the fastest direction
+        ptrdiff_t n_real[AMREX_SPACEDIM];
+        ptrdiff_t n_cplx[AMREX_SPACEDIM];
+        for (int d=0; d<fft_dim; ++d) {
+            n_real[d] = domain.length(fft_dim-1-d);
+            n_cplx[d] = n_real[d];
+        }
+        n_cplx[fft_dim-1] = n_real[fft_dim-1]/2 + 1;
+
+        ptrdiff_t local_n0, local_0_start;
+        ptrdiff_t alloc_local = fftw_mpi_local_size_many(fft_dim, n_cplx, NVARU, FFTW_MPI_DEFAULT_BLOCK,
+                                                         comm, &local_n0, &local_0_start);
+
+        // every rank needs the full slab decomposition to build the BoxArrays
+        int nprocs = ParallelDescriptor::NProcs();
+        Vector<long> slab_n0(nprocs);
+        Vector<long> slab_start(nprocs);
+        long my_n0    = local_n0;
+        long my_start = local_0_start;
+        MPI_Allgather(&my_n0   , 1, MPI_LONG, slab_n0.dataPtr()   , 1, MPI_LONG, comm);
+        MPI_Allgather(&my_start, 1, MPI_LONG, slab_start.dataPtr(), 1, MPI_LONG, comm);
+
+        // ranks with an empty slab do not own a box
+        BoxList bl_slab;
+        BoxList bl_slab_half;
+        Vector<int> pmap_slab;
+        for (int p=0; p<nprocs; ++p) {
+            if (slab_n0[p] > 0) {
+                Box bx = domain;
+                bx.setSmall(slab_dir, domain.smallEnd(slab_dir) + slab_start[p]);
+                bx.setBig  (slab_dir, domain.smallEnd(slab_dir) + slab_start[p] + slab_n0[p] - 1);
+                bl_slab.push_back(bx);
+                bl_slab_half.push_back(bx & half_domain);
+                pmap_slab.push_back(p);
+            }
+        }
+        fc.ba_fft.define(bl_slab);
+        fc.ba_spec.define(bl_slab_half);
+        fc.dmap_fft.define(pmap_slab);
+
+        // FFTW work arrays; each slab spans the full domain in the other directions
+        // the NVARU variables are interleaved, i.e., variable v of point m is at m*NVARU+v
+        // and the rows of the real input are padded to 2*(nx/2+1)
+        fc.fft_in  = fftw_alloc_real   (std::max(2*alloc_local,ptrdiff_t(1)));
+        fc.fft_out = fftw_alloc_complex(std::max(  alloc_local,ptrdiff_t(1)));
+
+        // the plan is collective, so every rank has to build it, even ranks without a slab
+        fc.dist_plan = fftw_mpi_plan_many_dft_r2c(fft_dim, n_real, NVARU,
+                                                  FFTW_MPI_DEFAULT_BLOCK, FFTW_MPI_DEFAULT_BLOCK,
+                                                  fc.fft_in, fc.fft_out, comm, fftw_flag);
+#endif
+
+    } else {
+
+        // Initialize the boxarray "ba_onegrid" from the single box "domain"
+        fc.ba_fft.define(domain);
+        fc.ba_spec.define(half_domain);
+        fc.dmap_fft.define(fc.ba_fft);
+    }
+
+    // the half spectrum lives on the same ranks as the real-space data
+    fc.dmap_spec = fc.dmap_fft;
+
+    // all selected variables are stored together; the spectrum holds the real
+    // parts in components [0,NVARU) and the imaginary parts in [NVARU,2*NVARU)
+    fc.variables_fft    .define(fc.ba_fft , fc.dmap_fft ,   NVARU, 0);
+    fc.variables_dft_fft.define(fc.ba_spec, fc.dmap_spec, 2*NVARU, 0);
+
+    if (local_plans) {
+
+        for (MFIter mfi(fc.variables_fft); mfi.isValid(); ++mfi) {
+
+            // grab a single box including ghost cell range
+            Box realspace_bx = mfi.fabbox();
+
+            // size of box including ghost cell range
+            IntVect fft_size = realspace_bx.length(); // This will be different for hybrid FFT
+
+            // this is the size of the box, except the 0th component is 'halved plus 1'
+            IntVect spectral_bx_size = fft_size;
+            spectral_bx_size[0] = fft_size[0]/2 + 1;
+
+            // spectral box
+            Box spectral_bx = Box(IntVect(0), spectral_bx_size - IntVect(1));
+
+            fc.spectral_field.emplace_back(new BaseFab<GpuComplex<Real> >(spectral_bx,NVARU,
+                                                                          The_Device_Arena()));
+            fc.spectral_field.back()->setVal<RunOn::Device>(0.0); // touch the memory
+
+            // FFTW and cuFFT are row-major, so the dimensions are reversed compared to AMReX
+            int n[AMREX_SPACEDIM];
+            for (int d=0; d<fft_dim; ++d) {
+                n[d] = fft_size[fft_dim-1-d];
+            }
+
+            // number of transforms and distance between consecutive ones in the real and spectral arrays
+            int nbatch = NVARU;
+            int idist = realspace_bx.numPts();
+            int odist = spectral_bx.numPts();
+
+            if (stack_slices) {
+                // every plane of every variable is a separate transform
+                // planes are contiguous in a fab, and so are the variables
+                int nplanes = fft_size[AMREX_SPACEDIM-1];
+                nbatch *= nplanes;
+                idist  /= nplanes;
+                odist  /= nplanes;
+            }
+
+            FFTplan fplan;
+
+#ifdef AMREX_USE_CUDA
+            cufftResult result = cufftPlanMany(&fplan, fft_dim, n,
+                                               NULL, 1, idist,
+                                               NULL, 1, odist,
+                                               CUFFT_D2Z, nbatch);
+            if (result != CUFFT_SUCCESS) {
+                amrex::AllPrint() << " cufftPlanMany forward failed! Error: "
+                                  << cufftErrorToString(result) << "\n";
+            }
+#else // host
+
+            // planning with FFTW_MEASURE/PATIENT overwrites the arrays,
+            // which is fine since they are filled before every transform
+            fplan = fftw_plan_many_dft_r2c(fft_dim, n, nbatch,
+                                           fc.variables_fft[mfi].dataPtr(),
+                                           NULL, 1, idist,
+                                           reinterpret_cast<FFTcomplex*>
+                                           (fc.spectral_field.back()->dataPtr()),
+                                           NULL, 1, odist,
+                                           fftw_flag);
+#endif
+
+            fc.forward_plan.push_back(fplan);
+        }
+    }
+
+#ifndef AMREX_USE_CUDA
+    SaveFFTWWisdom(struct_fact_wisdom_file);
+#endif
+}
+
+// copy the var_u components of "variables" into fc.variables_fft with a single ParallelCopy
+// if the selected components are not contiguous they are first packed locally
+void StructFact::CopyToFFTLayout(const MultiFab& variables) {
+
+    StructFactFFTCache& fc = *fft_cache;
+
+    if (var_u[NVARU-1] - var_u[0] + 1 == NVARU) {
+        fc.variables_fft.ParallelCopy(variables,var_u[0],0,NVARU);
+        return;
+    }
+
+    if (!fc.variables_packed.ok() ||
+        fc.variables_packed.boxArray() != variables.boxArray() ||
+        fc.variables_packed.DistributionMap() != variables.DistributionMap()) {
+        fc.variables_packed.define(variables.boxArray(), variables.DistributionMap(), NVARU, 0);
+    }
+
+    for (int n=0; n<NVARU; ++n) {
+        MultiFab::Copy(fc.variables_packed,variables,var_u[n],n,1,0);
+    }
+
+    fc.variables_fft.ParallelCopy(fc.variables_packed,0,0,NVARU);
+}
+
+// compute the full (unshifted) DFT of the selected variables on the layout of variables_dft_real/imag
+// the half spectrum is expanded using Hermitian symmetry
 void StructFact::ComputeFFT(const MultiFab& variables,
 			    MultiFab& variables_dft_real, 
 			    MultiFab& variables_dft_imag,
@@ -322,265 +759,257 @@ void StructFact::ComputeFFT(const MultiFab& variables,
 
     BL_PROFILE_VAR("StructFact::ComputeFFT()", ComputeFFT);
 
-#ifdef AMREX_USE_CUDA
-    //Print() << "Using cuFFT\n";
-#else
-    //Print() << "Using FFTW\n";
-#endif
+    ComputeSpectrum(variables, geom);
+
+    const MultiFab& spectrum = fft_cache->variables_dft_fft;
+
+    MultiFab dft_packed(variables_dft_real.boxArray(), variables_dft_real.DistributionMap(), 2*NVARU, 0);
+    ExpandHalfSpectrum(spectrum,    0 ,dft_packed,    0 ,NVARU, 1.0,geom,0,0);
+    ExpandHalfSpectrum(spectrum,NVARU ,dft_packed,NVARU ,NVARU,-1.0,geom,0,0);
+
+    for (int n=0; n<NVARU; ++n) {
+        MultiFab::Copy(variables_dft_real,dft_packed,      n,var_u[n],1,0);
+        MultiFab::Copy(variables_dft_imag,dft_packed,NVARU+n,var_u[n],1,0);
+    }
+}
+
+// compute the half spectrum (x index 0..nx/2) of the selected variables into fft_cache->variables_dft_fft
+void StructFact::ComputeSpectrum(const MultiFab& variables,
+                                 const Geometry& geom) {
+
+    BL_PROFILE_VAR("StructFact::ComputeSpectrum()", ComputeSpectrum);
 
-    bool is_flattened = false;
+    if (fft_cache->domain != geom.Domain()) {
+        amrex::Abort("StructFact::ComputeSpectrum() - geom.Domain() does not match the minimal box of the BoxArray used in define(); the BoxArray must cover the whole domain");
+    }
+
+    if (fft_type == 1 && !stack_slices) {
+        ComputeSpectrumDistributed(variables, geom);
+        return;
+    }
+
+    StructFactFFTCache& fc = *fft_cache;
 
     long npts;
 
-    // Initialize the boxarray "ba_onegrid" from the single box "domain"
-    BoxArray ba_onegrid;
     {
       Box domain = geom.Domain();
-      ba_onegrid.define(domain);
-
-      if (domain.bigEnd(AMREX_SPACEDIM-1) == 0) {
-          is_flattened = true;
-      }
 
 #if (AMREX_SPACEDIM == 2)
       npts = (domain.length(0)*domain.length(1));
 #elif (AMREX_SPACEDIM == 3)
-      npts = (domain.length(0)*domain.length(1)*domain.length(2));
+      // each slice is normalized as a 2D transform of its own
+      npts = (stack_slices) ? (domain.length(0)*domain.length(1))
+                            : (domain.length(0)*domain.length(1)*domain.length(2));
 #endif
 
     }
 
     Real sqrtnpts = std::sqrt(npts);
 
-    DistributionMapping dmap_onegrid(ba_onegrid);
+    int nvaru = NVARU;
 
-    // we will take one FFT at a time and copy the answer into the
-    // corresponding component
-    MultiFab variables_onegrid;
-    MultiFab variables_dft_real_onegrid;
-    MultiFab variables_dft_imag_onegrid;
-    variables_onegrid.define(ba_onegrid, dmap_onegrid, 1, 0);
-    variables_dft_real_onegrid.define(ba_onegrid, dmap_onegrid, 1, 0);
-    variables_dft_imag_onegrid.define(ba_onegrid, dmap_onegrid, 1, 0);
+    // all selected variables are copied and transformed at once
+    CopyToFFTLayout(variables);
 
-//    fftw_mpi_init();
+    ParallelDescriptor::Barrier();
 
+    // ForwardTransform
+    for (MFIter mfi(fc.variables_fft); mfi.isValid(); ++mfi) {
+        int i = mfi.LocalIndex();
 #ifdef AMREX_USE_CUDA
-    using FFTplan = cufftHandle;
-    using FFTcomplex = cuDoubleComplex;
+        cufftSetStream(fc.forward_plan[i], amrex::Gpu::gpuStream());
+        cufftResult result = cufftExecD2Z(fc.forward_plan[i],
+                                          fc.variables_fft[mfi].dataPtr(),
+                                          reinterpret_cast<FFTcomplex*>
+                                              (fc.spectral_field[i]->dataPtr()));
+        if (result != CUFFT_SUCCESS) {
+            amrex::AllPrint() << " forward transform using cufftExec failed! Error: "
+                              << cufftErrorToString(result) << "\n";
+        }
 #else
-    using FFTplan = fftw_plan;
-    using FFTcomplex = fftw_complex;
+        fftw_execute(fc.forward_plan[i]);
 #endif
+    }
 
-    // contain to store FFT - note it is shrunk by "half" in x
-    Vector<std::unique_ptr<BaseFab<GpuComplex<Real> > > > spectral_field;
+    // copy the half spectrum into separate real and imaginary components
+    for (MFIter mfi(fc.variables_dft_fft); mfi.isValid(); ++mfi) {
 
-    Vector<FFTplan> forward_plan;
+        Array4< GpuComplex<Real> > spectral = (*fc.spectral_field[mfi.LocalIndex()]).array();
 
-    // for CUDA builds we only need to build the plan once; track whether we did
-    bool built_plan = false;
-    
-    for (int comp=0; comp<NVAR; comp++) {
+        Array4<Real> const& dft = fc.variables_dft_fft.array(mfi);
 
-        bool comp_fft = false;
-        for (int i=0; i<NVARU; i++) {
-            if (comp == var_u[i]) {
-                comp_fft = true;
-                break;
+        const Box& bx = mfi.validbox();
+        const Dim3 lo = amrex::lbound(bx);
+
+        amrex::ParallelFor(bx, nvaru,
+        [=] AMREX_GPU_DEVICE (int i, int j, int k, int n) noexcept
+        {
+            GpuComplex<Real> s = spectral(i-lo.x,j-lo.y,k-lo.z,n);
+            dft(i,j,k,n      ) = s.real() / sqrtnpts;
+            dft(i,j,k,n+nvaru) = s.imag() / sqrtnpts;
+        });
+    }
+}
+
+// distributed version of ComputeSpectrum
+// instead of copying the variables onto a single grid owned by one rank, the data is
+// copied into the slab decomposition used by fftw3-mpi (slabs in the slowest direction)
+// and transformed in parallel over all ranks
+void StructFact::ComputeSpectrumDistributed(const MultiFab& variables,
+                                            const Geometry& geom) {
+
+#if defined(AMREX_USE_CUDA) || !defined(AMREX_USE_MPI)
+    amrex::Abort("StructFact::ComputeSpectrumDistributed() - requires an MPI build with FFTW");
+#else
+
+    BL_PROFILE_VAR("StructFact::ComputeSpectrumDistributed()", ComputeSpectrumDistributed);
+
+    StructFactFFTCache& fc = *fft_cache;
+
+    long npts = geom.Domain().numPts();
+    Real sqrtnpts = std::sqrt(npts);
+
+    // length of a row of the real input, and of a padded row
+    long nx     = geom.Domain().length(0);
+    long nx_pad = 2*(nx/2+1);
+
+    double*       fft_in  = fc.fft_in;
+    fftw_complex* fft_out = fc.fft_out;
+
+    // all selected variables are copied and transformed at once
+    CopyToFFTLayout(variables);
+
+    // interleave the variables and pad the rows as expected by the batched fftw3-mpi plan
+    for (MFIter mfi(fc.variables_fft); mfi.isValid(); ++mfi) {
+        long nbx = mfi.validbox().numPts();
+        for (int v=0; v<NVARU; ++v) {
+            const Real* var = fc.variables_fft[mfi].dataPtr(v);
+            for (long m=0; m<nbx; ++m) {
+                long row = m / nx;
+                long i   = m - row*nx;
+                fft_in[(row*nx_pad + i)*NVARU + v] = var[m];
             }
         }
+    }
 
-	if (comp_fft == false) continue;
+    // ForwardTransform (collective)
+    fftw_execute(fc.dist_plan);
+
+    // the local output is ordered like the half-spectrum box
+    for (MFIter mfi(fc.variables_dft_fft); mfi.isValid(); ++mfi) {
+        long nbx = mfi.validbox().numPts();
+        for (int v=0; v<NVARU; ++v) {
+            Real* realpart = fc.variables_dft_fft[mfi].dataPtr(v);
+            Real* imagpart = fc.variables_dft_fft[mfi].dataPtr(NVARU+v);
+            for (long m=0; m<nbx; ++m) {
+                realpart[m] = fft_out[m*NVARU+v][0] / sqrtnpts;
+                imagpart[m] = fft_out[m*NVARU+v][1] / sqrtnpts;
+            }
+        }
+    }
 
-        variables_onegrid.ParallelCopy(variables,comp,0,1);
+#endif
+}
 
-        if (!built_plan) {
+// expand ncomp components of a half spectrum (x index 0..nx/2) to the full domain
+// using Hermitian symmetry, F(-k) = conj(F(k)); conj_sign is 1 for real parts and -1 for imaginary parts
+// if shift == 1 the result is shifted by N/2 so the zero mode is at the center of the domain
+// this goes through a single grid, one component at a time, so it should only be used for output
+void StructFact::ExpandHalfSpectrum(const MultiFab& half, const int& comp_in,
+                                    MultiFab& full, const int& comp_out, const int& ncomp,
+                                    const Real& conj_sign, const Geometry& geom,
+                                    const int& shift, const int& zero_avg) {
 
-            for (MFIter mfi(variables_onegrid); mfi.isValid(); ++mfi) {
+  BL_PROFILE_VAR("StructFact::ExpandHalfSpectrum()",ExpandHalfSpectrum);
 
-                // grab a single box including ghost cell range
-                Box realspace_bx = mfi.fabbox();
+  /*
+    Shifting rules:
 
-                // size of box including ghost cell range
-                IntVect fft_size = realspace_bx.length(); // This will be different for hybrid FFT
+    For domains from (0,0,0) to (Nx-1,Ny-1,Nz-1)
 
-                // this is the size of the box, except the 0th component is 'halved plus 1'
-                IntVect spectral_bx_size = fft_size;
-                spectral_bx_size[0] = fft_size[0]/2 + 1;
+    For any cells with i index >= Nx/2, these values are complex conjugates of the corresponding
+    entry where (Nx-i,Ny-j,Nz-k) UNLESS that index is zero, in which case you use 0.
 
-                // spectral box
-                Box spectral_bx = Box(IntVect(0), spectral_bx_size - IntVect(1));
+    e.g. for an 8^3 domain, any cell with i index 
 
-                spectral_field.emplace_back(new BaseFab<GpuComplex<Real> >(spectral_bx,1,
-                                                                       The_Device_Arena()));
-                spectral_field.back()->setVal<RunOn::Device>(0.0); // touch the memory
+    Cell (6,2,3) is complex conjugate of (2,6,5)
 
-                FFTplan fplan;
+    Cell (4,1,0) is complex conjugate of (4,7,0)  (note that the FFT is computed for 0 <= i <= Nx/2)
 
-#ifdef AMREX_USE_CUDA
-                if (is_flattened) {
-#if (AMREX_SPACEDIM == 2)
-                    cufftResult result = cufftPlan1d(&fplan, fft_size[0], CUFFT_D2Z, 1);
-                    if (result != CUFFT_SUCCESS) {
-                        amrex::AllPrint() << " cufftplan1d forward failed! Error: "
-                                          << cufftErrorToString(result) << "\n";
-                    }
-#elif (AMREX_SPACEDIM == 3)
-                    cufftResult result = cufftPlan2d(&fplan, fft_size[1], fft_size[0], CUFFT_D2Z);
-                    if (result != CUFFT_SUCCESS) {
-                        amrex::AllPrint() << " cufftplan2d forward failed! Error: "
-                                          << cufftErrorToString(result) << "\n";
-                    }
-#endif
-                } else {
-#if (AMREX_SPACEDIM == 2)
-                    cufftResult result = cufftPlan2d(&fplan, fft_size[1], fft_size[0], CUFFT_D2Z);
-                    if (result != CUFFT_SUCCESS) {
-                        amrex::AllPrint() << " cufftplan2d forward failed! Error: "
-                                          << cufftErrorToString(result) << "\n";
-                    }
-#elif (AMREX_SPACEDIM == 3)
-                    cufftResult result = cufftPlan3d(&fplan, fft_size[2], fft_size[1], fft_size[0], CUFFT_D2Z);
-                    if (result != CUFFT_SUCCESS) {
-                        amrex::AllPrint() << " cufftplan3d forward failed! Error: "
-                                          << cufftErrorToString(result) << "\n";
-                    }
-#endif
-                }
-#else // host
+    For a stack of slices each z plane is a separate 2D spectrum, so k is neither
+    reflected nor shifted, and the zero mode of every plane is removed
+  */
 
-                if (is_flattened) {
-#if (AMREX_SPACEDIM == 2)
-                    fplan = fftw_plan_dft_r2c_1d(fft_size[0],
-                                                 variables_onegrid[mfi].dataPtr(),
-                                                 reinterpret_cast<FFTcomplex*>
-                                                 (spectral_field.back()->dataPtr()),
-                                                 FFTW_ESTIMATE);
-#elif (AMREX_SPACEDIM == 3)
-                    fplan = fftw_plan_dft_r2c_2d(fft_size[1], fft_size[0],
-                                                 variables_onegrid[mfi].dataPtr(),
-                                                 reinterpret_cast<FFTcomplex*>
-                                                 (spectral_field.back()->dataPtr()),
-                                                 FFTW_ESTIMATE);
-#endif
-                } else {
-#if (AMREX_SPACEDIM == 2)
-                    fplan = fftw_plan_dft_r2c_2d(fft_size[1], fft_size[0],
-                                                 variables_onegrid[mfi].dataPtr(),
-                                                 reinterpret_cast<FFTcomplex*>
-                                                 (spectral_field.back()->dataPtr()),
-                                                 FFTW_ESTIMATE);
-#elif (AMREX_SPACEDIM == 3)
-                    fplan = fftw_plan_dft_r2c_3d(fft_size[2], fft_size[1], fft_size[0],
-                                                 variables_onegrid[mfi].dataPtr(),
-                                                 reinterpret_cast<FFTcomplex*>
-                                                 (spectral_field.back()->dataPtr()),
-                                                 FFTW_ESTIMATE);
-#endif
-                }
-#endif
+  bool slices = stack_slices;
 
-                forward_plan.push_back(fplan);
-            }
+  Box domain = geom.Domain();
 
-	    built_plan = true;
-        
-        }
+  Box half_domain = domain;
+  half_domain.setBig(0, domain.smallEnd(0) + domain.length(0)/2);
 
-        ParallelDescriptor::Barrier();
+  BoxArray ba_onegrid(domain);
+  BoxArray ba_half_onegrid(half_domain);
 
-        // ForwardTransform
-        for (MFIter mfi(variables_onegrid); mfi.isValid(); ++mfi) {
-            int i = mfi.LocalIndex();
-#ifdef AMREX_USE_CUDA
-            cufftSetStream(forward_plan[i], amrex::Gpu::gpuStream());
-            cufftResult result = cufftExecD2Z(forward_plan[i],
-                                              variables_onegrid[mfi].dataPtr(),
-                                              reinterpret_cast<FFTcomplex*>
-                                                  (spectral_field[i]->dataPtr()));
-            if (result != CUFFT_SUCCESS) {
-	      amrex::AllPrint() << " forward transform using cufftExec failed! Error: "
-				<< cufftErrorToString(result) << "\n";
-	    }
-#else
-            fftw_execute(forward_plan[i]);
-#endif
-        }
+  DistributionMapping dmap_onegrid(ba_onegrid);
 
-        // copy data to a full-sized MultiFab
-        // this involves copying the complex conjugate from the half-sized field
-        // into the appropriate place in the full MultiFab
-        for (MFIter mfi(variables_dft_real_onegrid); mfi.isValid(); ++mfi) {
-
-            Array4< GpuComplex<Real> > spectral = (*spectral_field[0]).array();
-
-            Array4<Real> const& realpart = variables_dft_real_onegrid.array(mfi);
-            Array4<Real> const& imagpart = variables_dft_imag_onegrid.array(mfi);
-
-            Box bx = mfi.fabbox();
-
-            amrex::ParallelFor(bx,
-            [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
-            {
-                if (i <= bx.length(0)/2) {
-                    // copy value
-                    realpart(i,j,k) = spectral(i,j,k).real();
-                    imagpart(i,j,k) = spectral(i,j,k).imag();
-                } else {
-                    // copy complex conjugate
-                    int iloc = bx.length(0)-i;
-                    int jloc, kloc;
-                    if (is_flattened) {
-#if (AMREX_SPACEDIM == 2)
-                        jloc = 0;
-#elif (AMREX_SPACEDIM == 3)
-                        jloc = (j == 0) ? 0 : bx.length(1)-j;
-#endif
-                        kloc = 0;
-                    } else {
-                        jloc = (j == 0) ? 0 : bx.length(1)-j;
-#if (AMREX_SPACEDIM == 2)
-                        kloc = 0;
-#elif (AMREX_SPACEDIM == 3)
-                        kloc = (k == 0) ? 0 : bx.length(2)-k;
-#endif
-                    }
+  MultiFab dft_onegrid     (ba_onegrid     , dmap_onegrid, 1, 0);
+  MultiFab dft_onegrid_half(ba_half_onegrid, dmap_onegrid, 1, 0);
 
-                    realpart(i,j,k) =  spectral(iloc,jloc,kloc).real();
-                    imagpart(i,j,k) = -spectral(iloc,jloc,kloc).imag();
-                }
+  for (int d=0; d<ncomp; d++) {
 
-                realpart(i,j,k) /= sqrtnpts;
-                imagpart(i,j,k) /= sqrtnpts;
-            });
-
-            /*
-            amrex::ParallelFor(bx,
-            [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
-            {
-                std::cout << "HACKFFT " << i << " " << j << " " << k << " "
-                          << realpart(i,j,k) << " + " << imagpart(i,j,k) << "i"
-                          << std::endl;
-            });
-            */
-        }
+    dft_onegrid_half.ParallelCopy(half, comp_in+d, 0, 1);
 
-        variables_dft_real.ParallelCopy(variables_dft_real_onegrid,0,comp,1);
-        variables_dft_imag.ParallelCopy(variables_dft_imag_onegrid,0,comp,1);
+    for (MFIter mfi(dft_onegrid); mfi.isValid(); ++mfi) {
 
-    }
+        const Box& bx = mfi.validbox();
 
-    // destroy fft plan
-    for (int i = 0; i < forward_plan.size(); ++i) {
-#ifdef AMREX_USE_CUDA
-        cufftDestroy(forward_plan[i]);
-#else
-        fftw_destroy_plan(forward_plan[i]);
-#endif
+        const Array4<Real>& dft      = dft_onegrid.array(mfi);
+        const Array4<Real>& dft_half = dft_onegrid_half.array(mfi);
+
+        const Dim3 lo = amrex::lbound(bx);
+        const Dim3 len = amrex::length(bx);
+
+        int nxh = (len.x+1)/2;
+        int nyh = (len.y+1)/2;
+        int nzh = (len.z+1)/2;
+
+        amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        {
+            int ii = i-lo.x;
+            int jj = j-lo.y;
+            int kk = k-lo.z;
+
+            Real val;
+            if (ii <= len.x/2) {
+                val = dft_half(i,j,k);
+            } else {
+                // complex conjugate of (Nx-i,Ny-j,Nz-k)
+                int iloc = len.x-ii;
+                int jloc = (len.y-jj)%len.y;
+                int kloc = (slices) ? kk : (len.z-kk)%len.z;
+                val = conj_sign*dft_half(lo.x+iloc,lo.y+jloc,lo.z+kloc);
+            }
+
+            if (zero_avg == 1 && ii == 0 && jj == 0 && (kk == 0 || slices)) {
+                val = 0.;
+            }
+
+            if (shift == 1) {
+                // Shift DFT by N/2+1 (pi)
+                ii = (ii+nxh)%len.x;
+                jj = (jj+nyh)%len.y;
+                if (!slices) {
+                    kk = (kk+nzh)%len.z;
+                }
+            }
+
+            dft(lo.x+ii,lo.y+jj,lo.z+kk) = val;
+        });
     }
 
-//    fftw_mpi_cleanup();
+    full.ParallelCopy(dft_onegrid, 0, comp_out+d, 1);
+  }
 
 }
 
@@ -594,14 +1023,12 @@ void StructFact::WritePlotFile(const int step, const Real time, const Geometry&
   Vector<std::string> varNames;
   int nPlot = 1;
 
-  // Build temp real & imag components
+  // Build temp real & imag components on the full (not half) spectrum
   const BoxArray& ba = cov_mag.boxArray();
   const DistributionMapping& dm = cov_mag.DistributionMap();
 
   MultiFab cov_real_temp(ba, dm, NCOV, 0);
   MultiFab cov_imag_temp(ba, dm, NCOV, 0);
-  MultiFab::Copy(cov_real_temp, cov_real, 0, 0, NCOV, 0);
-  MultiFab::Copy(cov_imag_temp, cov_imag, 0, 0, NCOV, 0);
 
   // Finalize covariances - scale & compute magnitude
   Finalize(cov_real_temp, cov_imag_temp, geom, zero_avg);
@@ -677,6 +1104,8 @@ void StructFact::WritePlotFile(const int step, const Real time, const Geometry&
   WriteSingleLevelPlotfile(plotfilename2,plotfile,varNames,geom2,time,step);
 }
 
+// cov_real_in and cov_imag_in must be built on the BoxArray and DistributionMapping of cov_mag
+// they are filled with the full, shifted spectrum expanded from the half-spectrum running sums
 void StructFact::Finalize(MultiFab& cov_real_in, MultiFab& cov_imag_in,
                           const Geometry& geom, const int& zero_avg) {
 
@@ -684,8 +1113,8 @@ void StructFact::Finalize(MultiFab& cov_real_in, MultiFab& cov_imag_in,
   
   Real nsamples_inv = 1.0/(Real)nsamples;
   
-  ShiftFFT(cov_real_in,geom,zero_avg);
-  ShiftFFT(cov_imag_in,geom,zero_avg);
+  ExpandHalfSpectrum(cov_real,0,cov_real_in,0,NCOV, 1.0,geom,1,zero_avg);
+  ExpandHalfSpectrum(cov_imag,0,cov_imag_in,0,NCOV,-1.0,geom,1,zero_avg);
 
   cov_real_in.mult(nsamples_inv);
   for (int d=0; d<NCOV; d++) {
@@ -711,234 +1140,194 @@ void StructFact::CallFinalize( const Geometry& geom,
   
   BL_PROFILE_VAR("CallFinalize()",CallFinalize);
 
-  // Build temp real & imag components
+  // Build temp real & imag components on the full (not half) spectrum
   const BoxArray& ba = cov_mag.boxArray();
   const DistributionMapping& dm = cov_mag.DistributionMap();
 
   MultiFab cov_real_temp(ba, dm, NCOV, 0);
   MultiFab cov_imag_temp(ba, dm, NCOV, 0);
-  MultiFab::Copy(cov_real_temp, cov_real, 0, 0, NCOV, 0);
-  MultiFab::Copy(cov_imag_temp, cov_imag, 0, 0, NCOV, 0);
 
   // Finalize covariances - scale & compute magnitude
   Finalize(cov_real_temp, cov_imag_temp, geom, zero_avg);
 }
 
-
-
-void StructFact::ShiftFFT(MultiFab& dft_out, const Geometry& geom, const int& zero_avg) {
-
-  BL_PROFILE_VAR("StructFact::ShiftFFT()",ShiftFFT);
-
-  /*
-    Shifting rules:
-
-    For domains from (0,0,0) to (Nx-1,Ny-1,Nz-1)
-
-    For any cells with i index >= Nx/2, these values are complex conjugates of the corresponding
-    entry where (Nx-i,Ny-j,Nz-k) UNLESS that index is zero, in which case you use 0.
-
-    e.g. for an 8^3 domain, any cell with i index 
-
-    Cell (6,2,3) is complex conjugate of (2,6,5)
-
-    Cell (4,1,0) is complex conjugate of (4,7,0)  (note that the FFT is computed for 0 <= i <= Nx/2)
-  */
-
-  BoxArray ba_onegrid;
-  {
-      Box domain = geom.Domain();
-      
-      // Initialize the boxarray "ba" from the single box "bx"
-      ba_onegrid.define(domain);
-  }
-
-  DistributionMapping dmap_onegrid(ba_onegrid);
-
-  MultiFab dft_onegrid;
-  MultiFab dft_onegrid_temp;
-  dft_onegrid     .define(ba_onegrid, dmap_onegrid, 1, 0);
-  dft_onegrid_temp.define(ba_onegrid, dmap_onegrid, 1, 0);
-
-  for (int d=0; d<NCOV; d++) {
-    dft_onegrid_temp.ParallelCopy(dft_out, d, 0, 1);
-
-    // Shift DFT by N/2+1 (pi)
-    for (MFIter mfi(dft_onegrid); mfi.isValid(); ++mfi) {
-
-        const Box& bx = mfi.tilebox();
-
-        const Array4<Real>& dft = dft_onegrid.array(mfi);
-        const Array4<Real>& dft_temp = dft_onegrid_temp.array(mfi);
-
-        if (zero_avg == 1) {
-#if (AMREX_SPACEDIM == 2)
-            dft_temp(bx.smallEnd(0),bx.smallEnd(1),0) = 0.;
-#elif (AMREX_SPACEDIM == 3)
-            dft_temp(bx.smallEnd(0),bx.smallEnd(1),bx.smallEnd(2)) = 0.;
-#endif
-        }
-
-        int nx = bx.length(0);
-        int nxh = (nx+1)/2;
-        int ny = bx.length(1);
-        int nyh = (ny+1)/2;
-#if (AMREX_SPACEDIM == 3)
-        int nz = bx.length(2);
-        int nzh = (nz+1)/2;
-#endif
-
-        amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
-        {
-            int ip = (i+nxh)%nx;
-            int jp = (j+nyh)%ny;
-            int kp = 0;
-#if (AMREX_SPACEDIM == 3)
-            kp = (k+nzh)%nz;
-#endif
-            dft(ip,jp,kp) = dft_temp(i,j,k);
-        });
+// integrate the magnitude of the first AMREX_SPACEDIM covariances (e.g., the velocity
+// autocorrelations, giving the energy spectrum E(k)) over shells in k
+// the magnitude is taken directly from the half-spectrum running sums; every mode with
+// 0 < kx < nx/2 also stands for its conjugate at -kx, which has the same magnitude
+// wavenumbers are in units of 2*pi/L, where L is the largest domain length, so the shells are
+// spheres in physical k on anisotropic domains; shell b covers [(b-1/2)dk,(b+1/2)dk)
+// only shells fully inside the domain are kept; Ek is a density, so sum(Ek)*dk is the total
+// kshell and Ek are filled on every rank with a single reduction
+void StructFact::ShellSpectrum(const Geometry& geom, Vector<Real>& kshell,
+                               Vector<Real>& Ek, const Real& dk) {
+
+    BL_PROFILE_VAR("StructFact::ShellSpectrum",ShellSpectrum);
+
+    if (stack_slices) {
+        amrex::Abort("StructFact::ShellSpectrum() - not supported for a stack of slices");
+    }
+    if (dk <= 0.) {
+        amrex::Abort("StructFact::ShellSpectrum() - dk must be positive");
     }
 
-    dft_out.ParallelCopy(dft_onegrid, 0, d, 1);
-  }
-
-}
-
-// integrate cov_mag over k shells
-void StructFact::IntegratekShells(const int& step, const Geometry& /*geom*/) {
-
-    BL_PROFILE_VAR("StructFact::IntegratekShells",IntegratekShells);
+    const Box domain = geom.Domain();
+    const Dim3 dlo = amrex::lbound(domain);
+    const Dim3 len = amrex::length(domain);
 
-    GpuArray<int,AMREX_SPACEDIM> center;
+    Real lmax = 0.;
     for (int d=0; d<AMREX_SPACEDIM; ++d) {
-        center[d] = n_cells[d]/2;
+        lmax = std::max(lmax, geom.ProbLength(d));
     }
 
-    int npts = n_cells[0]/2-1;
-    //int npts_sq = npts*npts;
-
-    Gpu::DeviceVector<Real> phisum_vect(npts);
-    Gpu::DeviceVector<int>  phicnt_vect(npts);
+    // spacing of the discrete wavenumbers in each direction, number of modes per unit volume
+    // in k, and the radius of the largest sphere that fits in the domain
+    // directions with a single cell (flattened data) do not contribute
+    GpuArray<Real,3> kscale {1.,1.,1.};
+    Real mode_density = 1.;
+    Real kmax = std::numeric_limits<Real>::max();
+    int ndim = 0;
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        if (domain.length(d) > 1) {
+            kscale[d] = lmax/geom.ProbLength(d);
+            mode_density /= kscale[d];
+            kmax = std::min(kmax, (domain.length(d)/2)*kscale[d]);
+            ++ndim;
+        }
+    }
 
-//    Gpu::DeviceVector<Real> phisum_vect_large(npts_sq);
-//    Gpu::DeviceVector<int>  phicnt_vect_large(npts_sq);
+    const Real dkr = dk;
+    const int nshells = std::max(int(kmax/dkr - 0.5) + 1, 1);
 
-    for (int d=0; d<npts; ++d) {
-        phisum_vect[d] = 0.;
-        phicnt_vect[d] = 0;
+    // scaling of each covariance, as applied in Finalize()
+    const int ncomp = std::min(AMREX_SPACEDIM, NCOV);
+    Vector<Real> fac_host(ncomp);
+    for (int n=0; n<ncomp; ++n) {
+        fac_host[n] = scaling[n]/(Real)nsamples;
     }
+    Gpu::DeviceVector<Real> fac_vect(ncomp);
+    Gpu::copy(Gpu::hostToDevice, fac_host.begin(), fac_host.end(), fac_vect.begin());
+    Real const * const AMREX_RESTRICT fac = fac_vect.dataPtr();
 
-//    for (int d=0; d<npts_sq; ++d) {
-//        phisum_vect_large[d] = 0.;
-//        phicnt_vect_large[d] = 0;
-//    }
-    
-    Real* phisum_gpu = phisum_vect.dataPtr();  // pointer to data
-    int*  phicnt_gpu = phicnt_vect.dataPtr();  // pointer to data
-    
-  //  Real* phisum_large_gpu = phisum_vect_large.dataPtr();  // pointer to data
- //   int*  phicnt_large_gpu = phicnt_vect_large.dataPtr();  // pointer to data
+    // sums in [0,nshells) and mode counts in [nshells,2*nshells), reduced together
+    Gpu::DeviceVector<Real> shell_vect(2*nshells, 0.);
+    Real* shellsum = shell_vect.dataPtr();
+
+    for (MFIter mfi(cov_real,TilingIfNotGPU()); mfi.isValid(); ++mfi) {
 
-    // only consider cells that are within 15k of the center point
-    
-    for ( MFIter mfi(cov_mag,TilingIfNotGPU()); mfi.isValid(); ++mfi ) {
-        
         const Box& bx = mfi.tilebox();
 
-        const Array4<Real> & cov = cov_mag.array(mfi);
+        const Array4<const Real>& cr = cov_real.const_array(mfi);
+        const Array4<const Real>& ci = cov_imag.const_array(mfi);
 
         amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
         {
-            int ilen = amrex::Math::abs(i-center[0]);
-            int jlen = amrex::Math::abs(j-center[1]);
-            int klen = (AMREX_SPACEDIM == 3) ? amrex::Math::abs(k-center[2]) : 0;
-
-            Real dist = (ilen*ilen + jlen*jlen + klen*klen);
- //           int idist = (ilen*ilen + jlen*jlen + klen*klen);
-            dist = std::sqrt(dist);
-            
-            if ( dist <= center[0]-0.5) {
-	        dist = dist+0.5;
-                int cell = int(dist);
-                for (int d=0; d<AMREX_SPACEDIM; ++d) {
-		  amrex::HostDevice::Atomic::Add(&(phisum_gpu[cell]), cov(i,j,k,d));
-//		    phisum_large_gpu[idist]  += cov(i,j,k,d);
+            int ii = i-dlo.x;
+            int jj = j-dlo.y;
+            int kk = k-dlo.z;
+
+            // signed mode numbers; the half spectrum only holds kx >= 0
+            int my = (jj <= len.y/2) ? jj : jj-len.y;
+            int mz = (kk <= len.z/2) ? kk : kk-len.z;
+
+            Real kx = ii*kscale[0];
+            Real ky = my*kscale[1];
+            Real kz = mz*kscale[2];
+
+            int b = int(std::sqrt(kx*kx + ky*ky + kz*kz)/dkr + 0.5);
+
+            if (b < nshells) {
+                Real w = (ii == 0 || 2*ii == len.x) ? 1. : 2.;
+                Real val = 0.;
+                for (int n=0; n<ncomp; ++n) {
+                    Real re = fac[n]*cr(i,j,k,n);
+                    Real im = fac[n]*ci(i,j,k,n);
+                    val += std::sqrt(re*re + im*im);
                 }
-		amrex::HostDevice::Atomic::Add(&(phicnt_gpu[cell]),1);
- //               ++phicnt_large_gpu[idist];
+                amrex::HostDevice::Atomic::Add(&(shellsum[b]), w*val);
+                amrex::HostDevice::Atomic::Add(&(shellsum[nshells+b]), w);
             }
         });
     }
-        
-    for (int d=1; d<npts; ++d) {
-        ParallelDescriptor::ReduceRealSum(phisum_vect[d]);
-        ParallelDescriptor::ReduceIntSum(phicnt_vect[d]);
-    }
-        
-#if 0
-    for (int d=1; d<npts_sq; ++d) {
-        ParallelDescriptor::ReduceRealSum(phisum_vect_large[d]);
-        ParallelDescriptor::ReduceIntSum(phicnt_vect_large[d]);
-    }
 
-    if (ParallelDescriptor::IOProcessor()) {
-        std::ofstream turb_disc;
-        std::string turbNamedisc = "turb_disc";
-        turbNamedisc += std::to_string(step);
-        turbNamedisc += ".txt";
-        
-        turb_disc.open(turbNamedisc);
-        for (int d=1; d<npts_sq; ++d) {
-	    if(phicnt_vect_large[d]>0) {
-		Real dreal = d;
-                turb_disc << sqrt(dreal) << " " << 4.*M_PI*d*phisum_vect_large[d]/phicnt_vect_large[d] << std::endl;
-	    }
+    Vector<Real> shell_host(2*nshells);
+    Gpu::copy(Gpu::deviceToHost, shell_vect.begin(), shell_vect.end(), shell_host.begin());
+    Gpu::streamSynchronize();
+
+    ParallelDescriptor::ReduceRealSum(shell_host.dataPtr(), 2*nshells);
+
+    // shell average times the number of modes per unit k in a shell of the continuum
+    kshell.resize(nshells);
+    Ek.resize(nshells);
+    for (int b=0; b<nshells; ++b) {
+        Real kb = b*dk;
+        Real nmodes;
+        if (ndim == 3) {
+            nmodes = 4.*M_PI*(kb*kb + dk*dk/12.);
+        } else if (ndim == 2) {
+            nmodes = 2.*M_PI*(kb + .5*dk);
+        } else {
+            nmodes = 2.;
         }
-    }
+        nmodes *= mode_density;
 
-    Real dk = 1.;
-    if (ParallelDescriptor::IOProcessor()) {
-        std::ofstream turb_alt;
-        std::string turbNamealt = "turb_alt";
-        turbNamealt += std::to_string(step);
-        turbNamealt += ".txt";
-        
-        turb_alt.open(turbNamealt);
-        for (int d=1; d<npts; ++d) {
-            turb_alt << d << " " << phisum_vect[d] << std::endl;
-        }
+        kshell[b] = kb;
+        Ek[b] = (shell_host[nshells+b] > 0.) ? nmodes*shell_host[b]/shell_host[nshells+b] : 0.;
     }
-#endif
+}
+
+// write the shell spectrum (excluding the k=0 shell) to turbNNNNNNN.txt
+void StructFact::IntegratekShells(const int& step, const Geometry& geom) {
+
+    BL_PROFILE_VAR("StructFact::IntegratekShells",IntegratekShells);
+
+    Vector<Real> kshell, Ek;
+    ShellSpectrum(geom, kshell, Ek, struct_fact_shell_dk);
 
-    Real dk = 1.;
-    
-#if (AMREX_SPACEDIM == 2)
-    for (int d=1; d<npts; ++d) {
-      //  phisum_vect[d] *= 2.*M_PI*d*dk*dk/phicnt_vect[d];
-        phisum_vect[d] *= 2.*M_PI*(d*dk+.5*dk*dk)/phicnt_vect[d];
-    }
-#else
-    for (int d=1; d<npts; ++d) {
-      //  phisum_vect[d] *= 4.*M_PI*(d*d)*dk*dk*dk/phicnt_vect[d];
-      //  phisum_vect[d] *= 4.*M_PI*(d*d*dk+d*dk*dk+dk*dk*dk/3.)/phicnt_vect[d];
-        phisum_vect[d] *= 4.*M_PI*(d*d*dk+dk*dk*dk/12.)/phicnt_vect[d];
-    }
-#endif
     if (ParallelDescriptor::IOProcessor()) {
         std::ofstream turb;
         std::string turbBaseName = "turb";
-        //turbName += std::to_string(step);
         std::string turbName = Concatenate(turbBaseName,step,7);
         turbName += ".txt";
         
         turb.open(turbName);
-        for (int d=1; d<npts; ++d) {
-            turb << d << " " << phisum_vect[d] << std::endl;
+        for (int b=1; b<kshell.size(); ++b) {
+            turb << kshell[b] << " " << Ek[b] << std::endl;
         }
     }
 }
 
+// append "step time E(k_1) ... E(k_n)" to filename, so E(k) can be followed every sample
+// the wavenumbers are written once as a header when the file is created
+// call FortStructure() with reset=1 before this for an instantaneous rather than averaged spectrum
+void StructFact::AppendkShells(const int& step, const Real& time, const Geometry& geom,
+                               const std::string& filename) {
+
+    BL_PROFILE_VAR("StructFact::AppendkShells",AppendkShells);
+
+    Vector<Real> kshell, Ek;
+    ShellSpectrum(geom, kshell, Ek, struct_fact_shell_dk);
+
+    if (ParallelDescriptor::IOProcessor()) {
+        bool new_file = !amrex::FileExists(filename);
+
+        std::ofstream turb(filename, std::ios::app);
+        turb.precision(12);
+        if (new_file) {
+            turb << "# step time";
+            for (int b=1; b<kshell.size(); ++b) {
+                turb << " " << kshell[b];
+            }
+            turb << std::endl;
+        }
+        turb << step << " " << time;
+        for (int b=1; b<kshell.size(); ++b) {
+            turb << " " << Ek[b];
+        }
+        turb << std::endl;
+    }
+}
+
 void StructFact::AddToExternal(MultiFab& x_mag, MultiFab& x_realimag, const Geometry& geom, const int& zero_avg) {
 
     BL_PROFILE_VAR("StructFact::AddToExternal",AddToExternal);
@@ -946,14 +1335,12 @@ void StructFact::AddToExternal(MultiFab& x_mag, MultiFab& x_realimag, const Geom
     MultiFab plotfile;
     int nPlot = 1;
 
-    // Build temp real & imag components
+    // Build temp real & imag components on the full (not half) spectrum
     const BoxArray& ba = cov_mag.boxArray();
     const DistributionMapping& dm = cov_mag.DistributionMap();
 
     MultiFab cov_real_temp(ba, dm, NCOV, 0);
     MultiFab cov_imag_temp(ba, dm, NCOV, 0);
-    MultiFab::Copy(cov_real_temp, cov_real, 0, 0, NCOV, 0);
-    MultiFab::Copy(cov_imag_temp, cov_imag, 0, 0, NCOV, 0);
 
     // Finalize covariances - scale & compute magnitude
     Finalize(cov_real_temp, cov_imag_temp, geom, zero_avg);
@@ -970,3 +1357,35 @@ void StructFact::AddToExternal(MultiFab& x_mag, MultiFab& x_realimag, const Geom
     MultiFab::Add(x_realimag,plotfile,0,0,2*NCOV,0);
 
 }
+
+void StructFact::AverageSlices(MultiFab& x_mag, MultiFab& x_realimag, const Geometry& geom, const int& zero_avg) {
+
+    BL_PROFILE_VAR("StructFact::AverageSlices",AverageSlices);
+
+    if (!stack_slices) {
+        amrex::Abort("StructFact::AverageSlices() - requires a StructFact built with defineSlices()");
+    }
+
+    // Build temp real & imag components on the full (not half) spectrum
+    const BoxArray& ba = cov_mag.boxArray();
+    const DistributionMapping& dm = cov_mag.DistributionMap();
+
+    MultiFab cov_real_temp(ba, dm, NCOV, 0);
+    MultiFab cov_imag_temp(ba, dm, NCOV, 0);
+
+    // Finalize covariances - scale & compute magnitude
+    Finalize(cov_real_temp, cov_imag_temp, geom, zero_avg);
+
+    // magnitude, real and imaginary parts are averaged over z together
+    MultiFab packed(ba, dm, 3*NCOV, 0);
+    MultiFab::Copy(packed,cov_mag      ,0,     0,NCOV,0);
+    MultiFab::Copy(packed,cov_real_temp,0,  NCOV,NCOV,0);
+    MultiFab::Copy(packed,cov_imag_temp,0,2*NCOV,NCOV,0);
+
+    MultiFab packed_flat;
+    ComputeVerticalAverage(packed, packed_flat, geom, 2, 0, 3*NCOV);
+
+    x_mag     .ParallelCopy(packed_flat,   0,0,  NCOV);
+    x_realimag.ParallelCopy(packed_flat,NCOV,0,2*NCOV);
+
+}
@@ -218,7 +218,8 @@ void MultiFabPhysBC(MultiFab& phi, const Geometry& geom, int scomp, int ncomp, i
 // Set the value of normal ghost cells to the inverse reflection of the interior.
 // We fill all the ghost cells - they are needed for Perskin kernels and
 // to avoid intermediate NaN propagation in BDS.
-void MultiFabPhysBCDomainVel(MultiFab& vel, const Geometry& geom, int dim) {
+template <class MF>
+static void PhysBCDomainVel(MF& vel, const Geometry& geom, int dim) {
 
     BL_PROFILE_VAR("MultiFabPhysBCDomainVel()",MultiFabPhysBCDomainVel);
     
@@ -234,7 +235,7 @@ void MultiFabPhysBCDomainVel(MultiFab& vel, const Geometry& geom, int dim) {
 
         Box bx = mfi.growntilebox(ng);
 
-        const Array4<Real>& data = vel.array(mfi);
+        const Array4<typename MF::value_type>& data = vel.array(mfi);
 
         //___________________________________________________________________________
         // Apply x-physbc to data
@@ -343,11 +344,21 @@ void MultiFabPhysBCDomainVel(MultiFab& vel, const Geometry& geom, int dim) {
     } // end MFIter
 }
 
+void MultiFabPhysBCDomainVel(MultiFab& vel, const Geometry& geom, int dim) {
+    PhysBCDomainVel(vel, geom, dim);
+}
+
+// single precision version, used by the StagMGSolver hierarchy built with STAG_MG_PRECISION = FLOAT
+void MultiFabPhysBCDomainVel(FabArray<BaseFab<float> >& vel, const Geometry& geom, int dim) {
+    PhysBCDomainVel(vel, geom, dim);
+}
+
 // Ghost cell filling routine for transverse velocities.
 // Set the value of tranverse ghost cells to +/- the reflection of the interior
 // (+ for slip walls, - for no-slip).
 // We fill all the ghost cells - they are needed for Perskin kernels.
-void MultiFabPhysBCMacVel(MultiFab& vel, const Geometry& geom, int dim, int is_inhomogeneous) {
+template <class MF>
+static void PhysBCMacVel(MF& vel, const Geometry& geom, int dim, int is_inhomogeneous) {
 
     BL_PROFILE_VAR("MultiFabPhysBCMacVel()",MultiFabPhysBCMacVel);
     
@@ -363,7 +374,7 @@ void MultiFabPhysBCMacVel(MultiFab& vel, const Geometry& geom, int dim, int is_i
 
         Box bx = mfi.growntilebox(ng);
 
-        const Array4<Real>& data = vel.array(mfi);
+        const Array4<typename MF::value_type>& data = vel.array(mfi);
 
         //___________________________________________________________________________
         // Apply x-physbc to data
@@ -491,6 +502,14 @@ void MultiFabPhysBCMacVel(MultiFab& vel, const Geometry& geom, int dim, int is_i
     } // end MFIter
 }
 
+void MultiFabPhysBCMacVel(MultiFab& vel, const Geometry& geom, int dim, int is_inhomogeneous) {
+    PhysBCMacVel(vel, geom, dim, is_inhomogeneous);
+}
+
+void MultiFabPhysBCMacVel(FabArray<BaseFab<float> >& vel, const Geometry& geom, int dim, int is_inhomogeneous) {
+    PhysBCMacVel(vel, geom, dim, is_inhomogeneous);
+}
+
 // Boundary filling routine for normal velocity.
 // Set the value of normal velocity on walls to zero.
 // Works for slip and no-slip (bc_vel_lo/hi = 1 or 2).
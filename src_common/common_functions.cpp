@@ -71,6 +71,7 @@ AMREX_GPU_MANAGED amrex::GpuArray<amrex::Real, MAX_SPECIES> common::T_init;
 AMREX_GPU_MANAGED int      common::algorithm_type;
 int                        common::barodiffusion_type;
 int                        common::seed;
+int                        common::rng_field_type;
 AMREX_GPU_MANAGED amrex::Real common::visc_coef;
 AMREX_GPU_MANAGED int      common::visc_type;
 AMREX_GPU_MANAGED int      common::advection_type;
@@ -157,6 +158,11 @@ amrex::Real                   common::tau_la;
 amrex::Real                   common::tau_i;
 
 int                           common::struct_fact_int;
+int                           common::struct_fact_fft_type;
+int                           common::struct_fact_plan_rigor;
+std::string                   common::struct_fact_wisdom_file;
+amrex::Real                   common::struct_fact_shell_dk;
+int                           common::struct_fact_shell_int;
 int                           common::radialdist_int;
 int                           common::cartdist_int;
 int                           common::n_steps_skip;
@@ -208,6 +214,8 @@ int                        common::poisson_bottom_verbose;
 int                        common::poisson_max_iter;
 
 amrex::Real                common::poisson_rel_tol;
+int                        common::poisson_solver_type;
+int                        common::poisson_fft_type;
 AMREX_GPU_MANAGED amrex::Real common::permittivity;
 AMREX_GPU_MANAGED int      common::wall_mob;
 
@@ -219,6 +227,8 @@ int                        common::all_dry;
 
 int                        common::fluid_tog;
 int                        common::es_tog;
+amrex::Real                common::ewald_rcut;
+amrex::Real                common::ewald_tol;
 int                        common::drag_tog;
 int                        common::move_tog;
 int                        common::rfd_tog;
@@ -441,6 +451,12 @@ void InitializeCommonNamespace() {
     // positive = fixed seed
     seed = 0;
 
+    // random fields filled by MultiFabFillRandom
+    // 0 = amrex::ParallelForRNG
+    // 1 = counter-based, decomposition independent
+    // 2 = counter-based, generated inside the stochastic flux kernels
+    rng_field_type = 0;
+
     // Viscous friction L phi operator
     // if abs(visc_type) = 1, L = div beta grad
     // if abs(visc_type) = 2, L = div [ beta (grad + grad^T) ]
@@ -536,6 +552,11 @@ void InitializeCommonNamespace() {
 
     // structure factor and radial/cartesian pair correlation function analysis
     struct_fact_int = 0;
+    struct_fact_fft_type = 0;
+    struct_fact_plan_rigor = 0;
+    struct_fact_wisdom_file = "";
+    struct_fact_shell_dk = 1.;
+    struct_fact_shell_int = 0;
     radialdist_int = 0;
     cartdist_int = 0;
     n_steps_skip = 0;
@@ -574,6 +595,8 @@ void InitializeCommonNamespace() {
     poisson_bottom_verbose = 0;
     poisson_max_iter = 100;
     poisson_rel_tol = 1.e-10;
+    poisson_solver_type = 1;
+    poisson_fft_type = 0;
 
     particle_grid_refine = 1;
     es_grid_refine = 1;
@@ -582,6 +605,8 @@ void InitializeCommonNamespace() {
 
     // fluid_tog (no default)
     // es_tog (no default)
+    ewald_rcut = 0.;
+    ewald_tol = 1.e-5;
     drag_tog = 0;
     // move_tog (no default)
     // rfd_tog (no default)
@@ -761,6 +786,7 @@ void InitializeCommonNamespace() {
     pp.query("algorithm_type",algorithm_type);
     pp.query("barodiffusion_type",barodiffusion_type);
     pp.query("seed",seed);
+    pp.query("rng_field_type",rng_field_type);
     pp.query("visc_coef",visc_coef);
     pp.query("visc_type",visc_type);
     pp.query("advection_type",advection_type);
@@ -987,6 +1013,11 @@ void InitializeCommonNamespace() {
     pp.query("tau_ta",tau_ta);
     pp.query("tau_la",tau_la);
     pp.query("struct_fact_int",struct_fact_int);
+    pp.query("struct_fact_fft_type",struct_fact_fft_type);
+    pp.query("struct_fact_plan_rigor",struct_fact_plan_rigor);
+    pp.query("struct_fact_wisdom_file",struct_fact_wisdom_file);
+    pp.query("struct_fact_shell_dk",struct_fact_shell_dk);
+    pp.query("struct_fact_shell_int",struct_fact_shell_int);
     pp.query("radialdist_int",radialdist_int);
     pp.query("cartdist_int",cartdist_int);
     pp.query("n_steps_skip",n_steps_skip);
@@ -1101,6 +1132,8 @@ void InitializeCommonNamespace() {
     pp.query("poisson_bottom_verbose",poisson_bottom_verbose);
     pp.query("poisson_max_iter",poisson_max_iter);
     pp.query("poisson_rel_tol",poisson_rel_tol);
+    pp.query("poisson_solver_type",poisson_solver_type);
+    pp.query("poisson_fft_type",poisson_fft_type);
     pp.query("permittivity",permittivity);
     pp.query("wall_mob",wall_mob);
     pp.query("particle_grid_refine",particle_grid_refine);
@@ -1109,6 +1142,8 @@ void InitializeCommonNamespace() {
     pp.query("all_dry",all_dry);
     pp.query("fluid_tog",fluid_tog);
     pp.query("es_tog",es_tog);
+    pp.query("ewald_rcut",ewald_rcut);
+    pp.query("ewald_tol",ewald_tol);
     pp.query("drag_tog",drag_tog);
     pp.query("move_tog",move_tog);
     pp.query("rfd_tog",rfd_tog);
@@ -13,7 +13,8 @@ void calculateFlux(const MultiFab& cons_in, const MultiFab& prim_in,
                    MultiFab& rancorn_in,
                    const amrex::Geometry& geom,
 		   const amrex::Vector< amrex::Real >& /*stoch_weights*/,
-                   const amrex::Real dt)
+                   const amrex::Real dt,
+                   const amrex::Vector< StochNoise >& noise)
 {
     BL_PROFILE_VAR("calculateFlux()",calculateFlux);
     
@@ -49,14 +50,20 @@ void calculateFlux(const MultiFab& cons_in, const MultiFab& prim_in,
                          const Array4<Real>& fluxy = flux_in[1].array(mfi); ,
                          const Array4<Real>& fluxz = flux_in[2].array(mfi));
 
-            AMREX_D_TERM(const Array4<Real>& ranfluxx = stochFlux_in[0].array(mfi); ,
-                         const Array4<Real>& ranfluxy = stochFlux_in[1].array(mfi); ,
-                         const Array4<Real>& ranfluxz = stochFlux_in[2].array(mfi));
+            // white noise on faces and corners
+            // read from stochFlux_in/rancorn_in, or generated on the fly if noise is given
+            AMREX_D_TERM(StochNoise ranfluxx = (noise.empty()) ? StochNoise() : noise[0]; ,
+                         StochNoise ranfluxy = (noise.empty()) ? StochNoise() : noise[1]; ,
+                         StochNoise ranfluxz = (noise.empty()) ? StochNoise() : noise[2]);
+            StochNoise rancorn = (noise.empty()) ? StochNoise() : noise[AMREX_SPACEDIM];
+
+            AMREX_D_TERM(ranfluxx.stored = stochFlux_in[0].const_array(mfi); ,
+                         ranfluxy.stored = stochFlux_in[1].const_array(mfi); ,
+                         ranfluxz.stored = stochFlux_in[2].const_array(mfi));
+            rancorn.stored = rancorn_in.const_array(mfi);
 
             const Array4<const Real> prim = prim_in.array(mfi);
             // const Array4<const Real> cons = cons_in.array(mfi);
-
-            const Array4<const Real> rancorn = rancorn_in.array(mfi);
         
             const Array4<const Real> eta   = eta_in.array(mfi);
             const Array4<const Real> zeta  = zeta_in.array(mfi);
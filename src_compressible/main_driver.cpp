@@ -260,10 +260,12 @@ void main_driver(const char* argv)
                  flux[2].define(convert(ba,nodal_flag_z), dmap, nvars+4, 0););
 
     //stochastic fluxes
+    // with in-kernel noise (rng_field_type = 2) these are only placeholders
+    int nstoch = (rng_field_type == 2) ? 1 : nvars;
     std::array< MultiFab, AMREX_SPACEDIM > stochFlux;
-    AMREX_D_TERM(stochFlux[0].define(convert(ba,nodal_flag_x), dmap, nvars, 0);,
-                 stochFlux[1].define(convert(ba,nodal_flag_y), dmap, nvars, 0);,
-                 stochFlux[2].define(convert(ba,nodal_flag_z), dmap, nvars, 0););
+    AMREX_D_TERM(stochFlux[0].define(convert(ba,nodal_flag_x), dmap, nstoch, 0);,
+                 stochFlux[1].define(convert(ba,nodal_flag_y), dmap, nstoch, 0);,
+                 stochFlux[2].define(convert(ba,nodal_flag_z), dmap, nstoch, 0););
 
     AMREX_D_TERM(stochFlux[0].setVal(0.0);,
                  stochFlux[1].setVal(0.0);,
@@ -695,6 +697,19 @@ void main_driver(const char* argv)
             amrex::Print() << "Mean Momentum (x, y, z): " << ComputeSpatialMean(cu, 1) << " " << ComputeSpatialMean(cu, 2) << " " << ComputeSpatialMean(cu, 3) << "\n";
         }
 
+        // time series of the instantaneous energy spectrum
+        if (turbForcing == 1 && struct_fact_shell_int > 0 && step%struct_fact_shell_int == 0) {
+
+            // copy velocities into structFactMF
+            MultiFab::Copy(structFactMF, prim, 1, 0, AMREX_SPACEDIM, 0);
+
+            // reset and compute structure factor
+            turbStructFact.FortStructure(structFactMF,geom,1);
+
+            // append the spectrum integrated over shells in k
+            turbStructFact.AppendkShells(step,time,geom,"turbSpectrum.txt");
+        }
+
         // write a plotfile
         if (plot_int > 0 && step%plot_int == 0) {
 
@@ -732,9 +747,8 @@ void main_driver(const char* argv)
                 
                // reset and compute structure factor
                turbStructFact.FortStructure(structFactMF,geom,1);
-               turbStructFact.CallFinalize(geom);
 
-               // integrate cov_mag over shells in k and write to file
+               // integrate the spectrum over shells in k and write to file
                turbStructFact.IntegratekShells(step,geom);
 
                // timer
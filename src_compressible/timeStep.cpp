@@ -6,7 +6,43 @@
 
 #include "rng_functions.H"
 
+// combine the white noise fields A and B with the weights of this RK stage
+// for in-kernel noise only the weights are set; calculateFlux generates the combination
+static void WeightStochNoise(std::array<MultiFab, AMREX_SPACEDIM>& stochFlux,
+                             MultiFab& rancorn,
+                             const std::array<MultiFab, AMREX_SPACEDIM>& stochFlux_A,
+                             const std::array<MultiFab, AMREX_SPACEDIM>& stochFlux_B,
+                             const MultiFab& rancorn_A,
+                             const MultiFab& rancorn_B,
+                             Vector< StochNoise >& noise,
+                             const Vector< Real >& stoch_weights)
+{
+    if (!noise.empty()) {
+        for (auto& n : noise) {
+            n.w_A = stoch_weights[0];
+            n.w_B = stoch_weights[1];
+        }
+        return;
+    }
 
+    AMREX_D_TERM(stochFlux[0].setVal(0.0);,
+                 stochFlux[1].setVal(0.0);,
+                 stochFlux[2].setVal(0.0););
+    rancorn.setVal(0.0);
+
+    // apply weights (only momentum and energy)
+    for(int d=0;d<AMREX_SPACEDIM;d++) {
+	MultiFab::LinComb(stochFlux[d], 
+			  stoch_weights[0], stochFlux_A[d], 1, 
+			  stoch_weights[1], stochFlux_B[d], 1,
+			  1, nvars-1, 0);
+    }
+
+    MultiFab::LinComb(rancorn, 
+		      stoch_weights[0], rancorn_A, 0, 
+		      stoch_weights[1], rancorn_B, 0,
+		      0, 1, 0);
+}
 
 void RK3step(MultiFab& cu, MultiFab& cup, MultiFab& cup2, MultiFab& /*cup3*/,
              MultiFab& prim, MultiFab& source,
@@ -33,34 +69,58 @@ void RK3step(MultiFab& cu, MultiFab& cup, MultiFab& cup2, MultiFab& /*cup3*/,
     swgt1 = 1.0;
 
     // Temp. stoch. fluxes
+    // with rng_field_type = 2 these are not stored; the weighted noise is generated
+    // inside calculateFlux from the streams of the two fields instead
+    bool in_kernel_noise = (rng_field_type == 2);
 
     // field "A"
     std::array< MultiFab, AMREX_SPACEDIM > stochFlux_A;
-    AMREX_D_TERM(stochFlux_A[0].define(stochFlux[0].boxArray(), stochFlux[0].DistributionMap(), nvars, 0);,
-                 stochFlux_A[1].define(stochFlux[1].boxArray(), stochFlux[1].DistributionMap(), nvars, 0);,
-                 stochFlux_A[2].define(stochFlux[2].boxArray(), stochFlux[2].DistributionMap(), nvars, 0););
-
     MultiFab rancorn_A;
-    rancorn_A.define(rancorn.boxArray(), rancorn.DistributionMap(), 1, 0);
 
     // field "B"
     std::array< MultiFab, AMREX_SPACEDIM > stochFlux_B;
-    AMREX_D_TERM(stochFlux_B[0].define(stochFlux[0].boxArray(), stochFlux[0].DistributionMap(), nvars, 0);,
-                 stochFlux_B[1].define(stochFlux[1].boxArray(), stochFlux[1].DistributionMap(), nvars, 0);,
-                 stochFlux_B[2].define(stochFlux[2].boxArray(), stochFlux[2].DistributionMap(), nvars, 0););
-
     MultiFab rancorn_B;
-    rancorn_B.define(rancorn.boxArray(), rancorn.DistributionMap(), 1, 0);
 
-    AMREX_D_TERM(stochFlux_A[0].setVal(0.0);,
-                 stochFlux_A[1].setVal(0.0);,
-                 stochFlux_A[2].setVal(0.0););
-    rancorn_A.setVal(0.0);
+    // in-kernel noise for the faces in each direction, then the corners
+    Vector< StochNoise > noise;
+
+    if (in_kernel_noise) {
+        noise.resize(AMREX_SPACEDIM+1);
+        for (int d=0; d<AMREX_SPACEDIM; ++d) {
+            noise[d] = MakeStochNoise(geom);
+            // same variances as the stored fields below; no noise on density
+            noise[d].scale[0] = 0.;
+            for (int i=1; i<nvars; ++i) {
+                noise[d].scale[i] = (i <= 3) ? variance_coef_mom :
+                                    (i == 4) ? variance_coef_ener : variance_coef_mass;
+            }
+        }
+        noise[AMREX_SPACEDIM] = MakeStochNoise(geom);
+        noise[AMREX_SPACEDIM].scale[0] = variance_coef_mom;
+    }
+    else {
+        AMREX_D_TERM(stochFlux_A[0].define(stochFlux[0].boxArray(), stochFlux[0].DistributionMap(), nvars, 0);,
+                     stochFlux_A[1].define(stochFlux[1].boxArray(), stochFlux[1].DistributionMap(), nvars, 0);,
+                     stochFlux_A[2].define(stochFlux[2].boxArray(), stochFlux[2].DistributionMap(), nvars, 0););
+
+        rancorn_A.define(rancorn.boxArray(), rancorn.DistributionMap(), 1, 0);
 
-    AMREX_D_TERM(stochFlux_B[0].setVal(0.0);,
-                 stochFlux_B[1].setVal(0.0);,
-                 stochFlux_B[2].setVal(0.0););
-    rancorn_B.setVal(0.0);
+        AMREX_D_TERM(stochFlux_B[0].define(stochFlux[0].boxArray(), stochFlux[0].DistributionMap(), nvars, 0);,
+                     stochFlux_B[1].define(stochFlux[1].boxArray(), stochFlux[1].DistributionMap(), nvars, 0);,
+                     stochFlux_B[2].define(stochFlux[2].boxArray(), stochFlux[2].DistributionMap(), nvars, 0););
+
+        rancorn_B.define(rancorn.boxArray(), rancorn.DistributionMap(), 1, 0);
+
+        AMREX_D_TERM(stochFlux_A[0].setVal(0.0);,
+                     stochFlux_A[1].setVal(0.0);,
+                     stochFlux_A[2].setVal(0.0););
+        rancorn_A.setVal(0.0);
+
+        AMREX_D_TERM(stochFlux_B[0].setVal(0.0);,
+                     stochFlux_B[1].setVal(0.0);,
+                     stochFlux_B[2].setVal(0.0););
+        rancorn_B.setVal(0.0);
+    }
 
     // chemistry
     MultiFab ranchem_A;
@@ -72,7 +132,7 @@ void RK3step(MultiFab& cu, MultiFab& cup, MultiFab& cup2, MultiFab& /*cup3*/,
     }
 
     // fill random numbers (can skip density component 0)
-    for(int d=0;d<AMREX_SPACEDIM;d++) {
+    for(int d=0;d<AMREX_SPACEDIM && !in_kernel_noise;d++) {
     	for(int i=1;i<nvars;i++) {
             Real variance;
             if (i>=1 && i <= 3) {
@@ -87,8 +147,10 @@ void RK3step(MultiFab& cu, MultiFab& cup, MultiFab& cup2, MultiFab& /*cup3*/,
         }
     }
 
-    MultiFabFillRandom(rancorn_A, 0, variance_coef_mom*variance_coef_mom, geom);
-    MultiFabFillRandom(rancorn_B, 0, variance_coef_mom*variance_coef_mom, geom);
+    if (!in_kernel_noise) {
+        MultiFabFillRandom(rancorn_A, 0, variance_coef_mom*variance_coef_mom, geom);
+        MultiFabFillRandom(rancorn_B, 0, variance_coef_mom*variance_coef_mom, geom);
+    }
 
     if (nreaction>0) {
         for (int m=0;m<nreaction;m++) {
@@ -109,28 +171,13 @@ void RK3step(MultiFab& cu, MultiFab& cup, MultiFab& cup2, MultiFab& /*cup3*/,
     swgt2 = ( 2.0*std::sqrt(2.0) + 1.0*std::sqrt(3.0) ) / 5.0;
     stoch_weights = {swgt1, swgt2};
 
-    AMREX_D_TERM(stochFlux[0].setVal(0.0);,
-                 stochFlux[1].setVal(0.0);,
-                 stochFlux[2].setVal(0.0););
-    rancorn.setVal(0.0);
-
-    // apply weights (only momentum and energy)
-    for(int d=0;d<AMREX_SPACEDIM;d++) {
-	MultiFab::LinComb(stochFlux[d], 
-			  stoch_weights[0], stochFlux_A[d], 1, 
-			  stoch_weights[1], stochFlux_B[d], 1,
-			  1, nvars-1, 0);
-    }
-
-    MultiFab::LinComb(rancorn, 
-		      stoch_weights[0], rancorn_A, 0, 
-		      stoch_weights[1], rancorn_B, 0,
-		      0, 1, 0);
+    WeightStochNoise(stochFlux, rancorn, stochFlux_A, stochFlux_B, rancorn_A, rancorn_B,
+                     noise, stoch_weights);
 
     ///////////////////////////////////////////////////////////
 
     calculateFlux(cu, prim, eta, zeta, kappa, chi, D, flux, stochFlux, cornx, corny, cornz,
-                  visccorn, rancorn, geom, stoch_weights, dt);
+                  visccorn, rancorn, geom, stoch_weights, dt, noise);
 
     if (nreaction>0)
     {
@@ -217,28 +264,13 @@ void RK3step(MultiFab& cu, MultiFab& cup, MultiFab& cup2, MultiFab& /*cup3*/,
     swgt2 = ( -4.0*std::sqrt(2.0) + 3.0*std::sqrt(3.0) ) / 5.0;
     stoch_weights = {swgt1, swgt2};
 
-    AMREX_D_TERM(stochFlux[0].setVal(0.0);,
-                 stochFlux[1].setVal(0.0);,
-                 stochFlux[2].setVal(0.0););
-    rancorn.setVal(0.0);
-
-    // apply weights (only momentum and energy)
-    for(int d=0;d<AMREX_SPACEDIM;d++) {
-	MultiFab::LinComb(stochFlux[d], 
-			  stoch_weights[0], stochFlux_A[d], 1, 
-			  stoch_weights[1], stochFlux_B[d], 1,
-			  1, nvars-1, 0);
-    }
-
-    MultiFab::LinComb(rancorn, 
-		      stoch_weights[0], rancorn_A, 0, 
-		      stoch_weights[1], rancorn_B, 0,
-		      0, 1, 0);
+    WeightStochNoise(stochFlux, rancorn, stochFlux_A, stochFlux_B, rancorn_A, rancorn_B,
+                     noise, stoch_weights);
 
     ///////////////////////////////////////////////////////////
 
     calculateFlux(cup, prim, eta, zeta, kappa, chi, D, flux, stochFlux, cornx, corny, cornz,
-                  visccorn, rancorn, geom, stoch_weights, dt);
+                  visccorn, rancorn, geom, stoch_weights, dt, noise);
 
     if (nreaction>0)
     {
@@ -321,28 +353,13 @@ void RK3step(MultiFab& cu, MultiFab& cup, MultiFab& cup2, MultiFab& /*cup3*/,
     swgt2 = ( 1.0*std::sqrt(2.0) - 2.0*std::sqrt(3.0) ) / 10.0;
     stoch_weights = {swgt1, swgt2};
     
-    AMREX_D_TERM(stochFlux[0].setVal(0.0);,
-                 stochFlux[1].setVal(0.0);,
-                 stochFlux[2].setVal(0.0););
-    rancorn.setVal(0.0);
-
-    // apply weights (only momentum and energy)
-    for(int d=0;d<AMREX_SPACEDIM;d++) {
-	MultiFab::LinComb(stochFlux[d], 
-			  stoch_weights[0], stochFlux_A[d], 1, 
-			  stoch_weights[1], stochFlux_B[d], 1,
-			  1, nvars-1, 0);
-    }
-
-    MultiFab::LinComb(rancorn, 
-		      stoch_weights[0], rancorn_A, 0, 
-		      stoch_weights[1], rancorn_B, 0,
-		      0, 1, 0);
+    WeightStochNoise(stochFlux, rancorn, stochFlux_A, stochFlux_B, rancorn_A, rancorn_B,
+                     noise, stoch_weights);
 
     ///////////////////////////////////////////////////////////
 
     calculateFlux(cup2, prim, eta, zeta, kappa, chi, D, flux, stochFlux, cornx, corny, cornz,
-                  visccorn, rancorn, geom, stoch_weights, dt);
+                  visccorn, rancorn, geom, stoch_weights, dt, noise);
 
     if (nreaction>0)
     {
@@ -4,6 +4,7 @@
 #include <sys/stat.h>
 
 #include "common_functions.H"
+#include "rng_functions.H"
 
 #include "compressible_functions_stag.H"
 
@@ -149,6 +150,20 @@ void WriteCheckPoint3D(int step,
     }
 
     
+    // seed and stream counter of the counter-based random fields (rng_field_type >= 1)
+    // GetRandomFieldSeed() is called on all ranks since a clock-based seed is broadcast
+    if (rng_field_type >= 1) {
+        unsigned int field_seed = GetRandomFieldSeed();
+        if (ParallelDescriptor::IOProcessor()) {
+            std::string rngFieldFileName(checkpointname + "/rng_field");
+            std::ofstream rngFieldFile(rngFieldFileName.c_str(), std::ofstream::out | std::ofstream::trunc);
+            if( !rngFieldFile.good()) {
+                amrex::FileOpenFailed(rngFieldFileName);
+            }
+            rngFieldFile << field_seed << " " << GetRandomFieldStream() << "\n";
+        }
+    }
+
     // write the MultiFab data to, e.g., chk00010/Level_0/
 
     // cu, cuMeans and cuVars
@@ -334,6 +349,20 @@ void WriteCheckPoint2D(int step,
     }
 
     
+    // seed and stream counter of the counter-based random fields (rng_field_type >= 1)
+    // GetRandomFieldSeed() is called on all ranks since a clock-based seed is broadcast
+    if (rng_field_type >= 1) {
+        unsigned int field_seed = GetRandomFieldSeed();
+        if (ParallelDescriptor::IOProcessor()) {
+            std::string rngFieldFileName(checkpointname + "/rng_field");
+            std::ofstream rngFieldFile(rngFieldFileName.c_str(), std::ofstream::out | std::ofstream::trunc);
+            if( !rngFieldFile.good()) {
+                amrex::FileOpenFailed(rngFieldFileName);
+            }
+            rngFieldFile << field_seed << " " << GetRandomFieldStream() << "\n";
+        }
+    }
+
     // write the MultiFab data to, e.g., chk00010/Level_0/
 
     // cu, cuMeans and cuVars
@@ -513,6 +542,20 @@ void WriteCheckPoint1D(int step,
     }
 
     
+    // seed and stream counter of the counter-based random fields (rng_field_type >= 1)
+    // GetRandomFieldSeed() is called on all ranks since a clock-based seed is broadcast
+    if (rng_field_type >= 1) {
+        unsigned int field_seed = GetRandomFieldSeed();
+        if (ParallelDescriptor::IOProcessor()) {
+            std::string rngFieldFileName(checkpointname + "/rng_field");
+            std::ofstream rngFieldFile(rngFieldFileName.c_str(), std::ofstream::out | std::ofstream::trunc);
+            if( !rngFieldFile.good()) {
+                amrex::FileOpenFailed(rngFieldFileName);
+            }
+            rngFieldFile << field_seed << " " << GetRandomFieldStream() << "\n";
+        }
+    }
+
     // write the MultiFab data to, e.g., chk00010/Level_0/
 
     // cu, cuMeans and cuVars
@@ -765,6 +808,24 @@ void ReadCheckPoint3D(int& step,
                    seed+ParallelDescriptor::MyProc());
     }
 
+    // continue the counter-based random fields (rng_field_type >= 1) where the checkpoint left off,
+    // so no stream is reused; with seed < 0 the key is also taken from the checkpoint
+    if (rng_field_type >= 1) {
+        std::string File(checkpointname + "/rng_field");
+        Vector<char> fileCharPtr;
+        ParallelDescriptor::ReadAndBcastFile(File, fileCharPtr);
+        std::string fileCharPtrString(fileCharPtr.dataPtr());
+        std::istringstream is(fileCharPtrString, std::istringstream::in);
+
+        unsigned int field_seed, field_stream;
+        is >> field_seed >> field_stream;
+
+        SetRandomFieldStream(field_stream);
+        if (seed < 0) {
+            SetRandomFieldSeed(field_seed);
+        }
+    }
+
     // read in the MultiFab data
     Read_Copy_MF_Checkpoint(cu,"cu",checkpointname,ba_old,dmap_old,nvars,1);
     Read_Copy_MF_Checkpoint(prim,"prim",checkpointname,ba_old,dmap_old,nprimvars,1);
@@ -1002,6 +1063,24 @@ void ReadCheckPoint2D(int& step,
                    seed+ParallelDescriptor::MyProc());
     }
 
+    // continue the counter-based random fields (rng_field_type >= 1) where the checkpoint left off,
+    // so no stream is reused; with seed < 0 the key is also taken from the checkpoint
+    if (rng_field_type >= 1) {
+        std::string File(checkpointname + "/rng_field");
+        Vector<char> fileCharPtr;
+        ParallelDescriptor::ReadAndBcastFile(File, fileCharPtr);
+        std::string fileCharPtrString(fileCharPtr.dataPtr());
+        std::istringstream is(fileCharPtrString, std::istringstream::in);
+
+        unsigned int field_seed, field_stream;
+        is >> field_seed >> field_stream;
+
+        SetRandomFieldStream(field_stream);
+        if (seed < 0) {
+            SetRandomFieldSeed(field_seed);
+        }
+    }
+
     // read in the MultiFab data
     Read_Copy_MF_Checkpoint(cu,"cu",checkpointname,ba_old,dmap_old,nvars,1);
     Read_Copy_MF_Checkpoint(prim,"prim",checkpointname,ba_old,dmap_old,nprimvars,1);
@@ -1229,6 +1308,24 @@ void ReadCheckPoint1D(int& step,
                    seed+ParallelDescriptor::MyProc());
     }
 
+    // continue the counter-based random fields (rng_field_type >= 1) where the checkpoint left off,
+    // so no stream is reused; with seed < 0 the key is also taken from the checkpoint
+    if (rng_field_type >= 1) {
+        std::string File(checkpointname + "/rng_field");
+        Vector<char> fileCharPtr;
+        ParallelDescriptor::ReadAndBcastFile(File, fileCharPtr);
+        std::string fileCharPtrString(fileCharPtr.dataPtr());
+        std::istringstream is(fileCharPtrString, std::istringstream::in);
+
+        unsigned int field_seed, field_stream;
+        is >> field_seed >> field_stream;
+
+        SetRandomFieldStream(field_stream);
+        if (seed < 0) {
+            SetRandomFieldSeed(field_seed);
+        }
+    }
+
     // read in the MultiFab data
     Read_Copy_MF_Checkpoint(cu,"cu",checkpointname,ba_old,dmap_old,nvars,1);
     Read_Copy_MF_Checkpoint(prim,"prim",checkpointname,ba_old,dmap_old,nprimvars,1);
@@ -18,7 +18,8 @@ void calculateFluxStag(const MultiFab& cons_in, const std::array< MultiFab, AMRE
                        std::array< MultiFab, AMREX_SPACEDIM>& stochcen_in,
                        const amrex::Geometry& geom,
                        const amrex::Vector< amrex::Real >& /*stoch_weights*/,
-                       const amrex::Real dt)
+                       const amrex::Real dt,
+                       const amrex::Vector< StochNoise >& noise)
 {
     BL_PROFILE_VAR("calculateFluxStag()",calculateFluxStag);
     
@@ -123,17 +124,30 @@ void calculateFluxStag(const MultiFab& cons_in, const std::array< MultiFab, AMRE
                          const Array4<Real> tauyz_stoch = tau_diagoff_stoch[1].array(mfi);,
                          const Array4<Real> tauxz_stoch = tau_diagoff_stoch[2].array(mfi););
 
-            AMREX_D_TERM(const Array4<Real>& stochfacex = stochface_in[0].array(mfi); ,
-                         const Array4<Real>& stochfacey = stochface_in[1].array(mfi); ,
-                         const Array4<Real>& stochfacez = stochface_in[2].array(mfi));
-
-            const Array4<Real>& stochedgex_v = stochedge_x_in[0].array(mfi);
-            const Array4<Real>& stochedgex_w = stochedge_x_in[1].array(mfi);
-            const Array4<Real>& stochedgey_w = stochedge_y_in[1].array(mfi);
-
-            const Array4<Real>& stochcenx_u = stochcen_in[0].array(mfi);
-            const Array4<Real>& stochceny_v = stochcen_in[1].array(mfi);
-            const Array4<Real>& stochcenz_w = stochcen_in[2].array(mfi);
+            // white noise, either read from the stochastic MultiFabs or generated in the kernels
+            // noise is ordered as the faces, the xy, xz and yz edges, then the cell centers
+            bool in_kernel = !noise.empty();
+
+            AMREX_D_TERM(StochNoise stochfacex = in_kernel ? noise[0] : StochNoise(); ,
+                         StochNoise stochfacey = in_kernel ? noise[1] : StochNoise(); ,
+                         StochNoise stochfacez = in_kernel ? noise[2] : StochNoise());
+            AMREX_D_TERM(stochfacex.stored = stochface_in[0].const_array(mfi); ,
+                         stochfacey.stored = stochface_in[1].const_array(mfi); ,
+                         stochfacez.stored = stochface_in[2].const_array(mfi));
+
+            StochNoise stochedgex_v = in_kernel ? noise[AMREX_SPACEDIM  ] : StochNoise();
+            StochNoise stochedgex_w = in_kernel ? noise[AMREX_SPACEDIM+1] : StochNoise();
+            StochNoise stochedgey_w = in_kernel ? noise[AMREX_SPACEDIM+2] : StochNoise();
+            stochedgex_v.stored = stochedge_x_in[0].const_array(mfi);
+            stochedgex_w.stored = stochedge_x_in[1].const_array(mfi);
+            stochedgey_w.stored = stochedge_y_in[1].const_array(mfi);
+
+            StochNoise stochcenx_u = in_kernel ? noise[AMREX_SPACEDIM+3] : StochNoise();
+            StochNoise stochceny_v = in_kernel ? noise[AMREX_SPACEDIM+4] : StochNoise();
+            StochNoise stochcenz_w = in_kernel ? noise[AMREX_SPACEDIM+5] : StochNoise();
+            stochcenx_u.stored = stochcen_in[0].const_array(mfi);
+            stochceny_v.stored = stochcen_in[1].const_array(mfi);
+            stochcenz_w.stored = stochcen_in[2].const_array(mfi);
 
             AMREX_D_TERM(Array4<Real const> const& velx = vel_in[0].array(mfi);,
                          Array4<Real const> const& vely = vel_in[1].array(mfi);,
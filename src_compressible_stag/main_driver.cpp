@@ -270,11 +270,9 @@ void main_driver(const char* argv)
     MultiFab master_project_rot_prim;
     MultiFab master_project_rot_cons;
 
-    // Vector of structure factors for 2D simulation
-    Vector < StructFact > structFactPrimArray;
-    Vector < StructFact > structFactConsArray;
-    MultiFab master_2D_rot_prim;
-    MultiFab master_2D_rot_cons;
+    // Structure factors for 2D simulation; every xy plane is a separate 2D sample
+    StructFact structFactPrim2D;
+    StructFact structFactCons2D;
     
     Geometry geom_flat;
     Geometry geom_flat_2D;
@@ -748,8 +746,6 @@ void main_driver(const char* argv)
             XRot = RotateFlattenedMF(X);
             ba_flat_2D = XRot.boxArray();
             dmap_flat_2D = XRot.DistributionMap();
-            master_2D_rot_prim.define(ba_flat_2D,dmap_flat_2D,structVarsPrim,0);
-            master_2D_rot_cons.define(ba_flat_2D,dmap_flat_2D,structVarsCons,0);
 
             IntVect dom_lo_flat(AMREX_D_DECL(0,0,0));
             IntVect dom_hi_flat;
@@ -773,13 +769,9 @@ void main_driver(const char* argv)
 
         }
 
-        structFactPrimArray.resize(n_cells[2]);
-        structFactConsArray.resize(n_cells[2]);
-
-        for (int i = 0; i < n_cells[2]; ++i) { 
-            structFactPrimArray[i].define(ba_flat_2D,dmap_flat_2D,prim_var_names,var_scaling_prim,2);
-            structFactConsArray[i].define(ba_flat_2D,dmap_flat_2D,cons_var_names,var_scaling_cons,2);
-        }
+        // all n_cells[2] planes are transformed together from the full 3D data
+        structFactPrim2D.defineSlices(ba,dmap,prim_var_names,var_scaling_prim,2);
+        structFactCons2D.defineSlices(ba,dmap,cons_var_names,var_scaling_cons,2);
 
     }
 
@@ -1141,28 +1133,8 @@ void main_driver(const char* argv)
             }
 
             if (do_2D) {
-
-                for (int i=0; i<n_cells[2]; ++i) {
-
-                    {
-                        MultiFab X, XRot;
-
-                        ExtractSlice(structFactPrimMF, X, geom, 2, i, 0, structVarsPrim);
-                        XRot = RotateFlattenedMF(X);
-                        master_2D_rot_prim.ParallelCopy(XRot, 0, 0, structVarsPrim); 
-                        structFactPrimArray[i].FortStructure(master_2D_rot_prim,geom_flat_2D);
-                    }
-
-                    {
-                        MultiFab X, XRot;
-
-                        ExtractSlice(structFactConsMF, X, geom, 2, i, 0, structVarsCons);
-                        XRot = RotateFlattenedMF(X);
-                        master_2D_rot_cons.ParallelCopy(XRot, 0, 0, structVarsCons); 
-                        structFactConsArray[i].FortStructure(master_2D_rot_cons,geom_flat_2D);
-                    }
-
-                }
+                structFactPrim2D.FortStructure(structFactPrimMF,geom);
+                structFactCons2D.FortStructure(structFactConsMF,geom);
             }
         }
 
@@ -1193,31 +1165,19 @@ void main_driver(const char* argv)
                     
                 MultiFab prim_mag, prim_realimag, cons_mag, cons_realimag;
 
-                prim_mag.define(ba_flat_2D,dmap_flat_2D,structFactPrimArray[0].get_ncov(),0);
-                prim_realimag.define(ba_flat_2D,dmap_flat_2D,2*structFactPrimArray[0].get_ncov(),0);
-                cons_mag.define(ba_flat_2D,dmap_flat_2D,structFactConsArray[0].get_ncov(),0);
-                cons_realimag.define(ba_flat_2D,dmap_flat_2D,2*structFactConsArray[0].get_ncov(),0);
-
-                prim_mag.setVal(0.0);
-                cons_mag.setVal(0.0);
-                prim_realimag.setVal(0.0);
-                cons_realimag.setVal(0.0);
+                prim_mag.define(ba_flat_2D,dmap_flat_2D,structFactPrim2D.get_ncov(),0);
+                prim_realimag.define(ba_flat_2D,dmap_flat_2D,2*structFactPrim2D.get_ncov(),0);
+                cons_mag.define(ba_flat_2D,dmap_flat_2D,structFactCons2D.get_ncov(),0);
+                cons_realimag.define(ba_flat_2D,dmap_flat_2D,2*structFactCons2D.get_ncov(),0);
 
-                for (int i=0; i<n_cells[2]; ++i) {
-                    structFactPrimArray[i].AddToExternal(prim_mag,prim_realimag,geom_flat_2D);
-                    structFactConsArray[i].AddToExternal(cons_mag,cons_realimag,geom_flat_2D);
-                }
-                    
-                Real ncellsinv = 1.0/n_cells[2];
-                prim_mag.mult(ncellsinv);
-                cons_mag.mult(ncellsinv);
-                prim_realimag.mult(ncellsinv);
-                cons_realimag.mult(ncellsinv);
+                // average of the per-slice structure factors
+                structFactPrim2D.AverageSlices(prim_mag,prim_realimag,geom);
+                structFactCons2D.AverageSlices(cons_mag,cons_realimag,geom);
 
                 WritePlotFilesSF_2D(prim_mag,prim_realimag,geom_flat_2D,step,time,
-                                    structFactPrimArray[0].get_names(),"plt_SF_prim_2D");
+                                    structFactPrim2D.get_names(),"plt_SF_prim_2D");
                 WritePlotFilesSF_2D(cons_mag,cons_realimag,geom_flat_2D,step,time,
-                                    structFactConsArray[0].get_names(),"plt_SF_cons_2D");
+                                    structFactCons2D.get_names(),"plt_SF_cons_2D");
 
             }
         }
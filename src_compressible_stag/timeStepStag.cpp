@@ -7,6 +7,75 @@
 #include "rng_functions.H"
 #include <AMReX_VisMF.H>
 
+// combine the white noise fields A and B with the weights of this RK stage
+// for in-kernel noise only the weights are set; calculateFluxStag generates the combination
+static void WeightStochNoiseStag(std::array< MultiFab, AMREX_SPACEDIM >& stochface,
+                                 std::array< MultiFab, 2 >& stochedge_x,
+                                 std::array< MultiFab, 2 >& stochedge_y,
+                                 std::array< MultiFab, 2 >& stochedge_z,
+                                 std::array< MultiFab, AMREX_SPACEDIM >& stochcen,
+                                 const std::array< MultiFab, AMREX_SPACEDIM >& stochface_A,
+                                 const std::array< MultiFab, 2 >& stochedge_x_A,
+                                 const std::array< MultiFab, 2 >& stochedge_y_A,
+                                 const std::array< MultiFab, 2 >& stochedge_z_A,
+                                 const std::array< MultiFab, AMREX_SPACEDIM >& stochcen_A,
+                                 const std::array< MultiFab, AMREX_SPACEDIM >& stochface_B,
+                                 const std::array< MultiFab, 2 >& stochedge_x_B,
+                                 const std::array< MultiFab, 2 >& stochedge_y_B,
+                                 const std::array< MultiFab, 2 >& stochedge_z_B,
+                                 const std::array< MultiFab, AMREX_SPACEDIM >& stochcen_B,
+                                 Vector< StochNoise >& noise,
+                                 const Vector< Real >& stoch_weights)
+{
+    if (!noise.empty()) {
+        for (auto& n : noise) {
+            n.w_A = stoch_weights[0];
+            n.w_B = stoch_weights[1];
+        }
+        return;
+    }
+
+    // apply weights (only energy and ns-1 species)
+    AMREX_D_TERM(stochface[0].setVal(0.0);,
+                 stochface[1].setVal(0.0);,
+                 stochface[2].setVal(0.0););
+
+    stochedge_x[0].setVal(0.0); stochedge_x[1].setVal(0.0);
+    stochedge_y[0].setVal(0.0); stochedge_y[1].setVal(0.0);
+    stochedge_z[0].setVal(0.0); stochedge_z[1].setVal(0.0);
+
+    AMREX_D_TERM(stochcen[0].setVal(0.0);,
+                 stochcen[1].setVal(0.0);,
+                 stochcen[2].setVal(0.0););
+
+    for (int d=0;d<AMREX_SPACEDIM;d++) {
+	    MultiFab::LinComb(stochface[d], 
+            stoch_weights[0], stochface_A[d], 1, 
+            stoch_weights[1], stochface_B[d], 1,
+            1, nvars-1, 0);
+    }
+    for (int i=0;i<2;i++) {
+        MultiFab::LinComb(stochedge_x[i],
+            stoch_weights[0], stochedge_x_A[i], 0,
+            stoch_weights[1], stochedge_x_B[i], 0,
+            0, 1, 0);
+        MultiFab::LinComb(stochedge_y[i],
+            stoch_weights[0], stochedge_y_A[i], 0,
+            stoch_weights[1], stochedge_y_B[i], 0,
+            0, 1, 0);
+        MultiFab::LinComb(stochedge_z[i],
+            stoch_weights[0], stochedge_z_A[i], 0,
+            stoch_weights[1], stochedge_z_B[i], 0,
+            0, 1, 0);
+    }
+    for (int i=0;i<3;i++) {
+        MultiFab::LinComb(stochcen[i],
+            stoch_weights[0], stochcen_A[i], 0,
+            stoch_weights[1], stochcen_B[i], 0,
+            0, 1, 1);
+    }
+}
+
 void RK3stepStag(MultiFab& cu, 
                  std::array< MultiFab, AMREX_SPACEDIM >& cumom,
                  MultiFab& prim, std::array< MultiFab, AMREX_SPACEDIM >& vel,
@@ -52,10 +121,15 @@ void RK3stepStag(MultiFab& cu,
     
     /////////////////////////////////////////////////////
     // Setup stochastic flux MultiFabs
+    // with rng_field_type = 2 the noise is generated inside calculateFluxStag from the
+    // streams of the two fields; the MultiFabs below are then only placeholders
+    bool in_kernel_noise = (rng_field_type == 2);
+    int nstoch = in_kernel_noise ? 1 : nvars;
+
     std::array< MultiFab, AMREX_SPACEDIM > stochface;
-    AMREX_D_TERM(stochface[0].define(convert(cu.boxArray(),nodal_flag_x), cu.DistributionMap(), nvars, 0);,
-                 stochface[1].define(convert(cu.boxArray(),nodal_flag_y), cu.DistributionMap(), nvars, 0);,
-                 stochface[2].define(convert(cu.boxArray(),nodal_flag_z), cu.DistributionMap(), nvars, 0););
+    AMREX_D_TERM(stochface[0].define(convert(cu.boxArray(),nodal_flag_x), cu.DistributionMap(), nstoch, 0);,
+                 stochface[1].define(convert(cu.boxArray(),nodal_flag_y), cu.DistributionMap(), nstoch, 0);,
+                 stochface[2].define(convert(cu.boxArray(),nodal_flag_z), cu.DistributionMap(), nstoch, 0););
     
     std::array< MultiFab, 2 > stochedge_x; 
     std::array< MultiFab, 2 > stochedge_y; 
@@ -85,75 +159,107 @@ void RK3stepStag(MultiFab& cu,
 
     // field "A"
     std::array< MultiFab, AMREX_SPACEDIM > stochface_A;
-    AMREX_D_TERM(stochface_A[0].define(stochface[0].boxArray(), stochface[0].DistributionMap(), nvars, 0);,
-                 stochface_A[1].define(stochface[1].boxArray(), stochface[1].DistributionMap(), nvars, 0);,
-                 stochface_A[2].define(stochface[2].boxArray(), stochface[2].DistributionMap(), nvars, 0););
-
-    AMREX_D_TERM(stochface_A[0].setVal(0.0);,
-                 stochface_A[1].setVal(0.0);,
-                 stochface_A[2].setVal(0.0););
-    
     std::array< MultiFab, 2 > stochedge_x_A; 
     std::array< MultiFab, 2 > stochedge_y_A; 
     std::array< MultiFab, 2 > stochedge_z_A; 
-
-    stochedge_x_A[0].define(stochedge_x[0].boxArray(), stochedge_x[0].DistributionMap(), 1, 0); 
-    stochedge_x_A[1].define(stochedge_x[1].boxArray(), stochedge_x[1].DistributionMap(), 1, 0);
-             
-    stochedge_y_A[0].define(stochedge_y[0].boxArray(), stochedge_y[0].DistributionMap(), 1, 0);
-    stochedge_y_A[1].define(stochedge_y[1].boxArray(), stochedge_y[1].DistributionMap(), 1, 0);
-
-    stochedge_z_A[0].define(stochedge_z[0].boxArray(), stochedge_z[0].DistributionMap(), 1, 0);
-    stochedge_z_A[1].define(stochedge_z[1].boxArray(), stochedge_z[1].DistributionMap(), 1, 0);
-
-    stochedge_x_A[0].setVal(0.0); stochedge_x_A[1].setVal(0.0);
-    stochedge_y_A[0].setVal(0.0); stochedge_y_A[1].setVal(0.0);
-    stochedge_z_A[0].setVal(0.0); stochedge_z_A[1].setVal(0.0);
-
     std::array< MultiFab, AMREX_SPACEDIM > stochcen_A;
-    AMREX_D_TERM(stochcen_A[0].define(stochcen[0].boxArray(),stochcen[0].DistributionMap(),1,1);,
-                 stochcen_A[1].define(stochcen[1].boxArray(),stochcen[1].DistributionMap(),1,1);,
-                 stochcen_A[2].define(stochcen[2].boxArray(),stochcen[2].DistributionMap(),1,1););
-
-    AMREX_D_TERM(stochcen_A[0].setVal(0.0);,
-                 stochcen_A[1].setVal(0.0);,
-                 stochcen_A[2].setVal(0.0););
 
     // field "B"
     std::array< MultiFab, AMREX_SPACEDIM > stochface_B;
-    AMREX_D_TERM(stochface_B[0].define(stochface[0].boxArray(), stochface[0].DistributionMap(), nvars, 0);,
-                 stochface_B[1].define(stochface[1].boxArray(), stochface[1].DistributionMap(), nvars, 0);,
-                 stochface_B[2].define(stochface[2].boxArray(), stochface[2].DistributionMap(), nvars, 0););
-
-    AMREX_D_TERM(stochface_B[0].setVal(0.0);,
-                 stochface_B[1].setVal(0.0);,
-                 stochface_B[2].setVal(0.0););
-    
     std::array< MultiFab, 2 > stochedge_x_B; 
     std::array< MultiFab, 2 > stochedge_y_B; 
     std::array< MultiFab, 2 > stochedge_z_B; 
+    std::array< MultiFab, AMREX_SPACEDIM > stochcen_B;
 
-    stochedge_x_B[0].define(stochedge_x[0].boxArray(), stochedge_x[0].DistributionMap(), 1, 0); 
-    stochedge_x_B[1].define(stochedge_x[1].boxArray(), stochedge_x[1].DistributionMap(), 1, 0);
-             
-    stochedge_y_B[0].define(stochedge_y[0].boxArray(), stochedge_y[0].DistributionMap(), 1, 0);
-    stochedge_y_B[1].define(stochedge_y[1].boxArray(), stochedge_y[1].DistributionMap(), 1, 0);
+    // in-kernel noise for the faces, the xy, xz and yz edges, then the cell centers
+    Vector< StochNoise > noise;
+
+    if (in_kernel_noise) {
+        noise.resize(AMREX_SPACEDIM+6);
+        for (auto& n : noise) {
+            n = MakeStochNoise(geom);
+        }
+
+        // same variances as the stored fields below; fields that are not filled there are zero
+        int nd = do_1D ? 1 : (do_2D ? 2 : 3);
+        for (int d=0; d<AMREX_SPACEDIM; ++d) {
+            // no noise on density
+            noise[d].scale[0] = 0.;
+            if (d >= nd) {
+                for (int i=1; i<MAX_SPECIES+5; ++i) {
+                    noise[d].scale[i] = 0.;
+                }
+            }
+        }
+        for (int e=0; e<3; ++e) {
+            // only the xy edge in 2D
+            noise[AMREX_SPACEDIM+e].scale[0] = (nd == 3 || (nd == 2 && e == 0)) ? 1. : 0.;
+        }
+        for (int d=0; d<3; ++d) {
+            noise[AMREX_SPACEDIM+3+d].scale[0] = (d >= nd) ? 0. : (nd == 1) ? 1. : std::sqrt(2.);
+        }
+    }
+    else {
+        // field "A"
+        AMREX_D_TERM(stochface_A[0].define(stochface[0].boxArray(), stochface[0].DistributionMap(), nvars, 0);,
+                     stochface_A[1].define(stochface[1].boxArray(), stochface[1].DistributionMap(), nvars, 0);,
+                     stochface_A[2].define(stochface[2].boxArray(), stochface[2].DistributionMap(), nvars, 0););
 
-    stochedge_z_B[0].define(stochedge_z[0].boxArray(), stochedge_z[0].DistributionMap(), 1, 0);
-    stochedge_z_B[1].define(stochedge_z[1].boxArray(), stochedge_z[1].DistributionMap(), 1, 0);
+        AMREX_D_TERM(stochface_A[0].setVal(0.0);,
+                     stochface_A[1].setVal(0.0);,
+                     stochface_A[2].setVal(0.0););
 
-    stochedge_x_B[0].setVal(0.0); stochedge_x_B[1].setVal(0.0);
-    stochedge_y_B[0].setVal(0.0); stochedge_y_B[1].setVal(0.0);
-    stochedge_z_B[0].setVal(0.0); stochedge_z_B[1].setVal(0.0);
+        stochedge_x_A[0].define(stochedge_x[0].boxArray(), stochedge_x[0].DistributionMap(), 1, 0); 
+        stochedge_x_A[1].define(stochedge_x[1].boxArray(), stochedge_x[1].DistributionMap(), 1, 0);
 
-    std::array< MultiFab, AMREX_SPACEDIM > stochcen_B;
-    AMREX_D_TERM(stochcen_B[0].define(stochcen[0].boxArray(),stochcen[0].DistributionMap(),1,1);,
-                 stochcen_B[1].define(stochcen[1].boxArray(),stochcen[1].DistributionMap(),1,1);,
-                 stochcen_B[2].define(stochcen[2].boxArray(),stochcen[2].DistributionMap(),1,1););
+        stochedge_y_A[0].define(stochedge_y[0].boxArray(), stochedge_y[0].DistributionMap(), 1, 0);
+        stochedge_y_A[1].define(stochedge_y[1].boxArray(), stochedge_y[1].DistributionMap(), 1, 0);
+
+        stochedge_z_A[0].define(stochedge_z[0].boxArray(), stochedge_z[0].DistributionMap(), 1, 0);
+        stochedge_z_A[1].define(stochedge_z[1].boxArray(), stochedge_z[1].DistributionMap(), 1, 0);
 
-    AMREX_D_TERM(stochcen_B[0].setVal(0.0);,
-                 stochcen_B[1].setVal(0.0);,
-                 stochcen_B[2].setVal(0.0););
+        stochedge_x_A[0].setVal(0.0); stochedge_x_A[1].setVal(0.0);
+        stochedge_y_A[0].setVal(0.0); stochedge_y_A[1].setVal(0.0);
+        stochedge_z_A[0].setVal(0.0); stochedge_z_A[1].setVal(0.0);
+
+        AMREX_D_TERM(stochcen_A[0].define(stochcen[0].boxArray(),stochcen[0].DistributionMap(),1,1);,
+                     stochcen_A[1].define(stochcen[1].boxArray(),stochcen[1].DistributionMap(),1,1);,
+                     stochcen_A[2].define(stochcen[2].boxArray(),stochcen[2].DistributionMap(),1,1););
+
+        AMREX_D_TERM(stochcen_A[0].setVal(0.0);,
+                     stochcen_A[1].setVal(0.0);,
+                     stochcen_A[2].setVal(0.0););
+
+        // field "B"
+        AMREX_D_TERM(stochface_B[0].define(stochface[0].boxArray(), stochface[0].DistributionMap(), nvars, 0);,
+                     stochface_B[1].define(stochface[1].boxArray(), stochface[1].DistributionMap(), nvars, 0);,
+                     stochface_B[2].define(stochface[2].boxArray(), stochface[2].DistributionMap(), nvars, 0););
+
+        AMREX_D_TERM(stochface_B[0].setVal(0.0);,
+                     stochface_B[1].setVal(0.0);,
+                     stochface_B[2].setVal(0.0););
+
+        stochedge_x_B[0].define(stochedge_x[0].boxArray(), stochedge_x[0].DistributionMap(), 1, 0); 
+        stochedge_x_B[1].define(stochedge_x[1].boxArray(), stochedge_x[1].DistributionMap(), 1, 0);
+
+        stochedge_y_B[0].define(stochedge_y[0].boxArray(), stochedge_y[0].DistributionMap(), 1, 0);
+        stochedge_y_B[1].define(stochedge_y[1].boxArray(), stochedge_y[1].DistributionMap(), 1, 0);
+
+        stochedge_z_B[0].define(stochedge_z[0].boxArray(), stochedge_z[0].DistributionMap(), 1, 0);
+        stochedge_z_B[1].define(stochedge_z[1].boxArray(), stochedge_z[1].DistributionMap(), 1, 0);
+
+        stochedge_x_B[0].setVal(0.0); stochedge_x_B[1].setVal(0.0);
+        stochedge_y_B[0].setVal(0.0); stochedge_y_B[1].setVal(0.0);
+        stochedge_z_B[0].setVal(0.0); stochedge_z_B[1].setVal(0.0);
+
+        AMREX_D_TERM(stochcen_B[0].define(stochcen[0].boxArray(),stochcen[0].DistributionMap(),1,1);,
+                     stochcen_B[1].define(stochcen[1].boxArray(),stochcen[1].DistributionMap(),1,1);,
+                     stochcen_B[2].define(stochcen[2].boxArray(),stochcen[2].DistributionMap(),1,1););
+
+        AMREX_D_TERM(stochcen_B[0].setVal(0.0);,
+                     stochcen_B[1].setVal(0.0);,
+                     stochcen_B[2].setVal(0.0););
+    }
 
     // chemistry
     MultiFab ranchem_A;
@@ -166,62 +272,64 @@ void RK3stepStag(MultiFab& cu,
 
 
     // fill random numbers (can skip density component 0)
-    if (do_1D) { // 1D need only for x- face 
-        for(int i=1;i<nvars;i++) {
-            MultiFabFillRandom(stochface_A[0], i, 1.0, geom);
-            MultiFabFillRandom(stochface_B[0], i, 1.0, geom);
-        }
-    }
-    else if (do_2D) { // 2D need only for x- and y- faces
-        for(int i=1;i<nvars;i++) {
-            MultiFabFillRandom(stochface_A[0], i, 1.0, geom);
-            MultiFabFillRandom(stochface_B[0], i, 1.0, geom);
-            MultiFabFillRandom(stochface_A[1], i, 1.0, geom);
-            MultiFabFillRandom(stochface_B[1], i, 1.0, geom);
+    if (!in_kernel_noise) {
+        if (do_1D) { // 1D need only for x- face 
+            for(int i=1;i<nvars;i++) {
+                MultiFabFillRandom(stochface_A[0], i, 1.0, geom);
+                MultiFabFillRandom(stochface_B[0], i, 1.0, geom);
+            }
         }
-    }
-    else { // 3D
-        for(int d=0;d<AMREX_SPACEDIM;d++) {
+        else if (do_2D) { // 2D need only for x- and y- faces
             for(int i=1;i<nvars;i++) {
-                MultiFabFillRandom(stochface_A[d], i, 1.0, geom);
-                MultiFabFillRandom(stochface_B[d], i, 1.0, geom);
+                MultiFabFillRandom(stochface_A[0], i, 1.0, geom);
+                MultiFabFillRandom(stochface_B[0], i, 1.0, geom);
+                MultiFabFillRandom(stochface_A[1], i, 1.0, geom);
+                MultiFabFillRandom(stochface_B[1], i, 1.0, geom);
+            }
+        }
+        else { // 3D
+            for(int d=0;d<AMREX_SPACEDIM;d++) {
+                for(int i=1;i<nvars;i++) {
+                    MultiFabFillRandom(stochface_A[d], i, 1.0, geom);
+                    MultiFabFillRandom(stochface_B[d], i, 1.0, geom);
+                }
             }
         }
-    }
 
-    if (do_1D) { // 1D no transverse shear fluxes
-    }
-    else if (do_2D) { // 2D only xy-shear
-        MultiFabFillRandom(stochedge_x_A[0], 0, 1.0, geom);
-        MultiFabFillRandom(stochedge_x_B[0], 0, 1.0, geom);
-        MultiFabFillRandom(stochedge_y_A[0], 0, 1.0, geom);
-        MultiFabFillRandom(stochedge_y_B[0], 0, 1.0, geom);
-    }
-    else { // 3D
-        for (int i=0; i<2; i++) {
-            MultiFabFillRandom(stochedge_x_A[i], 0, 1.0, geom);
-            MultiFabFillRandom(stochedge_x_B[i], 0, 1.0, geom);
-            MultiFabFillRandom(stochedge_y_A[i], 0, 1.0, geom);
-            MultiFabFillRandom(stochedge_y_B[i], 0, 1.0, geom);
-            MultiFabFillRandom(stochedge_z_A[i], 0, 1.0, geom);
-            MultiFabFillRandom(stochedge_z_B[i], 0, 1.0, geom);
+        if (do_1D) { // 1D no transverse shear fluxes
+        }
+        else if (do_2D) { // 2D only xy-shear
+            MultiFabFillRandom(stochedge_x_A[0], 0, 1.0, geom);
+            MultiFabFillRandom(stochedge_x_B[0], 0, 1.0, geom);
+            MultiFabFillRandom(stochedge_y_A[0], 0, 1.0, geom);
+            MultiFabFillRandom(stochedge_y_B[0], 0, 1.0, geom);
+        }
+        else { // 3D
+            for (int i=0; i<2; i++) {
+                MultiFabFillRandom(stochedge_x_A[i], 0, 1.0, geom);
+                MultiFabFillRandom(stochedge_x_B[i], 0, 1.0, geom);
+                MultiFabFillRandom(stochedge_y_A[i], 0, 1.0, geom);
+                MultiFabFillRandom(stochedge_y_B[i], 0, 1.0, geom);
+                MultiFabFillRandom(stochedge_z_A[i], 0, 1.0, geom);
+                MultiFabFillRandom(stochedge_z_B[i], 0, 1.0, geom);
+            }
         }
-    }
 
-    if (do_1D) { // 1D no v_x and w_z stochastic terms
-        MultiFabFillRandom(stochcen_A[0], 0, 1.0, geom, 1);
-        MultiFabFillRandom(stochcen_B[0], 0, 1.0, geom, 1);
-    }
-    else if (do_2D) { // 2D simulation no w_z stochastic term
-        MultiFabFillRandom(stochcen_A[0], 0, 2.0, geom, 1);
-        MultiFabFillRandom(stochcen_B[0], 0, 2.0, geom, 1);
-        MultiFabFillRandom(stochcen_A[1], 0, 2.0, geom, 1);
-        MultiFabFillRandom(stochcen_B[1], 0, 2.0, geom, 1);
-    }
-    else { // 3D
-        for (int i=0; i<3; i++) {
-            MultiFabFillRandom(stochcen_A[i], 0, 2.0, geom, 1);
-            MultiFabFillRandom(stochcen_B[i], 0, 2.0, geom, 1);
+        if (do_1D) { // 1D no v_x and w_z stochastic terms
+            MultiFabFillRandom(stochcen_A[0], 0, 1.0, geom, 1);
+            MultiFabFillRandom(stochcen_B[0], 0, 1.0, geom, 1);
+        }
+        else if (do_2D) { // 2D simulation no w_z stochastic term
+            MultiFabFillRandom(stochcen_A[0], 0, 2.0, geom, 1);
+            MultiFabFillRandom(stochcen_B[0], 0, 2.0, geom, 1);
+            MultiFabFillRandom(stochcen_A[1], 0, 2.0, geom, 1);
+            MultiFabFillRandom(stochcen_B[1], 0, 2.0, geom, 1);
+        }
+        else { // 3D
+            for (int i=0; i<3; i++) {
+                MultiFabFillRandom(stochcen_A[i], 0, 2.0, geom, 1);
+                MultiFabFillRandom(stochcen_B[i], 0, 2.0, geom, 1);
+            }
         }
     }
 
@@ -240,45 +348,10 @@ void RK3stepStag(MultiFab& cu,
     swgt2 = ( 2.0*std::sqrt(2.0) + 1.0*std::sqrt(3.0) ) / 5.0;
     stoch_weights = {swgt1, swgt2};
 
-    // apply weights (only energy and ns-1 species)
-    AMREX_D_TERM(stochface[0].setVal(0.0);,
-                 stochface[1].setVal(0.0);,
-                 stochface[2].setVal(0.0););
-
-    stochedge_x[0].setVal(0.0); stochedge_x[1].setVal(0.0);
-    stochedge_y[0].setVal(0.0); stochedge_y[1].setVal(0.0);
-    stochedge_z[0].setVal(0.0); stochedge_z[1].setVal(0.0);
-
-    AMREX_D_TERM(stochcen[0].setVal(0.0);,
-                 stochcen[1].setVal(0.0);,
-                 stochcen[2].setVal(0.0););
-
-    for (int d=0;d<AMREX_SPACEDIM;d++) {
-	    MultiFab::LinComb(stochface[d], 
-            stoch_weights[0], stochface_A[d], 1, 
-            stoch_weights[1], stochface_B[d], 1,
-            1, nvars-1, 0);
-    }
-    for (int i=0;i<2;i++) {
-        MultiFab::LinComb(stochedge_x[i],
-            stoch_weights[0], stochedge_x_A[i], 0,
-            stoch_weights[1], stochedge_x_B[i], 0,
-            0, 1, 0);
-        MultiFab::LinComb(stochedge_y[i],
-            stoch_weights[0], stochedge_y_A[i], 0,
-            stoch_weights[1], stochedge_y_B[i], 0,
-            0, 1, 0);
-        MultiFab::LinComb(stochedge_z[i],
-            stoch_weights[0], stochedge_z_A[i], 0,
-            stoch_weights[1], stochedge_z_B[i], 0,
-            0, 1, 0);
-    }
-    for (int i=0;i<3;i++) {
-        MultiFab::LinComb(stochcen[i],
-            stoch_weights[0], stochcen_A[i], 0,
-            stoch_weights[1], stochcen_B[i], 0,
-            0, 1, 1);
-    }
+    WeightStochNoiseStag(stochface, stochedge_x, stochedge_y, stochedge_z, stochcen,
+                         stochface_A, stochedge_x_A, stochedge_y_A, stochedge_z_A, stochcen_A,
+                         stochface_B, stochedge_x_B, stochedge_y_B, stochedge_z_B, stochcen_B,
+                         noise, stoch_weights);
     /////////////////////////////////////////////////////
 
     calculateTransportCoeffs(prim, eta, zeta, kappa, chi, D);
@@ -286,7 +359,7 @@ void RK3stepStag(MultiFab& cu,
     calculateFluxStag(cu, cumom, prim, vel, eta, zeta, kappa, chi, D, 
         faceflux, edgeflux_x, edgeflux_y, edgeflux_z, cenflux, 
         stochface, stochedge_x, stochedge_y, stochedge_z, stochcen, 
-        geom, stoch_weights,dt);
+        geom, stoch_weights,dt,noise);
 
     if (nreaction>0) {
         MultiFab::LinComb(ranchem,
@@ -409,51 +482,16 @@ void RK3stepStag(MultiFab& cu,
     swgt2 = ( -4.0*std::sqrt(2.0) + 3.0*std::sqrt(3.0) ) / 5.0;
     stoch_weights = {swgt1, swgt2};
 
-    // apply weights (only energy and ns-1 species)
-    AMREX_D_TERM(stochface[0].setVal(0.0);,
-                 stochface[1].setVal(0.0);,
-                 stochface[2].setVal(0.0););
-
-    stochedge_x[0].setVal(0.0); stochedge_x[1].setVal(0.0);
-    stochedge_y[0].setVal(0.0); stochedge_y[1].setVal(0.0);
-    stochedge_z[0].setVal(0.0); stochedge_z[1].setVal(0.0);
-
-    AMREX_D_TERM(stochcen[0].setVal(0.0);,
-                 stochcen[1].setVal(0.0);,
-                 stochcen[2].setVal(0.0););
-
-    for (int d=0;d<AMREX_SPACEDIM;d++) {
-	    MultiFab::LinComb(stochface[d], 
-            stoch_weights[0], stochface_A[d], 1, 
-            stoch_weights[1], stochface_B[d], 1,
-            1, nvars-1, 0);
-    }
-    for (int i=0;i<2;i++) {
-        MultiFab::LinComb(stochedge_x[i],
-            stoch_weights[0], stochedge_x_A[i], 0,
-            stoch_weights[1], stochedge_x_B[i], 0,
-            0, 1, 0);
-        MultiFab::LinComb(stochedge_y[i],
-            stoch_weights[0], stochedge_y_A[i], 0,
-            stoch_weights[1], stochedge_y_B[i], 0,
-            0, 1, 0);
-        MultiFab::LinComb(stochedge_z[i],
-            stoch_weights[0], stochedge_z_A[i], 0,
-            stoch_weights[1], stochedge_z_B[i], 0,
-            0, 1, 0);
-    }
-    for (int i=0;i<3;i++) {
-        MultiFab::LinComb(stochcen[i],
-            stoch_weights[0], stochcen_A[i], 0,
-            stoch_weights[1], stochcen_B[i], 0,
-            0, 1, 1);
-    }
+    WeightStochNoiseStag(stochface, stochedge_x, stochedge_y, stochedge_z, stochcen,
+                         stochface_A, stochedge_x_A, stochedge_y_A, stochedge_z_A, stochcen_A,
+                         stochface_B, stochedge_x_B, stochedge_y_B, stochedge_z_B, stochcen_B,
+                         noise, stoch_weights);
     ///////////////////////////////////////////////////////////
 
     calculateFluxStag(cup, cupmom, prim, vel, eta, zeta, kappa, chi, D, 
         faceflux, edgeflux_x, edgeflux_y, edgeflux_z, cenflux, 
         stochface, stochedge_x, stochedge_y, stochedge_z, stochcen, 
-        geom, stoch_weights,dt);
+        geom, stoch_weights,dt,noise);
 
     if (nreaction>0) {
         MultiFab::LinComb(ranchem,
@@ -581,51 +619,16 @@ void RK3stepStag(MultiFab& cu,
     swgt2 = ( 1.0*std::sqrt(2.0) - 2.0*std::sqrt(3.0) ) / 10.0;
     stoch_weights = {swgt1, swgt2};
 
-    // apply weights (only energy and ns-1 species)
-    AMREX_D_TERM(stochface[0].setVal(0.0);,
-                 stochface[1].setVal(0.0);,
-                 stochface[2].setVal(0.0););
-
-    stochedge_x[0].setVal(0.0); stochedge_x[1].setVal(0.0);
-    stochedge_y[0].setVal(0.0); stochedge_y[1].setVal(0.0);
-    stochedge_z[0].setVal(0.0); stochedge_z[1].setVal(0.0);
-
-    AMREX_D_TERM(stochcen[0].setVal(0.0);,
-                 stochcen[1].setVal(0.0);,
-                 stochcen[2].setVal(0.0););
-
-    for (int d=0;d<AMREX_SPACEDIM;d++) {
-	    MultiFab::LinComb(stochface[d], 
-            stoch_weights[0], stochface_A[d], 1, 
-            stoch_weights[1], stochface_B[d], 1,
-            1, nvars-1, 0);
-    }
-    for (int i=0;i<2;i++) {
-        MultiFab::LinComb(stochedge_x[i],
-            stoch_weights[0], stochedge_x_A[i], 0,
-            stoch_weights[1], stochedge_x_B[i], 0,
-            0, 1, 0);
-        MultiFab::LinComb(stochedge_y[i],
-            stoch_weights[0], stochedge_y_A[i], 0,
-            stoch_weights[1], stochedge_y_B[i], 0,
-            0, 1, 0);
-        MultiFab::LinComb(stochedge_z[i],
-            stoch_weights[0], stochedge_z_A[i], 0,
-            stoch_weights[1], stochedge_z_B[i], 0,
-            0, 1, 0);
-    }
-    for (int i=0;i<3;i++) {
-        MultiFab::LinComb(stochcen[i],
-            stoch_weights[0], stochcen_A[i], 0,
-            stoch_weights[1], stochcen_B[i], 0,
-            0, 1, 1);
-    }
+    WeightStochNoiseStag(stochface, stochedge_x, stochedge_y, stochedge_z, stochcen,
+                         stochface_A, stochedge_x_A, stochedge_y_A, stochedge_z_A, stochcen_A,
+                         stochface_B, stochedge_x_B, stochedge_y_B, stochedge_z_B, stochcen_B,
+                         noise, stoch_weights);
     ///////////////////////////////////////////////////////////
     
     calculateFluxStag(cup2, cup2mom, prim, vel, eta, zeta, kappa, chi, D, 
         faceflux, edgeflux_x, edgeflux_y, edgeflux_z, cenflux, 
         stochface, stochedge_x, stochedge_y, stochedge_z, stochcen, 
-        geom, stoch_weights,dt);
+        geom, stoch_weights,dt,noise);
 
     if (nreaction>0) {
         MultiFab::LinComb(ranchem,
@@ -0,0 +1,507 @@
+#include "PoissonFFT.H"
+
+#include "common_functions.H"
+#include "StructFact.H"
+
+PoissonFFT::PoissonFFT (const BoxArray& ba_in,
+                        const DistributionMapping& dmap_in,
+                        const Geometry& geom_in,
+                        const EwaldInfluence* ewald) {
+
+    BL_PROFILE_VAR("PoissonFFT::PoissonFFT()", PoissonFFT);
+
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        if (!geom_in.isPeriodic(d)) {
+            Abort("PoissonFFT: requires a fully periodic domain");
+        }
+    }
+
+    ba = ba_in;
+    dmap = dmap_in;
+    domain = geom_in.Domain();
+
+    fft_type = poisson_fft_type;
+
+    if (fft_type == 1) {
+#if defined(AMREX_USE_CUDA) || !defined(AMREX_USE_MPI)
+        Print() << "PoissonFFT: distributed FFT requires an MPI build with FFTW; using single grid FFT\n";
+        fft_type = 0;
+#endif
+    }
+
+    if (fft_type == 1) {
+        DefineDistributed();
+    } else {
+        DefineSingleGrid();
+    }
+
+    // Green's function of the discrete Laplacian on the local part of the half spectrum
+    // with theta_d = 2 pi m_d / n_d, the symbol of the Laplacian is -sum_d 2 (1 - cos theta_d) / dx_d^2
+    // the mean mode is set to zero, which removes the mean of the right hand side
+    if (green && ewald) {
+        BuildEwaldInfluence(*ewald, geom_in);
+    }
+    else if (green) {
+
+        const GpuArray<Real,AMREX_SPACEDIM> dx = geom_in.CellSizeArray();
+
+        GpuArray<int,3> n {1,1,1};
+        for (int d=0; d<AMREX_SPACEDIM; ++d) {
+            n[d] = domain.length(d);
+        }
+
+        const Real npts_inv = 1./domain.d_numPts();
+
+        const Real pi = 3.1415926535897932;
+
+        Array4<Real> const& g = green->array();
+
+        amrex::ParallelFor(green->box(), [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        {
+            const int m[3] = {i,j,k};
+
+            Real S2 = 0.;
+            for (int d=0; d<AMREX_SPACEDIM; ++d) {
+                S2 += 2.*(1.-std::cos(2.*pi*m[d]/n[d]))/(dx[d]*dx[d]);
+            }
+
+            g(i,j,k) = (S2 == 0.) ? 0. : -npts_inv/S2;
+        });
+
+        Gpu::streamSynchronize();
+    }
+}
+
+// Fourier transform of an even kernel, int phi(s) cos(theta s) ds over [-support,support]
+static Real KernelTransform (const std::function<Real(Real)>& kernel, int support, Real theta)
+{
+    // composite Simpson rule on [0,support]
+    const int nq = 400*support;
+    const Real h = Real(support)/nq;
+
+    Real sum = kernel(0.);
+    for (int q=1; q<=nq; ++q) {
+        Real w = (q == nq) ? 1. : ((q % 2 == 1) ? 4. : 2.);
+        sum += w*kernel(q*h)*std::cos(theta*q*h);
+    }
+
+    return 2.*sum*h/3.;
+}
+
+// optimal influence function for the long range part of an Ewald split (P3M)
+// with k_a the aliases k + 2 pi a/dx, U_s and U_i the transforms of the spreading and interpolation
+// kernels, R(k) = k exp(-k^2/(4 alpha^2))/k^2 the reference field and D(k) = sin(k dx)/dx the symbol
+// of the centred difference,
+//   G(k) = - D(k).sum_a U_s(k_a) U_i(k_a) R(k_a) / ( |D(k)|^2 sum_a U_s(k_a)^2 sum_a U_i(k_a)^2 )
+// the kernels act per direction, so the alias sums in the denominator factorize
+void PoissonFFT::BuildEwaldInfluence (const EwaldInfluence& ewald, const Geometry& geom_in) {
+
+    BL_PROFILE_VAR("PoissonFFT::BuildEwaldInfluence()", PoissonFFT_BuildEwaldInfluence);
+
+    if (ewald.alpha <= 0.) {
+        Abort("PoissonFFT: the Ewald splitting parameter has to be positive");
+    }
+
+    const GpuArray<Real,AMREX_SPACEDIM> dx = geom_in.CellSizeArray();
+
+    GpuArray<int,3> n {1,1,1};
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        n[d] = domain.length(d);
+    }
+
+    const Real npts_inv = 1./domain.d_numPts();
+    const Real inv4a2 = 1./(4.*ewald.alpha*ewald.alpha);
+
+    const Real pi = 3.1415926535897932;
+
+    // number of aliases on either side of the principal one
+    const int nalias = 2;
+    const int nwidth = 2*nalias+1;
+
+    // per direction: U_s*U_i for every alias and mode, and the alias sums of U_s^2 and U_i^2
+    GpuArray<int,3> off_alias {0,0,0};
+    GpuArray<int,3> off_mode {0,0,0};
+    int nalias_tot = 0;
+    int nmode_tot = 0;
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        off_alias[d] = nalias_tot;
+        off_mode[d] = nmode_tot;
+        nalias_tot += nwidth*n[d];
+        nmode_tot += n[d];
+    }
+
+    Vector<Real> usi_h(nalias_tot);
+    Vector<Real> uss_h(nmode_tot,0.);
+    Vector<Real> uii_h(nmode_tot,0.);
+
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        for (int m=0; m<n[d]; ++m) {
+            const int ms = (m <= n[d]/2) ? m : m-n[d];
+            for (int a=0; a<nwidth; ++a) {
+                // wavenumber times dx of this alias
+                Real theta = 2.*pi*(ms + (a-nalias)*n[d])/n[d];
+                Real us = KernelTransform(ewald.spread_kernel, ewald.support, theta);
+                Real ui = KernelTransform(ewald.interp_kernel, ewald.support, theta);
+                usi_h[off_alias[d] + a*n[d] + m] = us*ui;
+                uss_h[off_mode[d] + m] += us*us;
+                uii_h[off_mode[d] + m] += ui*ui;
+            }
+        }
+    }
+
+    Gpu::DeviceVector<Real> usi_d(nalias_tot);
+    Gpu::DeviceVector<Real> uss_d(nmode_tot);
+    Gpu::DeviceVector<Real> uii_d(nmode_tot);
+    Gpu::copy(Gpu::hostToDevice, usi_h.begin(), usi_h.end(), usi_d.begin());
+    Gpu::copy(Gpu::hostToDevice, uss_h.begin(), uss_h.end(), uss_d.begin());
+    Gpu::copy(Gpu::hostToDevice, uii_h.begin(), uii_h.end(), uii_d.begin());
+
+    const Real* usi = usi_d.dataPtr();
+    const Real* uss = uss_d.dataPtr();
+    const Real* uii = uii_d.dataPtr();
+
+    int ncombo = 1;
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        ncombo *= nwidth;
+    }
+
+    Array4<Real> const& g = green->array();
+
+    amrex::ParallelFor(green->box(), [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+    {
+        const int m[3] = {i,j,k};
+
+        Real D[3] = {0.,0.,0.};
+        Real D2 = 0.;
+        Real denom = 1.;
+        int ms[3] = {0,0,0};
+        for (int d=0; d<AMREX_SPACEDIM; ++d) {
+            ms[d] = (m[d] <= n[d]/2) ? m[d] : m[d]-n[d];
+            D[d] = std::sin(2.*pi*m[d]/n[d])/dx[d];
+            D2 += D[d]*D[d];
+            denom *= uss[off_mode[d]+m[d]]*uii[off_mode[d]+m[d]];
+        }
+
+        // the mean mode and the modes the centred difference cannot see
+        if (D2 == 0. || denom == 0.) {
+            g(i,j,k) = 0.;
+            return;
+        }
+
+        Real num = 0.;
+        for (int c=0; c<ncombo; ++c) {
+            int rem = c;
+            Real ka2 = 0.;
+            Real Dka = 0.;
+            Real u = 1.;
+            for (int d=0; d<AMREX_SPACEDIM; ++d) {
+                const int a = rem % nwidth;
+                rem /= nwidth;
+                Real ka = 2.*pi*(ms[d] + (a-nalias)*n[d])/(n[d]*dx[d]);
+                ka2 += ka*ka;
+                Dka += D[d]*ka;
+                u *= usi[off_alias[d] + a*n[d] + m[d]];
+            }
+            num += u*Dka*std::exp(-ka2*inv4a2)/ka2;
+        }
+
+        g(i,j,k) = -npts_inv*num/(D2*denom);
+    });
+
+    Gpu::streamSynchronize();
+}
+
+void PoissonFFT::DefineSingleGrid () {
+
+    ba_fft.define(domain);
+    dmap_fft.define(ba_fft);
+
+    phi_fft.define(ba_fft, dmap_fft, 1, 0);
+
+    // only the rank that owns the single grid enters this loop
+    for (MFIter mfi(phi_fft); mfi.isValid(); ++mfi) {
+
+        IntVect fft_size = domain.length();
+
+        // the 0th component is 'halved plus 1' for the real-to-complex transform
+        IntVect spectral_size = fft_size;
+        spectral_size[0] = fft_size[0]/2 + 1;
+        Box spectral_bx(IntVect(0), spectral_size - IntVect(1));
+
+        spectral_field = std::make_unique<BaseFab<GpuComplex<Real> > >(spectral_bx, 1,
+                                                                       The_Device_Arena());
+        green = std::make_unique<BaseFab<Real> >(spectral_bx, 1, The_Device_Arena());
+
+        // FFTW and cuFFT are row-major, so the dimensions are reversed compared to AMReX
+        int n[AMREX_SPACEDIM];
+        for (int d=0; d<AMREX_SPACEDIM; ++d) {
+            n[d] = fft_size[AMREX_SPACEDIM-1-d];
+        }
+
+#ifdef AMREX_USE_CUDA
+        int rdist = domain.numPts();
+        int cdist = spectral_bx.numPts();
+
+        cufftResult result = cufftPlanMany(&forward_plan, AMREX_SPACEDIM, n,
+                                           NULL, 1, rdist,
+                                           NULL, 1, cdist,
+                                           CUFFT_D2Z, 1);
+        if (result != CUFFT_SUCCESS) {
+            Abort("PoissonFFT: cufftPlanMany forward failed");
+        }
+        result = cufftPlanMany(&backward_plan, AMREX_SPACEDIM, n,
+                               NULL, 1, cdist,
+                               NULL, 1, rdist,
+                               CUFFT_Z2D, 1);
+        if (result != CUFFT_SUCCESS) {
+            Abort("PoissonFFT: cufftPlanMany backward failed");
+        }
+#else
+        forward_plan = fftw_plan_dft_r2c(AMREX_SPACEDIM, n,
+                                         phi_fft[mfi].dataPtr(),
+                                         reinterpret_cast<fftw_complex*>
+                                         (spectral_field->dataPtr()),
+                                         FFTW_ESTIMATE);
+        backward_plan = fftw_plan_dft_c2r(AMREX_SPACEDIM, n,
+                                          reinterpret_cast<fftw_complex*>
+                                          (spectral_field->dataPtr()),
+                                          phi_fft[mfi].dataPtr(),
+                                          FFTW_ESTIMATE);
+#endif
+        have_plans = true;
+    }
+}
+
+// slab decomposition of fftw3-mpi, built the same way as for StructFact with struct_fact_fft_type = 1
+// (poisson_fft_type = 1)
+void PoissonFFT::DefineDistributed () {
+
+#if !defined(AMREX_USE_CUDA) && defined(AMREX_USE_MPI)
+    InitFFTWMPI();
+
+    MPI_Comm comm = ParallelDescriptor::Communicator();
+
+    // the slowest direction is split into slabs
+    const int slab_dir = AMREX_SPACEDIM-1;
+
+    // FFTW is row-major, so the dimensions are reversed compared to AMReX
+    // n_cplx is the size of the complex output, which is halved in the fastest direction
+    ptrdiff_t n_real[AMREX_SPACEDIM];
+    ptrdiff_t n_cplx[AMREX_SPACEDIM];
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        n_real[d] = domain.length(AMREX_SPACEDIM-1-d);
+        n_cplx[d] = n_real[d];
+    }
+    n_cplx[AMREX_SPACEDIM-1] = n_real[AMREX_SPACEDIM-1]/2 + 1;
+
+    ptrdiff_t local_n0, local_0_start;
+    ptrdiff_t alloc_local = fftw_mpi_local_size_many(AMREX_SPACEDIM, n_cplx, 1, FFTW_MPI_DEFAULT_BLOCK,
+                                                     comm, &local_n0, &local_0_start);
+
+    // every rank needs the full slab decomposition to build the BoxArray
+    int nprocs = ParallelDescriptor::NProcs();
+    Vector<long> slab_n0(nprocs);
+    Vector<long> slab_start(nprocs);
+    long my_n0    = local_n0;
+    long my_start = local_0_start;
+    MPI_Allgather(&my_n0   , 1, MPI_LONG, slab_n0.dataPtr()   , 1, MPI_LONG, comm);
+    MPI_Allgather(&my_start, 1, MPI_LONG, slab_start.dataPtr(), 1, MPI_LONG, comm);
+
+    // ranks with an empty slab do not own a box
+    BoxList bl_slab;
+    Vector<int> pmap_slab;
+    for (int p=0; p<nprocs; ++p) {
+        if (slab_n0[p] > 0) {
+            Box bx = domain;
+            bx.setSmall(slab_dir, domain.smallEnd(slab_dir) + slab_start[p]);
+            bx.setBig  (slab_dir, domain.smallEnd(slab_dir) + slab_start[p] + slab_n0[p] - 1);
+            bl_slab.push_back(bx);
+            pmap_slab.push_back(p);
+        }
+    }
+    ba_fft.define(bl_slab);
+    dmap_fft.define(pmap_slab);
+
+    phi_fft.define(ba_fft, dmap_fft, 1, 0);
+
+    // the local output is ordered like the local slab of the half spectrum, in wavenumber indices
+    if (local_n0 > 0) {
+        IntVect spectral_size = domain.length();
+        spectral_size[0] = spectral_size[0]/2 + 1;
+        Box spectral_bx(IntVect(0), spectral_size - IntVect(1));
+        spectral_bx.setSmall(slab_dir, local_0_start);
+        spectral_bx.setBig  (slab_dir, local_0_start + local_n0 - 1);
+
+        green = std::make_unique<BaseFab<Real> >(spectral_bx, 1);
+    }
+
+    // FFTW work arrays; the rows of the real input are padded to 2*(nx/2+1)
+    fft_in  = fftw_alloc_real   (std::max(2*alloc_local,ptrdiff_t(1)));
+    fft_out = fftw_alloc_complex(std::max(  alloc_local,ptrdiff_t(1)));
+
+    // the plans are collective, so every rank has to build them, even ranks without a slab
+    dist_forward_plan  = fftw_mpi_plan_many_dft_r2c(AMREX_SPACEDIM, n_real, 1,
+                                                    FFTW_MPI_DEFAULT_BLOCK, FFTW_MPI_DEFAULT_BLOCK,
+                                                    fft_in, fft_out, comm, FFTW_ESTIMATE);
+    dist_backward_plan = fftw_mpi_plan_many_dft_c2r(AMREX_SPACEDIM, n_real, 1,
+                                                    FFTW_MPI_DEFAULT_BLOCK, FFTW_MPI_DEFAULT_BLOCK,
+                                                    fft_out, fft_in, comm, FFTW_ESTIMATE);
+#else
+    Abort("PoissonFFT::DefineDistributed() - requires an MPI build with FFTW");
+#endif
+}
+
+PoissonFFT::~PoissonFFT () {
+
+    if (have_plans) {
+#ifdef AMREX_USE_CUDA
+        cufftDestroy(forward_plan);
+        cufftDestroy(backward_plan);
+#else
+        fftw_destroy_plan(forward_plan);
+        fftw_destroy_plan(backward_plan);
+#endif
+    }
+
+#ifndef AMREX_USE_CUDA
+    if (dist_forward_plan)  fftw_destroy_plan(dist_forward_plan);
+    if (dist_backward_plan) fftw_destroy_plan(dist_backward_plan);
+    if (fft_in)  fftw_free(fft_in);
+    if (fft_out) fftw_free(fft_out);
+#endif
+}
+
+bool PoissonFFT::DefinedOn (const BoxArray& ba_in,
+                            const DistributionMapping& dmap_in,
+                            const Geometry& geom_in) const {
+
+    return ba == ba_in && dmap == dmap_in && domain == geom_in.Domain();
+}
+
+void PoissonFFT::Solve (MultiFab& phi,
+                        const MultiFab& rhs,
+                        const Geometry& geom) {
+
+    BL_PROFILE_VAR("PoissonFFT::Solve()", PoissonFFT_Solve);
+
+    if (geom.Domain() != domain) {
+        Abort("PoissonFFT::Solve() - domain does not match the one used to build the solver");
+    }
+
+    phi_fft.ParallelCopy(rhs, 0, 0, 1);
+
+    if (fft_type == 1) {
+        SolveDistributed();
+    } else {
+
+        for (MFIter mfi(phi_fft); mfi.isValid(); ++mfi) {
+
+#ifdef AMREX_USE_CUDA
+            cufftSetStream(forward_plan, Gpu::gpuStream());
+            cufftResult result = cufftExecD2Z(forward_plan, phi_fft[mfi].dataPtr(),
+                                              reinterpret_cast<cuDoubleComplex*>
+                                              (spectral_field->dataPtr()));
+            if (result != CUFFT_SUCCESS) {
+                Abort("PoissonFFT: forward transform using cufftExec failed");
+            }
+#else
+            fftw_execute(forward_plan);
+#endif
+
+            Array4<GpuComplex<Real> > const& spectral = spectral_field->array();
+            Array4<Real const> const& g = green->const_array();
+
+            amrex::ParallelFor(spectral_field->box(), [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+            {
+                spectral(i,j,k) = spectral(i,j,k)*g(i,j,k);
+            });
+
+#ifdef AMREX_USE_CUDA
+            cufftSetStream(backward_plan, Gpu::gpuStream());
+            result = cufftExecZ2D(backward_plan,
+                                  reinterpret_cast<cuDoubleComplex*>(spectral_field->dataPtr()),
+                                  phi_fft[mfi].dataPtr());
+            if (result != CUFFT_SUCCESS) {
+                Abort("PoissonFFT: backward transform using cufftExec failed");
+            }
+#else
+            fftw_execute(backward_plan);
+#endif
+        }
+    }
+
+    phi.ParallelCopy(phi_fft, 0, 0, 1);
+}
+
+// the transforms of the distributed path run on the host, like StructFact::ComputeSpectrumDistributed
+void PoissonFFT::SolveDistributed () {
+
+#if defined(AMREX_USE_CUDA) || !defined(AMREX_USE_MPI)
+    Abort("PoissonFFT::SolveDistributed() - requires an MPI build with FFTW");
+#else
+
+    BL_PROFILE_VAR("PoissonFFT::SolveDistributed()", PoissonFFT_SolveDistributed);
+
+    // length of a row of the real input, and of a padded row
+    long nx     = domain.length(0);
+    long nx_pad = 2*(nx/2+1);
+
+    for (MFIter mfi(phi_fft); mfi.isValid(); ++mfi) {
+        const Real* phi_ptr = phi_fft[mfi].dataPtr();
+        long nbx = mfi.validbox().numPts();
+        for (long m=0; m<nbx; ++m) {
+            long row = m / nx;
+            long i   = m - row*nx;
+            fft_in[row*nx_pad + i] = phi_ptr[m];
+        }
+    }
+
+    // ForwardTransform (collective)
+    fftw_execute(dist_forward_plan);
+
+    if (green) {
+        const Real* g = green->dataPtr();
+        long nspec = green->box().numPts();
+        for (long m=0; m<nspec; ++m) {
+            fft_out[m][0] *= g[m];
+            fft_out[m][1] *= g[m];
+        }
+    }
+
+    // BackwardTransform (collective)
+    fftw_execute(dist_backward_plan);
+
+    for (MFIter mfi(phi_fft); mfi.isValid(); ++mfi) {
+        Real* phi_ptr = phi_fft[mfi].dataPtr();
+        long nbx = mfi.validbox().numPts();
+        for (long m=0; m<nbx; ++m) {
+            long row = m / nx;
+            long i   = m - row*nx;
+            phi_ptr[m] = fft_in[row*nx_pad + i];
+        }
+    }
+
+#endif
+}
+
+PoissonFFT& PersistentPoissonFFT (const BoxArray& ba_in,
+                                  const DistributionMapping& dmap_in,
+                                  const Geometry& geom_in) {
+
+    static std::unique_ptr<PoissonFFT> poisson_fft;
+    static bool registered = false;
+
+    if (!poisson_fft || !poisson_fft->DefinedOn(ba_in,dmap_in,geom_in)) {
+        // free the old solver before building the new one
+        poisson_fft.reset();
+        poisson_fft = std::make_unique<PoissonFFT>(ba_in,dmap_in,geom_in);
+    }
+
+    if (!registered) {
+        // the MultiFabs have to be freed before AMReX shuts down its memory arenas
+        amrex::ExecOnFinalize([] () { poisson_fft.reset(); registered = false; });
+        registered = true;
+    }
+
+    return *poisson_fft;
+}
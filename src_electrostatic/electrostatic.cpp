@@ -1,12 +1,250 @@
 #include "electrostatic.H"
+#include "PoissonFFT.H"
 #include "common_functions.H"
 #include <AMReX_MLMG.H>
 
+#include <memory>
+
 using namespace amrex;
 
+// Poisson operator and MLMG solver kept across calls to esSolve, so the multigrid hierarchy
+// and the bottom solver are only set up again when the grids change
+// the operator has constant coefficients (the permittivity is folded into the charge) and
+// the boundary condition types are fixed for the run, so nothing else triggers a rebuild
+struct PersistentPoisson {
+    BoxArray ba;
+    DistributionMapping dmap;
+    Box domain;
+    std::unique_ptr<MLPoisson> linop;
+    std::unique_ptr<MLMG> mlmg;
+};
+
+static PersistentPoisson es_poisson;
+
+// long range part of P3M with Ewald splitting (es_tog = 4)
+// x and z are periodic; in y the charge is copied into a periodic box that is
+//   as tall as the domain if y is periodic,
+//   twice as tall with the mirror image of the charge for homogeneous Dirichlet (odd mirror)
+//   or Neumann (even mirror) walls on both sides,
+//   ewald_slab_factor times as tall with vacuum above the charge for open walls (bc_es = 0),
+//   together with the slab dipole correction of Yeh & Berkowitz
+struct PersistentEwald {
+    BoxArray ba;
+    DistributionMapping dmap;
+    Box domain;
+    Geometry geom_ext;
+    MultiFab rhs_ext;
+    MultiFab phi_ext;
+    // charge reflected about the upper y wall, on the same ranks as the charge
+    MultiFab rhs_mirror;
+    Real mirror = 0.;
+    bool open_slab = false;
+    std::unique_ptr<PoissonFFT> fft;
+};
+
+static PersistentEwald es_ewald;
+
+// height of the periodic box in units of the domain height for open walls
+static constexpr int ewald_slab_factor = 3;
+
+static void EwaldLongRange(MultiFab& potential, const MultiFab& charge,
+                           std::array< MultiFab, AMREX_SPACEDIM >& efieldCC,
+                           const Geometry& geom, const EwaldInfluence& ewald)
+{
+    BL_PROFILE_VAR("EwaldLongRange()",EwaldLongRange);
+
+    const BoxArray& ba = charge.boxArray();
+    const DistributionMapping& dmap = charge.DistributionMap();
+    const Box& domain = geom.Domain();
+
+    if (!es_ewald.fft || !(es_ewald.ba == ba) || !(es_ewald.dmap == dmap) || es_ewald.domain != domain) {
+
+        if (!es_ewald.fft) {
+            amrex::ExecOnFinalize([] () {
+                es_ewald.fft.reset();
+                es_ewald.rhs_ext.clear();
+                es_ewald.phi_ext.clear();
+                es_ewald.rhs_mirror.clear();
+            });
+        }
+
+        if (bc_es_lo[0] != -1 || bc_es_hi[0] != -1 ||
+            (AMREX_SPACEDIM == 3 && (bc_es_lo[AMREX_SPACEDIM-1] != -1 || bc_es_hi[AMREX_SPACEDIM-1] != -1))) {
+            Abort("es_tog = 4 requires periodic bc_es in x and z");
+        }
+
+        int factor;
+        es_ewald.mirror = 0.;
+        es_ewald.open_slab = false;
+        if (bc_es_lo[1] == -1 && bc_es_hi[1] == -1) {
+            factor = 1;
+        }
+        else if (bc_es_lo[1] == 1 && bc_es_hi[1] == 1) {
+            factor = 2;
+            es_ewald.mirror = -1.;
+        }
+        else if (bc_es_lo[1] == 2 && bc_es_hi[1] == 2) {
+            // a linear potential only carries the same imposed field on both walls
+            if (potential_lo[1] != potential_hi[1]) {
+                Abort("es_tog = 4 with Neumann walls in y requires potential_lo[1] == potential_hi[1]");
+            }
+            factor = 2;
+            es_ewald.mirror = 1.;
+        }
+        else if (bc_es_lo[1] == 0 && bc_es_hi[1] == 0) {
+            if (potential_lo[1] != 0. || potential_hi[1] != 0.) {
+                Abort("es_tog = 4 with open walls in y requires potential_lo[1] = potential_hi[1] = 0");
+            }
+            factor = ewald_slab_factor;
+            es_ewald.open_slab = true;
+        }
+        else {
+            Abort("es_tog = 4 requires bc_es in y to be periodic, or the same on both walls (0, 1 or 2)");
+        }
+
+        const int ny = domain.length(1);
+
+        Box domain_ext(domain);
+        domain_ext.setBig(1, domain.smallEnd(1) + factor*ny - 1);
+
+        RealBox rb_ext(geom.ProbLo(), geom.ProbHi());
+        rb_ext.setHi(1, geom.ProbLo(1) + factor*(geom.ProbHi(1) - geom.ProbLo(1)));
+
+        Vector<int> is_periodic(AMREX_SPACEDIM,1);
+        es_ewald.geom_ext.define(domain_ext, &rb_ext, CoordSys::cartesian, is_periodic.data());
+
+        // grids of the extended box no larger than the ones of the charge
+        IntVect max_size(0);
+        for (int b=0; b<ba.size(); ++b) {
+            max_size.max(ba[b].length());
+        }
+        BoxArray ba_ext(domain_ext);
+        ba_ext.maxSize(max_size);
+        DistributionMapping dmap_ext(ba_ext);
+
+        es_ewald.fft.reset();
+        es_ewald.rhs_ext.define(ba_ext, dmap_ext, 1, 0);
+        es_ewald.phi_ext.define(ba_ext, dmap_ext, 1, 0);
+
+        if (es_ewald.mirror != 0.) {
+            BoxList bl_mirror;
+            for (int b=0; b<ba.size(); ++b) {
+                Box bx = ba[b];
+                const int top = 2*domain.smallEnd(1) + 2*ny - 1;
+                bx.setSmall(1, top - ba[b].bigEnd(1));
+                bx.setBig  (1, top - ba[b].smallEnd(1));
+                bl_mirror.push_back(bx);
+            }
+            es_ewald.rhs_mirror.define(BoxArray(bl_mirror), dmap, 1, 0);
+        }
+        else {
+            es_ewald.rhs_mirror.clear();
+        }
+
+        es_ewald.fft = std::make_unique<PoissonFFT>(ba_ext, dmap_ext, es_ewald.geom_ext, &ewald);
+
+        es_ewald.ba = ba;
+        es_ewald.dmap = dmap;
+        es_ewald.domain = domain;
+    }
+
+    MultiFab& rhs_ext = es_ewald.rhs_ext;
+    MultiFab& phi_ext = es_ewald.phi_ext;
+
+    rhs_ext.setVal(0.);
+    rhs_ext.ParallelCopy(charge, 0, 0, 1);
+
+    if (es_ewald.mirror != 0.) {
+        MultiFab& rhs_mirror = es_ewald.rhs_mirror;
+        const int top = 2*domain.smallEnd(1) + 2*domain.length(1) - 1;
+        const Real mirror = es_ewald.mirror;
+        for (MFIter mfi(rhs_mirror,TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+            const Box& bx = mfi.tilebox();
+            const Array4<Real> m = rhs_mirror.array(mfi);
+            const Array4<Real const> c = charge.const_array(mfi);
+            amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+            {
+                m(i,j,k) = mirror*c(i,top-j,k);
+            });
+        }
+        rhs_ext.ParallelCopy(rhs_mirror, 0, 0, 1);
+    }
+
+    es_ewald.fft->Solve(phi_ext, rhs_ext, es_ewald.geom_ext);
+
+    // the ghost cells of the potential come from the periodic extension, which holds
+    // the mirrored potential for walls and the potential in the vacuum for open walls
+    potential.ParallelCopy(phi_ext, 0, 0, 1, 0, potential.nGrow(), es_ewald.geom_ext.periodicity());
+
+    //Find e field, gradient from cell centers to faces
+    ComputeCentredGrad(potential, efieldCC, geom);
+
+    // the mirrors give the solution for homogeneous walls; add the linear potential that
+    // carries the wall values, potential_lo/hi for Dirichlet and the wall field for Neumann walls
+    if (es_ewald.mirror != 0.) {
+
+        const int jlo = geom.Domain().smallEnd(1);
+        const Real dy = geom.CellSize(1);
+        Real base, slope;
+        if (es_ewald.mirror < 0.) {
+            base = potential_lo[1];
+            slope = (potential_hi[1] - potential_lo[1])/geom.ProbLength(1);
+        }
+        else {
+            base = 0.;
+            slope = potential_lo[1];
+        }
+
+        if (base != 0. || slope != 0.) {
+            for (MFIter mfi(potential,TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+                const Box& bx = mfi.growntilebox();
+                const Array4<Real> phi = potential.array(mfi);
+                amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+                {
+                    phi(i,j,k) += base + slope*(j-jlo+0.5)*dy;
+                });
+            }
+            // efieldCC holds grad(phi) here
+            efieldCC[1].plus(slope, 0, 1, efieldCC[1].nGrow());
+        }
+    }
+
+    if (es_ewald.open_slab) {
+
+        // dipole moment of the charge in y; the charge holds -q/permittivity per volume
+        const Real dy = geom.CellSize(1);
+        const Real ylo = geom.ProbLo(1);
+        const int jlo = geom.Domain().smallEnd(1);
+        ReduceOps<ReduceOpSum> reduce_op;
+        ReduceData<Real> reduce_data(reduce_op);
+        using ReduceTuple = typename decltype(reduce_data)::Type;
+        for (MFIter mfi(charge,TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+            const Box& bx = mfi.tilebox();
+            const Array4<Real const> c = charge.const_array(mfi);
+            reduce_op.eval(bx, reduce_data,
+            [=] AMREX_GPU_DEVICE (int i, int j, int k) -> ReduceTuple
+            {
+                return {c(i,j,k)*(ylo + (j-jlo+0.5)*dy)};
+            });
+        }
+        Real dipole = amrex::get<0>(reduce_data.value());
+        ParallelDescriptor::ReduceRealSum(dipole);
+
+        const Real* dx = geom.CellSize();
+        dipole *= AMREX_D_TERM(dx[0],*dx[1],*dx[2]);
+
+        // uniform field -M_y/(permittivity V) of the extended box; efieldCC holds grad(phi) here
+        const Real vol_ext = AMREX_D_TERM(es_ewald.geom_ext.ProbLength(0),
+                                          *es_ewald.geom_ext.ProbLength(1),
+                                          *es_ewald.geom_ext.ProbLength(2));
+        efieldCC[1].plus(-dipole/vol_ext, 0, 1, efieldCC[1].nGrow());
+    }
+}
+
 void esSolve(MultiFab& potential, MultiFab& charge,
              std::array< MultiFab, AMREX_SPACEDIM >& efieldCC,
-             const std::array< MultiFab, AMREX_SPACEDIM >& external, const Geometry geom)
+             const std::array< MultiFab, AMREX_SPACEDIM >& external, const Geometry geom,
+             const EwaldInfluence* ewald)
 {
     BL_PROFILE_VAR("esSolve()",esSolve);
 
@@ -17,70 +255,108 @@ void esSolve(MultiFab& potential, MultiFab& charge,
     if(es_tog==1 || es_tog==3)
     {
 
-        LinOpBCType lo_linop_bc[3];
-        LinOpBCType hi_linop_bc[3];
-
+        bool all_periodic = true;
         for (int i=0; i<AMREX_SPACEDIM; ++i) {
-            if (bc_es_lo[i] == -1 && bc_es_hi[i] == -1) {
-                lo_linop_bc[i] = LinOpBCType::Periodic;
-                hi_linop_bc[i] = LinOpBCType::Periodic;
+            if (bc_es_lo[i] != -1 || bc_es_hi[i] != -1) {
+                all_periodic = false;
             }
-            if(bc_es_lo[i] == 2)
-            {
-                lo_linop_bc[i] = LinOpBCType::inhomogNeumann;
+        }
+
+        if (poisson_solver_type == 1 && all_periodic) {
+
+            // direct solve with the Green's function of the same discrete Laplacian
+            PoissonFFT& poisson_fft = PersistentPoissonFFT(charge.boxArray(), charge.DistributionMap(), geom);
+            poisson_fft.Solve(potential, charge, geom);
+
+        } else {
+
+            LinOpBCType lo_linop_bc[3];
+            LinOpBCType hi_linop_bc[3];
+
+            for (int i=0; i<AMREX_SPACEDIM; ++i) {
+                if (bc_es_lo[i] == -1 && bc_es_hi[i] == -1) {
+                    lo_linop_bc[i] = LinOpBCType::Periodic;
+                    hi_linop_bc[i] = LinOpBCType::Periodic;
+                }
+                if(bc_es_lo[i] == 2)
+                {
+                    lo_linop_bc[i] = LinOpBCType::inhomogNeumann;
 //                lo_linop_bc[i] = LinOpBCType::Neumann;
-            }
-            if(bc_es_hi[i] == 2)
-            {
-                hi_linop_bc[i] = LinOpBCType::inhomogNeumann;
+                }
+                if(bc_es_hi[i] == 2)
+                {
+                    hi_linop_bc[i] = LinOpBCType::inhomogNeumann;
 //                hi_linop_bc[i] = LinOpBCType::Neumann;
+                }
+                if(bc_es_lo[i] == 1)
+                {                 
+                    lo_linop_bc[i] = LinOpBCType::Dirichlet;
+                }
+                if(bc_es_hi[i] == 1)
+                {
+                    hi_linop_bc[i] = LinOpBCType::Dirichlet;
+                }
             }
-            if(bc_es_lo[i] == 1)
-            {                 
-                lo_linop_bc[i] = LinOpBCType::Dirichlet;
-            }
-            if(bc_es_hi[i] == 1)
-            {
-                hi_linop_bc[i] = LinOpBCType::Dirichlet;
-            }
-        }
 
-        const BoxArray& ba = charge.boxArray();
-        const DistributionMapping& dmap = charge.DistributionMap();
+            const BoxArray& ba = charge.boxArray();
+            const DistributionMapping& dmap = charge.DistributionMap();
+
+            if (!es_poisson.linop || !(es_poisson.ba == ba) || !(es_poisson.dmap == dmap) ||
+                es_poisson.domain != geom.Domain()) {
 
-        //create solver opject
-        MLPoisson linop({geom}, {ba}, {dmap});
- 
-        //set BCs
-        linop.setDomainBC({AMREX_D_DECL(lo_linop_bc[0],
-                                        lo_linop_bc[1],
-                                        lo_linop_bc[2])},
-                          {AMREX_D_DECL(hi_linop_bc[0],
-                                        hi_linop_bc[1],
-                                        hi_linop_bc[2])});
+                if (!es_poisson.linop) {
+                    // the solver has to be freed before AMReX shuts down its memory arenas
+                    amrex::ExecOnFinalize([] () { es_poisson.mlmg.reset(); es_poisson.linop.reset(); });
+                }
 
-        // fill in ghost cells with Dirichlet/Neumann values
-        // the ghost cells will hold the value ON the boundary
-        MultiFabPotentialBC_solver(potential,geom);
+                es_poisson.mlmg.reset();
 
-        // tell MLPoisson about these potentially inhomogeneous BC values
-        linop.setLevelBC(0, &potential);
+                //create solver opject
+                es_poisson.linop = std::make_unique<MLPoisson>(Vector<Geometry>{geom},
+                                                               Vector<BoxArray>{ba},
+                                                               Vector<DistributionMapping>{dmap});
 
-        // this forces the solver to NOT enforce solvability
-        // thus if there are Neumann conditions on phi they must
-        // be correct or the Poisson solver won't converge
-        linop.setEnforceSingularSolvable(false);
+                //set BCs
+                es_poisson.linop->setDomainBC({AMREX_D_DECL(lo_linop_bc[0],
+                                                            lo_linop_bc[1],
+                                                            lo_linop_bc[2])},
+                                              {AMREX_D_DECL(hi_linop_bc[0],
+                                                            hi_linop_bc[1],
+                                                            hi_linop_bc[2])});
 
-        //Multi Level Multi Grid
-        MLMG mlmg(linop);
+                // this forces the solver to NOT enforce solvability
+                // thus if there are Neumann conditions on phi they must
+                // be correct or the Poisson solver won't converge
+                es_poisson.linop->setEnforceSingularSolvable(false);
 
-        //Solver parameters
-        mlmg.setMaxIter(poisson_max_iter);
-        mlmg.setVerbose(poisson_verbose);
-        mlmg.setBottomVerbose(poisson_bottom_verbose);
+                //Multi Level Multi Grid
+                es_poisson.mlmg = std::make_unique<MLMG>(*es_poisson.linop);
+
+                es_poisson.ba = ba;
+                es_poisson.dmap = dmap;
+                es_poisson.domain = geom.Domain();
+            }
+
+            MLPoisson& linop = *es_poisson.linop;
+            MLMG& mlmg = *es_poisson.mlmg;
+
+            // fill in ghost cells with Dirichlet/Neumann values
+            // the ghost cells will hold the value ON the boundary
+            MultiFabPotentialBC_solver(potential,geom);
+
+            // tell MLPoisson about these potentially inhomogeneous BC values
+            linop.setLevelBC(0, &potential);
+
+            //Solver parameters
+            mlmg.setMaxIter(poisson_max_iter);
+            mlmg.setVerbose(poisson_verbose);
+            mlmg.setBottomVerbose(poisson_bottom_verbose);
         
-        //Do solve
-        mlmg.solve({&potential}, {&charge}, poisson_rel_tol, 0.0);
+            //Do solve
+            // potential still holds the solution of the previous step, which is used as the
+            // initial guess since the charge only changes a little from step to step
+            mlmg.solve({&potential}, {&charge}, poisson_rel_tol, 0.0);
+        }
             
         potential.FillBoundary(geom.periodicity());
         // set ghost cell values so electric field is calculated properly
@@ -92,6 +368,13 @@ void esSolve(MultiFab& potential, MultiFab& charge,
         
 
     }
+    else if (es_tog==4)
+    {
+        if (!ewald) {
+            Abort("esSolve: es_tog = 4 requires the Ewald splitting parameter and kernels");
+        }
+        EwaldLongRange(potential, charge, efieldCC, geom, *ewald);
+    }
 
     //Add external field on top, then fill boundaries, then setup BCs for peskin interpolation
     for (int d=0; d<AMREX_SPACEDIM; ++d) {
@@ -1,10 +1,16 @@
 #include "GMRES.H"
 
+#include <memory>
+
 GMRES::GMRES (const BoxArray& ba_in,
               const DistributionMapping& dmap_in,
               const Geometry& geom_in) {
 
     BL_PROFILE_VAR("GMRES::GMRES()", GMRES);
+
+    ba = ba_in;
+    dmap = dmap_in;
+    domain = geom_in.Domain();
     
     for (int d=0; d<AMREX_SPACEDIM; ++d) {
         r_u[d]        .define(convert(ba_in, nodal_flag_dir[d]), dmap_in, 1,                 1);
@@ -21,10 +27,46 @@ GMRES::GMRES (const BoxArray& ba_in,
     scr_p.define(ba_in, dmap_in,                  1, 0);
     V_p.define  (ba_in, dmap_in,gmres_max_inner + 1, 0); // Krylov vectors
 
+    if (gmres_orthogonalization == 3) {
+        for (int d=0; d<AMREX_SPACEDIM; ++d) {
+            Z_u[d].define(convert(ba_in, nodal_flag_dir[d]), dmap_in, gmres_max_inner+1, 0);
+        }
+        Z_p.define(ba_in, dmap_in, gmres_max_inner+1, 0);
+    }
+
     StagSolver.Define(ba_in,dmap_in,geom_in);
     Pcon.Define(ba_in,dmap_in,geom_in);
 }
 
+bool GMRES::DefinedOn (const BoxArray& ba_in,
+                       const DistributionMapping& dmap_in,
+                       const Geometry& geom_in) const {
+
+    return ba == ba_in && dmap == dmap_in && domain == geom_in.Domain();
+}
+
+GMRES& PersistentGMRES (const BoxArray& ba_in,
+                        const DistributionMapping& dmap_in,
+                        const Geometry& geom_in) {
+
+    static std::unique_ptr<GMRES> gmres;
+    static bool registered = false;
+
+    if (!gmres || !gmres->DefinedOn(ba_in,dmap_in,geom_in)) {
+        // free the old solver before building the new one
+        gmres.reset();
+        gmres = std::make_unique<GMRES>(ba_in,dmap_in,geom_in);
+    }
+
+    if (!registered) {
+        // the MultiFabs have to be freed before AMReX shuts down its memory arenas
+        amrex::ExecOnFinalize([] () { gmres.reset(); registered = false; });
+        registered = true;
+    }
+
+    return *gmres;
+}
+
 
 void GMRES::Solve (std::array<MultiFab, AMREX_SPACEDIM> & b_u, MultiFab & b_p,
                    std::array<MultiFab, AMREX_SPACEDIM> & x_u, MultiFab & x_p,
@@ -49,6 +91,25 @@ void GMRES::Solve (std::array<MultiFab, AMREX_SPACEDIM> & b_u, MultiFab & b_p,
 
     Vector<Vector<Real>> H(gmres_max_inner + 1, Vector<Real>(gmres_max_inner));
 
+    // inner products of the classical Gram-Schmidt variants
+    Vector<Real> dots(gmres_max_inner + 1);
+
+    // pipelined GMRES: reduction of the inner products in flight
+    const bool pipelined = (gmres_orthogonalization == 3);
+    MPI_Request dots_request;
+
+    // the pipelined recurrence builds Z(i+2) = M^{-1} A Z(i+1) - sum_k H(k,i) Z(k+1), which equals
+    // H(i+1,i) M^{-1} A V(i+1) only if M^{-1} is a fixed linear operator; a preconditioner that stops
+    // on a residual tolerance or uses a Krylov bottom solver (a flexible preconditioner) breaks it
+    if (pipelined && amrex::Math::abs(precon_type) == 1) {
+        if (stag_mg_max_vcycles > 1 && stag_mg_rel_tol > 0.) {
+            Abort("GMRES: gmres_orthogonalization = 3 needs a fixed number of staggered V-cycles; set stag_mg_max_vcycles = 1 or stag_mg_rel_tol = 0");
+        }
+        if (mg_bottom_solver != 0) {
+            Abort("GMRES: gmres_orthogonalization = 3 needs mg_bottom_solver = 0 (the BiCGStab bottom solver is not linear)");
+        }
+    }
+
     int outer_iter, total_iter, i_copy; // for looping iteration
     int i=0;
 
@@ -145,6 +206,10 @@ void GMRES::Solve (std::array<MultiFab, AMREX_SPACEDIM> & b_u, MultiFab & b_p,
     }
 
 
+    // the coefficients are fixed for the whole solve, so coarsen them for the multigrid
+    // preconditioner once here (or not at all if they did not change since the last solve)
+    StagSolver.SetCoefficients(alpha_fc, beta, beta_ed, gamma, theta_alpha);
+
     // First application of preconditioner
     Pcon.Apply(b_u, b_p, tmp_u, tmp_p, alpha_fc, alphainv_fc,
                beta, beta_ed, gamma, theta_alpha, geom, StagSolver);
@@ -182,6 +247,7 @@ void GMRES::Solve (std::array<MultiFab, AMREX_SPACEDIM> & b_u, MultiFab & b_p,
         if (gmres_verbose >= 1) {
             Print() << "GMRES.cpp: converged in 0 iterations since rhs=0" << std::endl;
         }
+        StagSolver.ReleaseCoefficients();
         return;
     }
 
@@ -361,12 +427,39 @@ void GMRES::Solve (std::array<MultiFab, AMREX_SPACEDIM> & b_u, MultiFab & b_p,
             i_copy     = i;
 
 
+            //___________________________________________________________________
+            // pipelined GMRES: Z(1) = M^{-1} A V(0) and start the reduction of (Z(1), V(0))
+            if (pipelined && i == 0) {
+                for (int d=0; d<AMREX_SPACEDIM; ++d)
+                    MultiFab::Copy(r_u[d], V_u[d], 0, 0, 1, 0);
+                MultiFab::Copy(r_p, V_p, 0, 0, 1, 0);
+
+                ApplyMatrix(tmp_u, tmp_p, r_u, r_p, alpha_fc, beta, beta_ed, gamma, theta_alpha, geom);
+                Pcon.Apply(tmp_u, tmp_p, w_u, w_p, alpha_fc, alphainv_fc,
+                           beta, beta_ed, gamma, theta_alpha, geom, StagSolver);
+
+                for (int d=0; d<AMREX_SPACEDIM; ++d)
+                    MultiFab::Copy(Z_u[d], w_u[d], 0, 1, 1, 0);
+                MultiFab::Copy(Z_p, w_p, 0, 1, 1, 0);
+
+                KrylovMultiDotBegin(w_u, w_p, V_u, V_p, 1, dots, dots_request);
+            }
+
+
             //___________________________________________________________________
             // tmp=A*V(i)
+            // for pipelined GMRES tmp=A*Z(i+1) instead, while the reduction of (Z(i+1), V(0:i))
+            // is in flight
             // use r_p and r_u as temporaries to hold ith component of V
-            for (int d=0; d<AMREX_SPACEDIM; ++d)
-                MultiFab::Copy(r_u[d], V_u[d], i, 0, 1, 0);
-            MultiFab::Copy(r_p, V_p, i, 0, 1, 0);
+            if (pipelined) {
+                for (int d=0; d<AMREX_SPACEDIM; ++d)
+                    MultiFab::Copy(r_u[d], Z_u[d], i+1, 0, 1, 0);
+                MultiFab::Copy(r_p, Z_p, i+1, 0, 1, 0);
+            } else {
+                for (int d=0; d<AMREX_SPACEDIM; ++d)
+                    MultiFab::Copy(r_u[d], V_u[d], i, 0, 1, 0);
+                MultiFab::Copy(r_p, V_p, i, 0, 1, 0);
+            }
 
             ApplyMatrix(tmp_u, tmp_p, r_u, r_p, alpha_fc, beta, beta_ed, gamma, theta_alpha, geom);
 
@@ -376,35 +469,125 @@ void GMRES::Solve (std::array<MultiFab, AMREX_SPACEDIM> & b_u, MultiFab & b_p,
             Pcon.Apply(tmp_u, tmp_p, w_u, w_p, alpha_fc, alphainv_fc,
                        beta, beta_ed, gamma, theta_alpha, geom, StagSolver);
 
+            if (pipelined) {
+                // tmp = M^{-1} A*Z(i+1) and w = Z(i+1), so the orthogonalization below
+                // turns w into V(i+1) and tmp into Z(i+2)
+                for (int d=0; d<AMREX_SPACEDIM; ++d) {
+                    MultiFab::Copy(tmp_u[d], w_u[d], 0, 0, 1, 0);
+                    MultiFab::Copy(w_u[d], Z_u[d], i+1, 0, 1, 0);
+                }
+                MultiFab::Copy(tmp_p, w_p, 0, 0, 1, 0);
+                MultiFab::Copy(w_p, Z_p, i+1, 0, 1, 0);
+            }
+
 
             //___________________________________________________________________
             // Form Hessenberg matrix H
-            for (int k=0; k<=i; ++k) {
-                // H(k,i) = dot_product(w, V(k))
-                //        = dot_product(w_u, V_u(k))+dot_product(w_p, V_p(k))
-                StagInnerProd(w_u, 0, V_u, k, scr_u, inner_prod_vel);
-                CCInnerProd(w_p, 0, V_p, k, scr_p, inner_prod_pres);
-                H[k][i] = std::accumulate(inner_prod_vel.begin(), inner_prod_vel.end(), 0.) 
-                          + pow(p_norm_weight, 2.0)*inner_prod_pres;
+            if (gmres_orthogonalization == 0) {
+
+                // modified Gram-Schmidt
+                for (int k=0; k<=i; ++k) {
+                    // H(k,i) = dot_product(w, V(k))
+                    //        = dot_product(w_u, V_u(k))+dot_product(w_p, V_p(k))
+                    StagInnerProd(w_u, 0, V_u, k, scr_u, inner_prod_vel);
+                    CCInnerProd(w_p, 0, V_p, k, scr_p, inner_prod_pres);
+                    H[k][i] = std::accumulate(inner_prod_vel.begin(), inner_prod_vel.end(), 0.) 
+                              + pow(p_norm_weight, 2.0)*inner_prod_pres;
+
+
+                    // w = w - H(k,i) * V(k)
+                    // use tmp_u and tmp_p as temporaries to hold kth component of V(k)
+                    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+                        MultiFab::Copy(tmp_u[d], V_u[d], k, 0, 1, 0);
+                        tmp_u[d].mult(H[k][i], 0, 1, 0);
+                        MultiFab::Subtract(w_u[d], tmp_u[d], 0, 0, 1, 0);
+                    }
+                    MultiFab::Copy(tmp_p, V_p, k, 0, 1, 0);
+                    tmp_p.mult(H[k][i], 0, 1, 0);
+                    MultiFab::Subtract(w_p,tmp_p, 0, 0, 1, 0);
+                }
 
+                // H(i+1,i) = norm(w)
+                StagL2Norm(w_u, 0, scr_u, norm_u);
+                CCL2Norm(w_p, 0, scr_p, norm_p);
+                norm_p    = p_norm_weight*norm_p;
+                H[i+1][i] = sqrt(norm_u*norm_u + norm_p*norm_p);
+            }
+            else if (pipelined) {
 
-                // w = w - H(k,i) * V(k)
-                // use tmp_u and tmp_p as temporaries to hold kth component of V(k)
-                for (int d=0; d<AMREX_SPACEDIM; ++d) {
-                    MultiFab::Copy(tmp_u[d], V_u[d], k, 0, 1, 0);
-                    tmp_u[d].mult(H[k][i], 0, 1, 0);
-                    MultiFab::Subtract(w_u[d], tmp_u[d], 0, 0, 1, 0);
+                // pipelined classical Gram-Schmidt (p(1)-GMRES, Ghysels et al., SISC 2013)
+                // H(0:i,i) = (Z(i+1), V(0:i)) since Z(i+1) = M^{-1} A V(i)
+                KrylovMultiDotWait(dots_request);
+
+                Real norm_w2 = dots[i+1];
+                Real norm2   = dots[i+1];
+                for (int k=0; k<=i; ++k) {
+                    H[k][i] = dots[k];
+                    norm2 -= dots[k]*dots[k];
+                }
+
+                // w = Z(i+1) - sum_k H(k,i) V(k)
+                // tmp = M^{-1} A Z(i+1) - sum_k H(k,i) Z(k+1) = H(i+1,i) M^{-1} A V(i+1)
+                KrylovMultiUpdate(w_u, w_p, V_u, V_p, i+1, dots);
+                KrylovMultiUpdate(tmp_u, tmp_p, Z_u, Z_p, i+1, dots, 1);
+
+                // H(i+1,i) = norm(w); there is no second pass here, so on cancellation fall
+                // back to a blocking norm
+                if (norm2 > 1.e-8*norm_w2) {
+                    H[i+1][i] = sqrt(norm2);
+                } else {
+                    StagL2Norm(w_u, 0, scr_u, norm_u);
+                    CCL2Norm(w_p, 0, scr_p, norm_p);
+                    norm_p    = p_norm_weight*norm_p;
+                    H[i+1][i] = sqrt(norm_u*norm_u + norm_p*norm_p);
+                }
+
+                if (H[i+1][i] != 0.) {
+                    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+                        tmp_u[d].mult(1./H[i+1][i], 0, 1, 0);
+                    }
+                    tmp_p.mult(1./H[i+1][i], 0, 1, 0);
                 }
-                MultiFab::Copy(tmp_p, V_p, k, 0, 1, 0);
-                tmp_p.mult(H[k][i], 0, 1, 0);
-                MultiFab::Subtract(w_p,tmp_p, 0, 0, 1, 0);
             }
+            else {
+
+                // classical Gram-Schmidt
+                // H(0:i,i) = (w, V(0:i)) and (w,w) from one fused dot product with a single
+                // reduction, then w = w - sum_k H(k,i) V(k) as one update
+                KrylovMultiDot(w_u, w_p, V_u, V_p, i+1, dots);
+                KrylovMultiUpdate(w_u, w_p, V_u, V_p, i+1, dots);
+
+                // |w|^2 after the update, since the V(k) are orthonormal
+                Real norm_w2 = dots[i+1];
+                Real norm2   = dots[i+1];
+                for (int k=0; k<=i; ++k) {
+                    H[k][i] = dots[k];
+                    norm2 -= dots[k]*dots[k];
+                }
 
-            // H(i+1,i) = norm(w)
-            StagL2Norm(w_u, 0, scr_u, norm_u);
-            CCL2Norm(w_p, 0, scr_p, norm_p);
-            norm_p    = p_norm_weight*norm_p;
-            H[i+1][i] = sqrt(norm_u*norm_u + norm_p*norm_p);
+                if (gmres_orthogonalization == 2) {
+                    // one reorthogonalization pass to recover the orthogonality lost to roundoff
+                    KrylovMultiDot(w_u, w_p, V_u, V_p, i+1, dots);
+                    KrylovMultiUpdate(w_u, w_p, V_u, V_p, i+1, dots);
+
+                    norm_w2 = dots[i+1];
+                    norm2   = dots[i+1];
+                    for (int k=0; k<=i; ++k) {
+                        H[k][i] += dots[k];
+                        norm2 -= dots[k]*dots[k];
+                    }
+                }
+
+                // if most of w was removed, norm2 has lost too many digits to cancellation
+                if (norm2 > 1.e-8*norm_w2) {
+                    H[i+1][i] = sqrt(norm2);
+                } else {
+                    StagL2Norm(w_u, 0, scr_u, norm_u);
+                    CCL2Norm(w_p, 0, scr_p, norm_p);
+                    norm_p    = p_norm_weight*norm_p;
+                    H[i+1][i] = sqrt(norm_u*norm_u + norm_p*norm_p);
+                }
+            }
 
 
             //___________________________________________________________________
@@ -447,6 +630,18 @@ void GMRES::Solve (std::array<MultiFab, AMREX_SPACEDIM> & b_u, MultiFab & b_p,
                 }
             }
 
+
+            //___________________________________________________________________
+            // pipelined GMRES: Z(i+2) = tmp and start the reduction of (Z(i+2), V(0:i+1)),
+            // which completes during the matrix and preconditioner of the next iteration
+            if (pipelined && i+1 < gmres_max_inner) {
+                for (int d=0; d<AMREX_SPACEDIM; ++d)
+                    MultiFab::Copy(Z_u[d], tmp_u[d], 0, i+2, 1, 0);
+                MultiFab::Copy(Z_p, tmp_p, 0, i+2, 1, 0);
+
+                KrylovMultiDotBegin(tmp_u, tmp_p, V_u, V_p, i+2, dots, dots_request);
+            }
+
         } // end of inner loop
 
 
@@ -461,6 +656,8 @@ void GMRES::Solve (std::array<MultiFab, AMREX_SPACEDIM> & b_u, MultiFab & b_p,
 
     } while (true); // end of outer loop (do iter=1,gmres_max_outer)
 
+    StagSolver.ReleaseCoefficients();
+
     // AJN - this is here since I notice epsilon roundoff errors building up
     //       just enough to destroy the asymmetry in time-advancement codes that
     //       ultimately causes lack of convergence in subsequent gmres calls
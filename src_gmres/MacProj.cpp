@@ -29,6 +29,13 @@ void MacProj::Define(const BoxArray& ba,
         }
     }
     mlabec.setDomainBC(lo_mlmg_bc,hi_mlmg_bc);
+
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        alphainv_fc_held[d].define(convert(ba,nodal_flag_dir[d]), dmap, 1, 0);
+    }
+
+    mlmg.reset();
+    bcoefs_set = false;
 }
     
 
@@ -44,31 +51,52 @@ void MacProj::Solve(const std::array<MultiFab, AMREX_SPACEDIM>& alphainv_fc,
     mlabec.setLevelBC(lev, &phi);
 
     // coefficients for solver (alpha already set to zero via setScalars)
-    mlabec.setBCoeffs(lev,amrex::GetArrOfConstPtrs(alphainv_fc));
+    // only passed on if they changed since the last call
+    bool bcoefs_changed = !bcoefs_set;
+    if (!bcoefs_changed) {
+        int ndiff = 0;
+        for (int d=0; d<AMREX_SPACEDIM; ++d) {
+            ndiff += CountDiff(alphainv_fc[d], alphainv_fc_held[d], 1., 0);
+        }
+        ParallelDescriptor::ReduceIntSum(ndiff);
+        bcoefs_changed = (ndiff > 0);
+    }
 
-    MLMG mlmg(mlabec);
+    if (bcoefs_changed) {
+        mlabec.setBCoeffs(lev,amrex::GetArrOfConstPtrs(alphainv_fc));
+        for (int d=0; d<AMREX_SPACEDIM; ++d) {
+            MultiFab::Copy(alphainv_fc_held[d], alphainv_fc[d], 0, 0, 1, 0);
+        }
+        bcoefs_set = true;
+    }
 
-    mlmg.setVerbose(mg_verbose);
-    mlmg.setBottomVerbose(cg_verbose);
+    if (!mlmg || mlmg_full_solve != full_solve) {
 
-    // for the preconditioner, we do 1 v-cycle and the bottom solver is smooths
-    if (!full_solve) {
-        if (mg_bottom_solver == 0) {
-            mlmg.setBottomSolver(amrex::MLMG::BottomSolver::smoother);
-        }
-        else if (mg_bottom_solver == 1) {
-            mlmg.setBottomSolver(amrex::MLMG::BottomSolver::bicgstab);
-        }
-        else {
-            Abort("MacProj.cpp: only mg_bottom_solver=0");
+        mlmg = std::make_unique<MLMG>(mlabec);
+        mlmg_full_solve = full_solve;
+
+        mlmg->setVerbose(mg_verbose);
+        mlmg->setBottomVerbose(cg_verbose);
+
+        // for the preconditioner, we do 1 v-cycle and the bottom solver is smooths
+        if (!full_solve) {
+            if (mg_bottom_solver == 0) {
+                mlmg->setBottomSolver(amrex::MLMG::BottomSolver::smoother);
+            }
+            else if (mg_bottom_solver == 1) {
+                mlmg->setBottomSolver(amrex::MLMG::BottomSolver::bicgstab);
+            }
+            else {
+                Abort("MacProj.cpp: only mg_bottom_solver=0");
+            }
+            mlmg->setFixedIter(mg_max_vcycles);
+            mlmg->setPreSmooth(mg_nsmooths_down);
+            mlmg->setPostSmooth(mg_nsmooths_up);
+            mlmg->setFinalSmooth(mg_nsmooths_bottom);
         }
-        mlmg.setFixedIter(mg_max_vcycles);
-        mlmg.setPreSmooth(mg_nsmooths_down);
-        mlmg.setPostSmooth(mg_nsmooths_up);
-        mlmg.setFinalSmooth(mg_nsmooths_bottom);
     }
 
-    mlmg.solve({&phi}, {&mac_rhs}, mg_rel_tol, mg_abs_tol);
+    mlmg->solve({&phi}, {&mac_rhs}, mg_rel_tol, mg_abs_tol);
 
     phi.FillBoundary(geom.periodicity());
 }
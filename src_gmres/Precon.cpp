@@ -17,6 +17,10 @@ void Precon::Define(const BoxArray& ba_in,
 
     macproj.Define(ba_in,dmap_in,geom_in);
 
+    if (precon_type == 7) {
+        stokes_fft = std::make_unique<StokesFFT>(ba_in,dmap_in,geom_in);
+    }
+
 
 }    
 
@@ -54,6 +58,7 @@ void Precon::Apply(const std::array<MultiFab, AMREX_SPACEDIM> & b_u,
     // 4 = block diagonal preconditioner
     // 5 = Uzawa-type approximation (see paper)
     // 6 = upper triangular + viscosity-based BFBt Schur complement (from Georg Stadler)
+    // 7 = exact FFT Stokes solve with the domain-averaged coefficients
 
     // projection preconditioner
     if (amrex::Math::abs(precon_type) == 1) {
@@ -137,6 +142,12 @@ void Precon::Apply(const std::array<MultiFab, AMREX_SPACEDIM> & b_u,
             Abort("StagApplyOp: visc_schur_approx != 0 not supported");
         }
     }
+    else if (precon_type == 7) {
+
+        // exact inverse for periodic constant-coefficient problems,
+        // approximate inverse with the averaged coefficients otherwise
+        stokes_fft->Solve(b_u,b_p,x_u,x_p,alpha_fc,beta,gamma,theta_alpha,geom);
+    }
     else {
         Abort("StagApplyOp: unsupposed precon_type");
     }
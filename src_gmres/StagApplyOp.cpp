@@ -5,21 +5,22 @@
 
 // we must retain custom lambda's because the boxes sometimes loop with stride 2
 
+template <typename T>
 AMREX_GPU_HOST_DEVICE
 inline
 void stag_applyop_visc_p1 (Box const& tbx,
 			   AMREX_D_DECL(Box const& xbx,
 					Box const& ybx,
 					Box const& zbx),
-                           AMREX_D_DECL(Array4<Real const> const& alphax,
-					Array4<Real const> const& alphay,
-					Array4<Real const> const& alphaz),
-                           AMREX_D_DECL(Array4<Real const> const& phix,
-					Array4<Real const> const& phiy,
-					Array4<Real const> const& phiz),
-                           AMREX_D_DECL(Array4<Real> const& Lphix,
-					Array4<Real> const& Lphiy,
-					Array4<Real> const& Lphiz),
+                           AMREX_D_DECL(Array4<T const> const& alphax,
+					Array4<T const> const& alphay,
+					Array4<T const> const& alphaz),
+                           AMREX_D_DECL(Array4<T const> const& phix,
+					Array4<T const> const& phiy,
+					Array4<T const> const& phiz),
+                           AMREX_D_DECL(Array4<T> const& Lphix,
+					Array4<T> const& Lphiy,
+					Array4<T> const& Lphiz),
 			   AMREX_D_DECL(bool do_x,
 					bool do_y,
 					bool do_z),
@@ -144,26 +145,27 @@ void stag_applyop_visc_p1 (Box const& tbx,
 
 }
 
+template <typename T>
 AMREX_GPU_HOST_DEVICE
 inline
 void stag_applyop_visc_m1 (Box const& tbx,
 			   AMREX_D_DECL(Box const& xbx,
 					Box const& ybx,
 					Box const& zbx),
-                           AMREX_D_DECL(Array4<Real const> const& alphax,
-					Array4<Real const> const& alphay,
-					Array4<Real const> const& alphaz),
-                           AMREX_D_DECL(Array4<Real const> const& phix,
-					Array4<Real const> const& phiy,
-					Array4<Real const> const& phiz),
-                           AMREX_D_DECL(Array4<Real> const& Lphix,
-					Array4<Real> const& Lphiy,
-					Array4<Real> const& Lphiz),
-                           Array4<Real const> const& betacc,
-                           Array4<Real const> const& betaxy,
+                           AMREX_D_DECL(Array4<T const> const& alphax,
+					Array4<T const> const& alphay,
+					Array4<T const> const& alphaz),
+                           AMREX_D_DECL(Array4<T const> const& phix,
+					Array4<T const> const& phiy,
+					Array4<T const> const& phiz),
+                           AMREX_D_DECL(Array4<T> const& Lphix,
+					Array4<T> const& Lphiy,
+					Array4<T> const& Lphiz),
+                           Array4<T const> const& betacc,
+                           Array4<T const> const& betaxy,
 #if (AMREX_SPACEDIM == 3)
-                           Array4<Real const> const& betaxz,
-                           Array4<Real const> const& betayz,
+                           Array4<T const> const& betaxz,
+                           Array4<T const> const& betayz,
 #endif
 			   AMREX_D_DECL(bool do_x,
 					bool do_y,
@@ -291,21 +293,22 @@ void stag_applyop_visc_m1 (Box const& tbx,
     
 }
 
+template <typename T>
 AMREX_GPU_HOST_DEVICE
 inline
 void stag_applyop_visc_p2 (Box const& tbx,
 			   AMREX_D_DECL(Box const& xbx,
 					Box const& ybx,
 					Box const& zbx),
-                           AMREX_D_DECL(Array4<Real const> const& alphax,
-					Array4<Real const> const& alphay,
-					Array4<Real const> const& alphaz),
-                           AMREX_D_DECL(Array4<Real const> const& phix,
-					Array4<Real const> const& phiy,
-					Array4<Real const> const& phiz),
-                           AMREX_D_DECL(Array4<Real> const& Lphix,
-					Array4<Real> const& Lphiy,
-					Array4<Real> const& Lphiz),
+                           AMREX_D_DECL(Array4<T const> const& alphax,
+					Array4<T const> const& alphay,
+					Array4<T const> const& alphaz),
+                           AMREX_D_DECL(Array4<T const> const& phix,
+					Array4<T const> const& phiy,
+					Array4<T const> const& phiz),
+                           AMREX_D_DECL(Array4<T> const& Lphix,
+					Array4<T> const& Lphiy,
+					Array4<T> const& Lphiz),
 			   AMREX_D_DECL(bool do_x,
 					bool do_y,
 					bool do_z),
@@ -437,26 +440,27 @@ void stag_applyop_visc_p2 (Box const& tbx,
 
 }
 
+template <typename T>
 AMREX_GPU_HOST_DEVICE
 inline
 void stag_applyop_visc_m2 (Box const& tbx,
 			   AMREX_D_DECL(Box const& xbx,
 					Box const& ybx,
 					Box const& zbx),
-                           AMREX_D_DECL(Array4<Real const> const& alphax,
-					Array4<Real const> const& alphay,
-					Array4<Real const> const& alphaz),
-                           AMREX_D_DECL(Array4<Real const> const& phix,
-					Array4<Real const> const& phiy,
-					Array4<Real const> const& phiz),
-                           AMREX_D_DECL(Array4<Real> const& Lphix,
-					Array4<Real> const& Lphiy,
-					Array4<Real> const& Lphiz),
-                           Array4<Real const> const& betacc,
-                           Array4<Real const> const& betaxy,
+                           AMREX_D_DECL(Array4<T const> const& alphax,
+					Array4<T const> const& alphay,
+					Array4<T const> const& alphaz),
+                           AMREX_D_DECL(Array4<T const> const& phix,
+					Array4<T const> const& phiy,
+					Array4<T const> const& phiz),
+                           AMREX_D_DECL(Array4<T> const& Lphix,
+					Array4<T> const& Lphiy,
+					Array4<T> const& Lphiz),
+                           Array4<T const> const& betacc,
+                           Array4<T const> const& betaxy,
 #if (AMREX_SPACEDIM == 3)
-                           Array4<Real const> const& betaxz,
-                           Array4<Real const> const& betayz,
+                           Array4<T const> const& betaxz,
+                           Array4<T const> const& betayz,
 #endif
 			   AMREX_D_DECL(bool do_x,
 					bool do_y,
@@ -635,19 +639,25 @@ void stag_applyop_visc_m2 (Box const& tbx,
 #endif
 }
 
-void StagApplyOp(const Geometry & geom,
-                 const MultiFab& beta_cc,
-                 const MultiFab& gamma_cc,
-                 const std::array<MultiFab, NUM_EDGE>& beta_ed,
-                 const std::array<MultiFab, AMREX_SPACEDIM>& phi,
-                 std::array<MultiFab, AMREX_SPACEDIM>& Lphi,
-                 const std::array<MultiFab, AMREX_SPACEDIM>& alpha_fc,
-                 const Real* dx,
-                 const amrex::Real& theta_alpha,
-                 const int& color)
+// MF is MultiFab, or the single precision FabArray of the StagMGSolver hierarchy
+// the stencil kernels are templated on its value type, so for the float hierarchy the neighbour
+// sums are single precision and only the scaling by the Real coefficients is done in Real
+template <class MF>
+static void StagApplyOpT(const Geometry & geom,
+                         const MF& beta_cc,
+                         const MF& gamma_cc,
+                         const std::array<MF, NUM_EDGE>& beta_ed,
+                         const std::array<MF, AMREX_SPACEDIM>& phi,
+                         std::array<MF, AMREX_SPACEDIM>& Lphi,
+                         const std::array<MF, AMREX_SPACEDIM>& alpha_fc,
+                         const Real* dx,
+                         const amrex::Real& theta_alpha,
+                         const int& color)
 {
 
     BL_PROFILE_VAR("StagApplyOp()",StagApplyOp);
+
+    using T = typename MF::value_type;
     
     GpuArray<Real,AMREX_SPACEDIM> dx_gpu{AMREX_D_DECL(dx[0], dx[1], dx[2])};
     
@@ -690,26 +700,26 @@ void StagApplyOp(const Geometry & geom,
 
         const Box & bx = mfi.tilebox();
 
-        Array4<Real const> const& betacc = beta_cc.array(mfi);
-        Array4<Real const> const& gammacc = gamma_cc.array(mfi);
+        Array4<T const> const& betacc = beta_cc.array(mfi);
+        Array4<T const> const& gammacc = gamma_cc.array(mfi);
 
-        Array4<Real const> const& betaxy = beta_ed[0].array(mfi);
+        Array4<T const> const& betaxy = beta_ed[0].array(mfi);
 #if (AMREX_SPACEDIM == 3)
-        Array4<Real const> const& betaxz = beta_ed[1].array(mfi);
-        Array4<Real const> const& betayz = beta_ed[2].array(mfi);
+        Array4<T const> const& betaxz = beta_ed[1].array(mfi);
+        Array4<T const> const& betayz = beta_ed[2].array(mfi);
 #endif
 
-        AMREX_D_TERM(Array4<Real const> const& phix = phi[0].array(mfi);,
-                     Array4<Real const> const& phiy = phi[1].array(mfi);,
-                     Array4<Real const> const& phiz = phi[2].array(mfi););
+        AMREX_D_TERM(Array4<T const> const& phix = phi[0].array(mfi);,
+                     Array4<T const> const& phiy = phi[1].array(mfi);,
+                     Array4<T const> const& phiz = phi[2].array(mfi););
 
-        AMREX_D_TERM(Array4<Real> const& Lphix = Lphi[0].array(mfi);,
-                     Array4<Real> const& Lphiy = Lphi[1].array(mfi);,
-                     Array4<Real> const& Lphiz = Lphi[2].array(mfi););
+        AMREX_D_TERM(Array4<T> const& Lphix = Lphi[0].array(mfi);,
+                     Array4<T> const& Lphiy = Lphi[1].array(mfi);,
+                     Array4<T> const& Lphiz = Lphi[2].array(mfi););
 
-        AMREX_D_TERM(Array4<Real const> const& alphax = alpha_fc[0].array(mfi);,
-                     Array4<Real const> const& alphay = alpha_fc[1].array(mfi);,
-                     Array4<Real const> const& alphaz = alpha_fc[2].array(mfi););
+        AMREX_D_TERM(Array4<T const> const& alphax = alpha_fc[0].array(mfi);,
+                     Array4<T const> const& alphay = alpha_fc[1].array(mfi);,
+                     Array4<T const> const& alphaz = alpha_fc[2].array(mfi););
 
         AMREX_D_TERM(const Box& bx_x = mfi.nodaltilebox(0);,
                      const Box& bx_y = mfi.nodaltilebox(1);,
@@ -788,3 +798,33 @@ void StagApplyOp(const Geometry & geom,
     }
     
 }
+
+void StagApplyOp(const Geometry & geom,
+                 const MultiFab& beta_cc,
+                 const MultiFab& gamma_cc,
+                 const std::array<MultiFab, NUM_EDGE>& beta_ed,
+                 const std::array<MultiFab, AMREX_SPACEDIM>& phi,
+                 std::array<MultiFab, AMREX_SPACEDIM>& Lphi,
+                 const std::array<MultiFab, AMREX_SPACEDIM>& alpha_fc,
+                 const Real* dx,
+                 const amrex::Real& theta_alpha,
+                 const int& color)
+{
+    StagApplyOpT(geom,beta_cc,gamma_cc,beta_ed,phi,Lphi,alpha_fc,dx,theta_alpha,color);
+}
+
+#ifdef STAG_MG_FLOAT
+void StagApplyOp(const Geometry & geom,
+                 const StagMGFab& beta_cc,
+                 const StagMGFab& gamma_cc,
+                 const std::array<StagMGFab, NUM_EDGE>& beta_ed,
+                 const std::array<StagMGFab, AMREX_SPACEDIM>& phi,
+                 std::array<StagMGFab, AMREX_SPACEDIM>& Lphi,
+                 const std::array<StagMGFab, AMREX_SPACEDIM>& alpha_fc,
+                 const Real* dx,
+                 const amrex::Real& theta_alpha,
+                 const int& color)
+{
+    StagApplyOpT(geom,beta_cc,gamma_cc,beta_ed,phi,Lphi,alpha_fc,dx,theta_alpha,color);
+}
+#endif
@@ -3,6 +3,28 @@
 
 using namespace amrex;
 
+// max norm over the valid region; FabArray<BaseFab<float> > has no norm0()
+static Real Norm0(const StagMGFab& mf)
+{
+    ReduceOps<ReduceOpMax> reduce_op;
+    ReduceData<Real> reduce_data(reduce_op);
+    using ReduceTuple = typename decltype(reduce_data)::Type;
+
+    for (MFIter mfi(mf,TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+        const Box& bx = mfi.tilebox();
+        Array4<StagMGReal const> const& fab = mf.const_array(mfi);
+        reduce_op.eval(bx, reduce_data,
+        [=] AMREX_GPU_DEVICE (int i, int j, int k) -> ReduceTuple
+        {
+            return {amrex::Math::abs(Real(fab(i,j,k)))};
+        });
+    }
+
+    Real norm = amrex::get<0>(reduce_data.value());
+    ParallelDescriptor::ReduceRealMax(norm);
+    return norm;
+}
+
 StagMGSolver::StagMGSolver() {}
 
 void StagMGSolver::Define(const BoxArray& ba_in,
@@ -20,6 +42,9 @@ void StagMGSolver::Define(const BoxArray& ba_in,
     // compute the number of multigrid levels assuming stag_mg_minwidth is the length of the
     // smallest dimension of the smallest grid at the coarsest multigrid level
     nlevs_mg = ComputeNlevsMG(ba_base);
+    if (is_bottom_solver) {
+        nlevs_mg = amrex::min(nlevs_mg, stag_mg_max_bottom_nlevels+1);
+    }
     if (stag_mg_verbosity >= 3) {
         Print() << "Total number of multigrid levels: " << nlevs_mg << std::endl;
     }
@@ -30,6 +55,8 @@ void StagMGSolver::Define(const BoxArray& ba_in,
     Lphi_fc_mg.resize(nlevs_mg);
     resid_fc_mg.resize(nlevs_mg);
     beta_ed_mg.resize(nlevs_mg);
+    cheb_d_fc_mg.resize(stag_mg_smoother == 2 ? nlevs_mg : 0);
+    cheb_lmax.resize(nlevs_mg);
 
     beta_cc_mg.resize(nlevs_mg);
     gamma_cc_mg.resize(nlevs_mg);
@@ -78,6 +105,9 @@ void StagMGSolver::Define(const BoxArray& ba_in,
               phi_fc_mg[n][d].define(convert(ba, nodal_flag_dir[d]), dmap, 1, 1);
              Lphi_fc_mg[n][d].define(convert(ba, nodal_flag_dir[d]), dmap, 1, 1);
             resid_fc_mg[n][d].define(convert(ba, nodal_flag_dir[d]), dmap, 1, 0);
+            if (stag_mg_smoother == 2) {
+                cheb_d_fc_mg[n][d].define(convert(ba, nodal_flag_dir[d]), dmap, 1, 0);
+            }
 
             // Put in to fix FPE traps
             Lphi_fc_mg[n][d].setVal(0);
@@ -94,61 +124,88 @@ void StagMGSolver::Define(const BoxArray& ba_in,
                 beta_ed_mg[n][d].define(convert(ba, nodal_flag_edge[d]), dmap, 1, 0);
         }
     } // end loop over multigrid levels
-    
+
+    coefs_built = false;
+    coefs_held = false;
+
+    // agglomerated bottom solver
+    // only worth it if the single grid can be coarsened further than the grids of this level
+    bottom_mg.reset();
+    if (stag_mg_bottom_solver == 4 && !is_bottom_solver) {
+
+        const int nb = nlevs_mg-1;
+        BoxArray ba_bottom(geom_mg[nb].Domain());
+
+        if (ba_base.size() > 1 && ComputeNlevsMG(ba_bottom) > 1) {
+
+            DistributionMapping dmap_bottom(ba_bottom);
+
+            bottom_mg = std::make_unique<StagMGSolver>();
+            bottom_mg->is_bottom_solver = true;
+            bottom_mg->Define(ba_bottom, dmap_bottom, geom_mg[nb]);
+
+            if (stag_mg_verbosity >= 3) {
+                Print() << "Agglomerated bottom solver with " << bottom_mg->nlevs_mg
+                        << " multigrid levels on " << ba_bottom[0] << std::endl;
+            }
+        }
+    }
 }
 
 
-// solve "(theta*alpha*I - L) phi = rhs" using multigrid with Gauss-Seidel relaxation
-// if amrex::Math::abs(visc_type) = 1, L = div beta grad
-// if amrex::Math::abs(visc_type) = 2, L = div [ beta (grad + grad^T) ]
-// if amrex::Math::abs(visc_type) = 3, L = div [ beta (grad + grad^T) + I (gamma - (2/3)*beta) div ]
-// if visc_type > 1 we assume constant coefficients
-// if visc_type < 1 we assume variable coefficients
-// beta_cc, and gamma_cc are cell-centered
-// alpha_fc, phi_fc, and rhs_fc are face-centered
-// beta_ed is nodal (2d) or edge-centered (3d)
-// phi_fc must come in initialized to some value, preferably a reasonable guess
-void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
-                         const MultiFab & beta_cc,
-                         const std::array<MultiFab, NUM_EDGE> & beta_ed,
-                         const MultiFab & gamma_cc,
-                         std::array<MultiFab, AMREX_SPACEDIM> & phi_fc,
-                         const std::array<MultiFab, AMREX_SPACEDIM> & rhs_fc,
-                         const Real & theta_alpha)
+void StagMGSolver::SetCoefficients(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
+                                   const MultiFab & beta_cc,
+                                   const std::array<MultiFab, NUM_EDGE> & beta_ed,
+                                   const MultiFab & gamma_cc,
+                                   const Real & theta_alpha)
 {
-    BL_PROFILE_VAR("StagMGSolver::Solve()",StagMGSolver_Solve);
+    BL_PROFILE_VAR("StagMGSolver::SetCoefficients()",StagMGSolver_SetCoefficients);
 
-    if (stag_mg_verbosity >= 1) {
-        Print() << "Begin call to stag_mg_solver\n";
+    if (!coefs_built || CoefficientsChanged(alpha_fc,beta_cc,beta_ed,gamma_cc,theta_alpha)) {
+        BuildCoefficients(alpha_fc,beta_cc,beta_ed,gamma_cc,theta_alpha);
+    }
+    else if (stag_mg_verbosity >= 2) {
+        Print() << "StagMGSolver: coefficients unchanged, reusing coarsened coefficients\n";
     }
 
-    // initial and current residuals
-    Vector<Real> resid0(AMREX_SPACEDIM);
-    Vector<Real> resid0_l2(AMREX_SPACEDIM);
-    Vector<Real> resid(AMREX_SPACEDIM);
-    Vector<Real> resid_l2(AMREX_SPACEDIM);
-    Real resid_temp;
+    coefs_held = true;
+}
 
-    int n, color_start, color_end;
+void StagMGSolver::BuildCoefficients(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
+                                     const MultiFab & beta_cc,
+                                     const std::array<MultiFab, NUM_EDGE> & beta_ed,
+                                     const MultiFab & gamma_cc,
+                                     const Real & theta_alpha)
+{
+    BL_PROFILE_VAR("StagMGSolver::BuildCoefficients()",StagMGSolver_BuildCoefficients);
 
     // copy level 1 coefficients into mg array of coefficients
-    MultiFab::Copy(beta_cc_mg[0],  beta_cc,  0, 0, 1, 1);
-    MultiFab::Copy(gamma_cc_mg[0], gamma_cc, 0, 0, 1, 1);
+    // (amrex::Copy converts to the precision of the hierarchy)
+    amrex::Copy(beta_cc_mg[0],  beta_cc,  0, 0, 1, 1);
+    amrex::Copy(gamma_cc_mg[0], gamma_cc, 0, 0, 1, 1);
 
     for (int d=0; d<AMREX_SPACEDIM; ++d) {
-        MultiFab::Copy(alpha_fc_mg[0][d], alpha_fc[d], 0, 0, 1, 0);
+        amrex::Copy(alpha_fc_mg[0][d], alpha_fc[d], 0, 0, 1, 0);
         // multiply alpha_fc_mg by theta_alpha
         alpha_fc_mg[0][d].mult(theta_alpha,0,1,0);
     }
 
-    MultiFab::Copy(    beta_ed_mg[0][0], beta_ed[0], 0, 0, 1, 0);
+    amrex::Copy(    beta_ed_mg[0][0], beta_ed[0], 0, 0, 1, 0);
     if (AMREX_SPACEDIM == 3) {
-        MultiFab::Copy(beta_ed_mg[0][1], beta_ed[1], 0, 0, 1, 0);
-        MultiFab::Copy(beta_ed_mg[0][2], beta_ed[2], 0, 0, 1, 0);
+        amrex::Copy(beta_ed_mg[0][1], beta_ed[1], 0, 0, 1, 0);
+        amrex::Copy(beta_ed_mg[0][2], beta_ed[2], 0, 0, 1, 0);
     }
 
+    CoarsenCoefficients();
+
+    theta_alpha_built = theta_alpha;
+    coefs_built = true;
+}
+
+void StagMGSolver::CoarsenCoefficients()
+{
     // coarsen coefficients
-    for (n=1; n<nlevs_mg; ++n) {
+    for (int n=1; n<nlevs_mg; ++n) {
         // need ghost cells set to zero to prevent intermediate NaN states
         // that cause some compilers to fail
          beta_cc_mg[n].setVal(0.);
@@ -179,6 +236,90 @@ void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
 #endif
     }
 
+    // copy the coarsest level coefficients onto level 0 of the bottom solver and coarsen them there
+    // alpha_fc_mg already includes theta_alpha, so the bottom solver uses theta_alpha = 1
+    if (bottom_mg) {
+        const int nb = nlevs_mg-1;
+        const Periodicity& period = geom_mg[nb].periodicity();
+
+        bottom_mg-> beta_cc_mg[0].ParallelCopy( beta_cc_mg[nb], 0, 0, 1, 1, 1, period);
+        bottom_mg->gamma_cc_mg[0].ParallelCopy(gamma_cc_mg[nb], 0, 0, 1, 1, 1, period);
+        for (int d=0; d<AMREX_SPACEDIM; ++d) {
+            bottom_mg->alpha_fc_mg[0][d].ParallelCopy(alpha_fc_mg[nb][d], 0, 0, 1);
+        }
+        for (int d=0; d<NUM_EDGE; ++d) {
+            bottom_mg->beta_ed_mg[0][d].ParallelCopy(beta_ed_mg[nb][d], 0, 0, 1);
+        }
+
+        bottom_mg->CoarsenCoefficients();
+        bottom_mg->theta_alpha_built = 1.;
+        bottom_mg->coefs_built = true;
+        bottom_mg->coefs_held = true;
+    }
+
+    if (stag_mg_smoother == 2) {
+        EstimateChebyshevBounds();
+    }
+}
+
+// compare the level 0 coefficients with the ones passed in, with a single reduction
+bool StagMGSolver::CoefficientsChanged(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
+                                       const MultiFab & beta_cc,
+                                       const std::array<MultiFab, NUM_EDGE> & beta_ed,
+                                       const MultiFab & gamma_cc,
+                                       const Real & theta_alpha)
+{
+    BL_PROFILE_VAR("StagMGSolver::CoefficientsChanged()",StagMGSolver_CoefficientsChanged);
+
+    if (theta_alpha != theta_alpha_built) {
+        return true;
+    }
+
+    int ndiff = 0;
+
+    ndiff += CountDiff( beta_cc,  beta_cc_mg[0], 1., 1);
+    ndiff += CountDiff(gamma_cc, gamma_cc_mg[0], 1., 1);
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        ndiff += CountDiff(alpha_fc[d], alpha_fc_mg[0][d], theta_alpha, 0);
+    }
+    for (int d=0; d<NUM_EDGE; ++d) {
+        ndiff += CountDiff(beta_ed[d], beta_ed_mg[0][d], 1., 0);
+    }
+
+    ParallelDescriptor::ReduceIntSum(ndiff);
+
+    return ndiff > 0;
+}
+
+
+// solve "(theta*alpha*I - L) phi = rhs" using multigrid with Gauss-Seidel relaxation
+// if amrex::Math::abs(visc_type) = 1, L = div beta grad
+// if amrex::Math::abs(visc_type) = 2, L = div [ beta (grad + grad^T) ]
+// if amrex::Math::abs(visc_type) = 3, L = div [ beta (grad + grad^T) + I (gamma - (2/3)*beta) div ]
+// if visc_type > 1 we assume constant coefficients
+// if visc_type < 1 we assume variable coefficients
+// beta_cc, and gamma_cc are cell-centered
+// alpha_fc, phi_fc, and rhs_fc are face-centered
+// beta_ed is nodal (2d) or edge-centered (3d)
+// phi_fc must come in initialized to some value, preferably a reasonable guess
+void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
+                         const MultiFab & beta_cc,
+                         const std::array<MultiFab, NUM_EDGE> & beta_ed,
+                         const MultiFab & gamma_cc,
+                         std::array<MultiFab, AMREX_SPACEDIM> & phi_fc,
+                         const std::array<MultiFab, AMREX_SPACEDIM> & rhs_fc,
+                         const Real & theta_alpha)
+{
+    BL_PROFILE_VAR("StagMGSolver::Solve()",StagMGSolver_Solve);
+
+    if (stag_mg_verbosity >= 1) {
+        Print() << "Begin call to stag_mg_solver\n";
+    }
+
+    if (!coefs_held) {
+        BuildCoefficients(alpha_fc,beta_cc,beta_ed,gamma_cc,theta_alpha);
+    }
+
     /*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
     // Now we solve the homogeneous problem
     !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
@@ -186,7 +327,54 @@ void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
     for (int d=0; d<AMREX_SPACEDIM; ++d) {
 
         // initialize phi_fc_mg = phi_fc as an initial guess
-        MultiFab::Copy(phi_fc_mg[0][d],phi_fc[d],0,0,1,0);
+        amrex::Copy(phi_fc_mg[0][d],phi_fc[d],0,0,1,0);
+
+        // set rhs_fc_mg at level 1 by copying in passed-in rhs_fc
+        amrex::Copy(rhs_fc_mg[0][d], rhs_fc[d], 0, 0, 1, 0);
+    }
+
+    if (!VCycles()) {
+        return;
+    }
+
+    //////////////////////////////////
+    // Done with multigrid
+    //////////////////////////////////
+
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+
+        // copy solution back into phi_fc
+        amrex::Copy(phi_fc[d],phi_fc_mg[0][d],0,0,1,0);
+
+        // set values on physical boundaries
+        MultiFabPhysBCDomainVel(phi_fc[d], geom_mg[0],d);
+
+        // fill periodic ghost cells
+        phi_fc[d].FillBoundary(geom_mg[0].periodicity());
+
+        // fill physical ghost cells
+        MultiFabPhysBCMacVel(phi_fc[d], geom_mg[0],d);
+    }
+
+    // vcycle_counter += AMREX_SPACEDIM*stag_mg_max_vcycles;
+
+    if (stag_mg_verbosity >= 1) {
+        Print() << "End call to stag_mg_solver\n";
+    }
+}
+
+bool StagMGSolver::VCycles()
+{
+    // initial and current residuals
+    Vector<Real> resid0(AMREX_SPACEDIM);
+    Vector<Real> resid0_l2(AMREX_SPACEDIM);
+    Vector<Real> resid(AMREX_SPACEDIM);
+    Vector<Real> resid_l2(AMREX_SPACEDIM);
+    Real resid_temp;
+
+    int n;
+
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
 
         // set values on physical boundaries
         MultiFabPhysBCDomainVel(phi_fc_mg[0][d], geom_mg[0],d);
@@ -196,9 +384,6 @@ void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
 
         // fill physical ghost cells
         MultiFabPhysBCMacVel(phi_fc_mg[0][d], geom_mg[0], d);
-
-        // set rhs_fc_mg at level 1 by copying in passed-in rhs_fc
-        MultiFab::Copy(rhs_fc_mg[0][d], rhs_fc[d], 0, 0, 1, 0);
     }
 
     // compute norm of initial residual
@@ -209,10 +394,10 @@ void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
     // now subtract the rest of the RHS from Lphi.
     for (int d=0; d<AMREX_SPACEDIM; ++d) {
         // compute Lphi - rhs
-        MultiFab::Subtract(Lphi_fc_mg[0][d],rhs_fc_mg[0][d],0,0,1,1);
+        amrex::Subtract(Lphi_fc_mg[0][d],rhs_fc_mg[0][d],0,0,1,1);
 
         // compute L0 norm of Lphi - rhs
-        resid0[d] = Lphi_fc_mg[0][d].norm0();
+        resid0[d] = Norm0(Lphi_fc_mg[0][d]);
 // FIXME - need to write an L2 norm for staggered fields
 //        resid0_l2[d] = Lphi_fc_mg[0][d].norm2();
         if (stag_mg_verbosity >= 2) {
@@ -224,7 +409,7 @@ void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
         if (stag_mg_verbosity >= 1) {
             Print() << "Initial residual is zero; exiting staggered multigrid solver" << std::endl;
         }
-        return;
+        return false;
     }
 
     // if some (but not all) of the residuals are zero
@@ -235,15 +420,6 @@ void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
 //        std::fill(resid0_l2.begin(), resid0_l2.end(), *max_element(resid0_l2.begin(), resid0_l2.end()));
     }
 
-    if (stag_mg_smoother == 0) {
-        color_start = 0;
-        color_end = 0;
-    }
-    else {
-        color_start = 1;
-        color_end = 2*AMREX_SPACEDIM;
-    }
-
     for (int vcycle=1; vcycle<=stag_mg_max_vcycles; ++vcycle) {
 
         if (stag_mg_verbosity >= 2) {
@@ -270,8 +446,8 @@ void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
                 // now subtract the rest of the RHS from Lphi.
                 for (int d=0; d<AMREX_SPACEDIM; ++d) {
                     // compute Lphi - rhs, and report residual
-                    MultiFab::Subtract(Lphi_fc_mg[n][d],rhs_fc_mg[n][d],0,0,1,0);
-                    resid_temp = Lphi_fc_mg[n][d].norm0();
+                    amrex::Subtract(Lphi_fc_mg[n][d],rhs_fc_mg[n][d],0,0,1,0);
+                    resid_temp = Norm0(Lphi_fc_mg[n][d]);
                     Print() << "Residual for comp " << d << " before    smooths at level "
                             << n << " " << resid_temp << std::endl;
                 }
@@ -280,33 +456,7 @@ void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
             for (int m=1; m<=stag_mg_nsmooths_down; ++m) {
 
                 // do the smooths
-                for (int color=color_start; color<=color_end; ++color) {
-
-                    // the form of weighted Jacobi we are using is
-                    // phi^{k+1} = phi^k + omega*D^{-1}*(rhs-Lphi)
-                    // where D is the diagonal matrix containing the diagonal elements of L
-
-                    // compute Lphi
-                    StagApplyOp(geom_mg[n],beta_cc_mg[n],gamma_cc_mg[n],beta_ed_mg[n],
-                                phi_fc_mg[n],Lphi_fc_mg[n],alpha_fc_mg[n],dx_mg[n].data(),1.,color);
-
-                    // update phi = phi + omega*D^{-1}*(rhs-Lphi)
-                    StagMGUpdate(phi_fc_mg[n],rhs_fc_mg[n],Lphi_fc_mg[n],alpha_fc_mg[n],
-                                 beta_cc_mg[n],beta_ed_mg[n],gamma_cc_mg[n],dx_mg[n].data(),color);
-
-                    for (int d=0; d<AMREX_SPACEDIM; ++d) {
-
-                        // set values on physical boundaries
-                        MultiFabPhysBCDomainVel(phi_fc_mg[n][d], geom_mg[n],d);
-
-                        // fill periodic ghost cells
-                        phi_fc_mg[n][d].FillBoundary(geom_mg[n].periodicity());
-
-                        // fill physical ghost cells
-                        MultiFabPhysBCMacVel(phi_fc_mg[n][d], geom_mg[n],d);
-                    }
-
-                } // end loop over colors
+                Smooth(n,m);
 
                 // print out residual
                 if (stag_mg_verbosity >= 4) {
@@ -318,8 +468,8 @@ void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
                     // now subtract the rest of the RHS from Lphi.
                     for (int d=0; d<AMREX_SPACEDIM; ++d) {
                         // compute Lphi - rhs, and report residual
-                        MultiFab::Subtract(Lphi_fc_mg[n][d],rhs_fc_mg[n][d],0,0,1,0);
-                        resid_temp = Lphi_fc_mg[n][d].norm0();
+                        amrex::Subtract(Lphi_fc_mg[n][d],rhs_fc_mg[n][d],0,0,1,0);
+                        resid_temp = Norm0(Lphi_fc_mg[n][d]);
                         Print() << "Residual for comp " << d << " after    smooth " << m << " at level "
                                 << n << " " << resid_temp << std::endl;
                     }
@@ -338,10 +488,10 @@ void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
             for (int d=0; d<AMREX_SPACEDIM; ++d) {
 
                 // compute Lphi - rhs, and then multiply by -1
-                MultiFab::Subtract(Lphi_fc_mg[n][d],rhs_fc_mg[n][d],0,0,1,0);
+                amrex::Subtract(Lphi_fc_mg[n][d],rhs_fc_mg[n][d],0,0,1,0);
                 Lphi_fc_mg[n][d].mult(-1.,0,1,0);
                 if (stag_mg_verbosity >= 3) {
-                    resid_temp = Lphi_fc_mg[n][d].norm0();
+                    resid_temp = Norm0(Lphi_fc_mg[n][d]);
                     Print() << "Residual for comp " << d << " after all smooths at level "
                             << n << " " << resid_temp << std::endl;
                 }
@@ -374,6 +524,7 @@ void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
         }
 
         ////////////////////////////
+        // unless there is an agglomerated bottom solver (stag_mg_bottom_solver = 4),
         // just do smooths at the current level as the bottom solve
 
         // print out residual
@@ -387,45 +538,50 @@ void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
             for (int d=0; d<AMREX_SPACEDIM; ++d) {
                 // compute Lphi - rhs, and report residual
 
-                MultiFab::Subtract(Lphi_fc_mg[n][d],rhs_fc_mg[n][d],0,0,1,0);
-                resid_temp = Lphi_fc_mg[n][d].norm0();
+                amrex::Subtract(Lphi_fc_mg[n][d],rhs_fc_mg[n][d],0,0,1,0);
+                resid_temp = Norm0(Lphi_fc_mg[n][d]);
                 Print() << "Residual for comp " << d << " before    smooths at level "
                         << n << " " << resid_temp << std::endl;
             }
         }
 
-        for (int m=1; m<=stag_mg_nsmooths_bottom; ++m) {
+        if (bottom_mg) {
 
-            // do the smooths
-            for (int color=color_start; color<=color_end; ++color) {
+            ////////////////////////////
+            // agglomerated bottom solve: copy the residual equation at this level onto
+            // a single grid, solve it there with more levels of multigrid, and copy back
+            for (int d=0; d<AMREX_SPACEDIM; ++d) {
+                bottom_mg->rhs_fc_mg[0][d].ParallelCopy(rhs_fc_mg[n][d], 0, 0, 1);
+                bottom_mg->phi_fc_mg[0][d].setVal(0.);
+            }
 
-                // the form of weighted Jacobi we are using is
-                // phi^{k+1} = phi^k + omega*D^{-1}*(rhs-Lphi)
-                // where D is the diagonal matrix containing the diagonal elements of L
+            bottom_mg->VCycles();
 
-                // compute Lphi
-                StagApplyOp(geom_mg[n],beta_cc_mg[n],gamma_cc_mg[n],beta_ed_mg[n],
-                            phi_fc_mg[n],Lphi_fc_mg[n],alpha_fc_mg[n],dx_mg[n].data(),1.,color);
+            for (int d=0; d<AMREX_SPACEDIM; ++d) {
 
-                // update phi = phi + omega*D^{-1}*(rhs-Lphi)
-                StagMGUpdate(phi_fc_mg[n],rhs_fc_mg[n],Lphi_fc_mg[n],alpha_fc_mg[n],
-                             beta_cc_mg[n],beta_ed_mg[n],gamma_cc_mg[n],dx_mg[n].data(),color);
+                phi_fc_mg[n][d].ParallelCopy(bottom_mg->phi_fc_mg[0][d], 0, 0, 1);
 
-                for (int d=0; d<AMREX_SPACEDIM; d++) {
+                // set values on physical boundaries
+                MultiFabPhysBCDomainVel(phi_fc_mg[n][d], geom_mg[n],d);
 
-                    // set values on physical boundaires
-                    MultiFabPhysBCDomainVel(phi_fc_mg[n][d], geom_mg[n],d);
+                // fill periodic ghost cells
+                phi_fc_mg[n][d].FillBoundary(geom_mg[n].periodicity());
 
-                    // fill periodic ghost cells
-                    phi_fc_mg[n][d].FillBoundary(geom_mg[n].periodicity());
+                // fill physical ghost cells
+                MultiFabPhysBCMacVel(phi_fc_mg[n][d], geom_mg[n],d);
+            }
 
-                    // fill physical ghost cells
-                    MultiFabPhysBCMacVel(phi_fc_mg[n][d], geom_mg[n],d);
-                }
+        }
+        else {
 
-            } // end loop over colors
+            for (int m=1; m<=stag_mg_nsmooths_bottom; ++m) {
 
-        } // end loop over nsmooths
+                // do the smooths
+                Smooth(n,m);
+
+            } // end loop over nsmooths
+
+        }
 
         ////////////////////
         // compute residual
@@ -438,10 +594,10 @@ void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
         for (int d=0; d<AMREX_SPACEDIM; ++d) {
 
             // compute Lphi - rhs, and then multiply by -1
-            MultiFab::Subtract(Lphi_fc_mg[n][d],rhs_fc_mg[n][d],0,0,1,0);
+            amrex::Subtract(Lphi_fc_mg[n][d],rhs_fc_mg[n][d],0,0,1,0);
             Lphi_fc_mg[n][d].mult(-1.,0,1,0);
             if (stag_mg_verbosity >= 3) {
-                resid_temp = Lphi_fc_mg[n][d].norm0();
+                resid_temp = Norm0(Lphi_fc_mg[n][d]);
                 Print() << "Residual for comp " << d << " after all smooths at level "
                         << n << " " << resid_temp << std::endl;
             }
@@ -488,8 +644,8 @@ void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
                 // now subtract the rest of the RHS from Lphi.
                 for (int d=0; d<AMREX_SPACEDIM; ++d) {
                     // compute Lphi - rhs, and report residual
-                    MultiFab::Subtract(Lphi_fc_mg[n][d],rhs_fc_mg[n][d],0,0,1,0);
-                    resid_temp = Lphi_fc_mg[n][d].norm0();
+                    amrex::Subtract(Lphi_fc_mg[n][d],rhs_fc_mg[n][d],0,0,1,0);
+                    resid_temp = Norm0(Lphi_fc_mg[n][d]);
                     Print() << "Residual for comp " << d << " before    smooths at level "
                             << n << " " << resid_temp << std::endl;
                 }
@@ -498,33 +654,7 @@ void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
             for (int m=1; m<=stag_mg_nsmooths_up; ++m) {
 
                 // do the smooths
-                for (int color=color_start; color<=color_end; ++color) {
-
-                    // the form of weighted Jacobi we are using is
-                    // phi^{k+1} = phi^k + omega*D^{-1}*(rhs-Lphi)
-                    // where D is the diagonal matrix containing the diagonal elements of L
-
-                    // compute Lphi
-                    StagApplyOp(geom_mg[n],beta_cc_mg[n],gamma_cc_mg[n],beta_ed_mg[n],
-                                phi_fc_mg[n],Lphi_fc_mg[n],alpha_fc_mg[n],dx_mg[n].data(),1.,color);
-
-                    // update phi = phi + omega*D^{-1}*(rhs-Lphi)
-                    StagMGUpdate(phi_fc_mg[n],rhs_fc_mg[n],Lphi_fc_mg[n],alpha_fc_mg[n],
-                                 beta_cc_mg[n],beta_ed_mg[n],gamma_cc_mg[n],dx_mg[n].data(),color);
-
-                    for (int d=0; d<AMREX_SPACEDIM; d++) {
-
-                        // set values on physical boundaries
-                        MultiFabPhysBCDomainVel(phi_fc_mg[n][d], geom_mg[n],d);
-
-                        // fill periodic ghost cells
-                        phi_fc_mg[n][d].FillBoundary(geom_mg[n].periodicity());
-
-                        // fill physical ghost cells
-                        MultiFabPhysBCMacVel(phi_fc_mg[n][d], geom_mg[n],d);
-                    }
-
-                } // end loop over colors
+                Smooth(n,m);
 
                 // print out residual
                 if (stag_mg_verbosity >= 4) {
@@ -536,8 +666,8 @@ void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
                     // now subtract the rest of the RHS from Lphi.
                     for (int d=0; d<AMREX_SPACEDIM; ++d) {
                         // compute Lphi - rhs, and report residual
-                        MultiFab::Subtract(Lphi_fc_mg[n][d],rhs_fc_mg[n][d],0,0,1,0);
-                        resid_temp = Lphi_fc_mg[n][d].norm0();
+                        amrex::Subtract(Lphi_fc_mg[n][d],rhs_fc_mg[n][d],0,0,1,0);
+                        resid_temp = Norm0(Lphi_fc_mg[n][d]);
                         Print() << "Residual for comp " << d << " after    smooth " << m << " at level "
                                 << n << " " << resid_temp << std::endl;
                     }
@@ -553,8 +683,8 @@ void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
 
                 for (int d=0; d<AMREX_SPACEDIM; ++d) {
                     // compute Lphi - rhs, and report residual
-                    MultiFab::Subtract(Lphi_fc_mg[n][d],rhs_fc_mg[n][d],0,0,1,0);
-                    resid_temp = Lphi_fc_mg[n][d].norm0();
+                    amrex::Subtract(Lphi_fc_mg[n][d],rhs_fc_mg[n][d],0,0,1,0);
+                    resid_temp = Norm0(Lphi_fc_mg[n][d]);
                     Print() << "Residual for comp " << d << " after all smooths at level "
                             << n << " " << resid_temp << std::endl;
                 }
@@ -575,12 +705,12 @@ void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
         // compute Lphi - rhs
         for (int d=0; d<AMREX_SPACEDIM; ++d) {
             // compute Lphi - rhs
-            MultiFab::Subtract(Lphi_fc_mg[0][d],rhs_fc_mg[0][d],0,0,1,0);
+            amrex::Subtract(Lphi_fc_mg[0][d],rhs_fc_mg[0][d],0,0,1,0);
         }
 
         // compute L0 norm of Lphi - rhs and determine if the problem is solved
         for (int d=0; d<AMREX_SPACEDIM; ++d) {
-            resid[d] = Lphi_fc_mg[0][d].norm0();
+            resid[d] = Norm0(Lphi_fc_mg[0][d]);
 // FIXME - need to write an L2 norm for staggered fields
 //            resid_l2[d] = Lphi_fc_mg[0][d].norm2();
             if (stag_mg_verbosity >= 2) {
@@ -630,29 +760,228 @@ void StagMGSolver::Solve(const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
 
     } // end loop over stag_mg_max_vcycles
 
-    //////////////////////////////////
-    // Done with multigrid
-    //////////////////////////////////
+    return true;
+}
+
+// one smoothing sweep at level n; m is the index of the sweep within the current group of smooths
+void StagMGSolver::Smooth(int n, int m)
+{
+    BL_PROFILE_VAR("StagMGSolver::Smooth()",StagMGSolver_Smooth);
+
+    if (stag_mg_smoother == 2) {
+        ChebyshevSweep(n,m);
+        return;
+    }
+
+    const Periodicity& period = geom_mg[n].periodicity();
+
+    // the form of weighted Jacobi we are using is
+    // phi^{k+1} = phi^k + omega*D^{-1}*(rhs-Lphi)
+    // where D is the diagonal matrix containing the diagonal elements of L
+
+    if (stag_mg_smoother == 0) {
+
+        // compute Lphi
+        StagApplyOp(geom_mg[n],beta_cc_mg[n],gamma_cc_mg[n],beta_ed_mg[n],
+                    phi_fc_mg[n],Lphi_fc_mg[n],alpha_fc_mg[n],dx_mg[n].data(),1.,0);
+
+        // update phi = phi + omega*D^{-1}*(rhs-Lphi)
+        StagMGUpdate(phi_fc_mg[n],rhs_fc_mg[n],Lphi_fc_mg[n],alpha_fc_mg[n],
+                     beta_cc_mg[n],beta_ed_mg[n],gamma_cc_mg[n],dx_mg[n].data(),stag_mg_omega,0);
+
+        // exchange all components at once
+        for (int d=0; d<AMREX_SPACEDIM; ++d) {
+            MultiFabPhysBCDomainVel(phi_fc_mg[n][d], geom_mg[n],d);
+            phi_fc_mg[n][d].FillBoundary_nowait(period);
+        }
+        for (int d=0; d<AMREX_SPACEDIM; ++d) {
+            phi_fc_mg[n][d].FillBoundary_finish();
+            MultiFabPhysBCMacVel(phi_fc_mg[n][d], geom_mg[n],d);
+        }
+        return;
+    }
+
+    // 2*dm-color Gauss-Seidel
+    // colors 2*d+1 and 2*d+2 update the red and black faces of component d, so only
+    // component d has to be exchanged after each color
+    // for abs(visc_type) = 1 the components are decoupled, so the exchange after the black
+    // color of component d is completed only at the end of the sweep and overlaps the
+    // sweeps of the other components
+    const bool decoupled = (std::abs(visc_type) == 1);
 
     for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        for (int color=2*d+1; color<=2*d+2; ++color) {
 
-        // copy solution back into phi_fc
-        MultiFab::Copy(phi_fc[d],phi_fc_mg[0][d],0,0,1,0);
+            // compute Lphi for the faces of this color
+            StagApplyOp(geom_mg[n],beta_cc_mg[n],gamma_cc_mg[n],beta_ed_mg[n],
+                        phi_fc_mg[n],Lphi_fc_mg[n],alpha_fc_mg[n],dx_mg[n].data(),1.,color);
 
-        // set values on physical boundaries
-        MultiFabPhysBCDomainVel(phi_fc[d], geom_mg[0],d);
+            // update phi = phi + omega*D^{-1}*(rhs-Lphi)
+            StagMGUpdate(phi_fc_mg[n],rhs_fc_mg[n],Lphi_fc_mg[n],alpha_fc_mg[n],
+                         beta_cc_mg[n],beta_ed_mg[n],gamma_cc_mg[n],dx_mg[n].data(),stag_mg_omega,color);
 
-        // fill periodic ghost cells
-        phi_fc[d].FillBoundary(geom_mg[0].periodicity());
+            // set values on physical boundaries
+            MultiFabPhysBCDomainVel(phi_fc_mg[n][d], geom_mg[n],d);
 
-        // fill physical ghost cells
-        MultiFabPhysBCMacVel(phi_fc[d], geom_mg[0],d);
+            if (decoupled && color == 2*d+2) {
+                phi_fc_mg[n][d].FillBoundary_nowait(period);
+            }
+            else {
+                // fill periodic ghost cells
+                phi_fc_mg[n][d].FillBoundary(period);
+
+                // fill physical ghost cells
+                MultiFabPhysBCMacVel(phi_fc_mg[n][d], geom_mg[n],d);
+            }
+        }
     }
 
-    // vcycle_counter += AMREX_SPACEDIM*stag_mg_max_vcycles;
+    if (decoupled) {
+        for (int d=0; d<AMREX_SPACEDIM; ++d) {
+            phi_fc_mg[n][d].FillBoundary_finish();
+            MultiFabPhysBCMacVel(phi_fc_mg[n][d], geom_mg[n],d);
+        }
+    }
+}
 
-    if (stag_mg_verbosity >= 1) {
-        Print() << "End call to stag_mg_solver\n";
+// one step of the Chebyshev iteration on D^{-1}*(theta*alpha*I - L), restarted at m = 1
+// the polynomial damps the eigenvalues in [cheb_lmin_frac*lmax, lmax]
+// every step needs a single exchange of phi
+void StagMGSolver::ChebyshevSweep(int n, int m)
+{
+    const Periodicity& period = geom_mg[n].periodicity();
+
+    // fraction of the largest eigenvalue that the smoother targets
+    const Real cheb_lmin_frac = 0.3;
+
+    const Real lmax = cheb_lmax[n];
+    const Real lmin = cheb_lmin_frac*lmax;
+    const Real theta = 0.5*(lmax+lmin);
+    const Real delta = 0.5*(lmax-lmin);
+    const Real sigma = theta/delta;
+
+    // compute Lphi
+    StagApplyOp(geom_mg[n],beta_cc_mg[n],gamma_cc_mg[n],beta_ed_mg[n],
+                phi_fc_mg[n],Lphi_fc_mg[n],alpha_fc_mg[n],dx_mg[n].data(),1.,0);
+
+    // resid = D^{-1}*(rhs-Lphi)
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        resid_fc_mg[n][d].setVal(0.);
+    }
+    StagMGUpdate(resid_fc_mg[n],rhs_fc_mg[n],Lphi_fc_mg[n],alpha_fc_mg[n],
+                 beta_cc_mg[n],beta_ed_mg[n],gamma_cc_mg[n],dx_mg[n].data(),1.,0);
+
+    if (m == 1) {
+        // first direction is resid/theta
+        cheb_rho = 1./sigma;
+        for (int d=0; d<AMREX_SPACEDIM; ++d) {
+            amrex::Copy(cheb_d_fc_mg[n][d],resid_fc_mg[n][d],0,0,1,0);
+            cheb_d_fc_mg[n][d].mult(1./theta,0,1,0);
+        }
+    }
+    else {
+        // direction = rho_new*rho*direction + (2*rho_new/delta)*resid
+        Real rho_new = 1./(2.*sigma - cheb_rho);
+        for (int d=0; d<AMREX_SPACEDIM; ++d) {
+            cheb_d_fc_mg[n][d].mult(rho_new*cheb_rho,0,1,0);
+            resid_fc_mg[n][d].mult(2.*rho_new/delta,0,1,0);
+            amrex::Add(cheb_d_fc_mg[n][d],resid_fc_mg[n][d],0,0,1,0);
+        }
+        cheb_rho = rho_new;
+    }
+
+    // phi = phi + direction, and exchange all components at once
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        amrex::Add(phi_fc_mg[n][d],cheb_d_fc_mg[n][d],0,0,1,0);
+        MultiFabPhysBCDomainVel(phi_fc_mg[n][d], geom_mg[n],d);
+        phi_fc_mg[n][d].FillBoundary_nowait(period);
+    }
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        phi_fc_mg[n][d].FillBoundary_finish();
+        MultiFabPhysBCMacVel(phi_fc_mg[n][d], geom_mg[n],d);
+    }
+}
+
+// estimate the largest eigenvalue of D^{-1}*(theta*alpha*I - L) at every level with a few
+// power iterations; phi_fc_mg, rhs_fc_mg, Lphi_fc_mg and resid_fc_mg are used as scratch,
+// so this can only be called outside of a solve
+void StagMGSolver::EstimateChebyshevBounds()
+{
+    BL_PROFILE_VAR("StagMGSolver::EstimateChebyshevBounds()",StagMGSolver_EstimateChebyshevBounds);
+
+    const int npower = 10;
+
+    for (int n=0; n<nlevs_mg; ++n) {
+
+        // start from a rough, deterministic field so all modes are present
+        for (int d=0; d<AMREX_SPACEDIM; ++d) {
+            rhs_fc_mg[n][d].setVal(0.);
+            phi_fc_mg[n][d].setVal(0.);
+            for (MFIter mfi(phi_fc_mg[n][d],TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+                const Box& bx = mfi.tilebox();
+                Array4<StagMGReal> const& v = phi_fc_mg[n][d].array(mfi);
+                amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+                {
+                    Real h = std::sin(12.9898*i + 78.233*j + 37.719*k + 4.1414*d) * 43758.5453;
+                    v(i,j,k) = h - std::floor(h) - 0.5;
+                });
+            }
+        }
+
+        Real lambda = 0.;
+        for (int it=0; it<npower; ++it) {
+
+            Real vnorm = 0.;
+            for (int d=0; d<AMREX_SPACEDIM; ++d) {
+                MultiFabPhysBCDomainVel(phi_fc_mg[n][d], geom_mg[n],d);
+                phi_fc_mg[n][d].FillBoundary(geom_mg[n].periodicity());
+                MultiFabPhysBCMacVel(phi_fc_mg[n][d], geom_mg[n],d);
+                vnorm = amrex::max(vnorm, Norm0(phi_fc_mg[n][d]));
+            }
+            if (vnorm == 0.) {
+                break;
+            }
+
+            StagApplyOp(geom_mg[n],beta_cc_mg[n],gamma_cc_mg[n],beta_ed_mg[n],
+                        phi_fc_mg[n],Lphi_fc_mg[n],alpha_fc_mg[n],dx_mg[n].data(),1.,0);
+
+            // resid = -D^{-1}*Lphi (rhs is zero)
+            Real znorm = 0.;
+            for (int d=0; d<AMREX_SPACEDIM; ++d) {
+                resid_fc_mg[n][d].setVal(0.);
+            }
+            StagMGUpdate(resid_fc_mg[n],rhs_fc_mg[n],Lphi_fc_mg[n],alpha_fc_mg[n],
+                         beta_cc_mg[n],beta_ed_mg[n],gamma_cc_mg[n],dx_mg[n].data(),1.,0);
+            for (int d=0; d<AMREX_SPACEDIM; ++d) {
+                znorm = amrex::max(znorm, Norm0(resid_fc_mg[n][d]));
+            }
+
+            lambda = znorm/vnorm;
+            if (znorm == 0.) {
+                break;
+            }
+
+            for (int d=0; d<AMREX_SPACEDIM; ++d) {
+                amrex::Copy(phi_fc_mg[n][d],resid_fc_mg[n][d],0,0,1,0);
+                phi_fc_mg[n][d].mult(1./znorm,0,1,0);
+            }
+        }
+
+        // the power iteration approaches lmax from below; Chebyshev is robust to
+        // overestimates but not to underestimates
+        cheb_lmax[n] = (lambda > 0.) ? 1.1*lambda : 2.;
+
+        if (stag_mg_verbosity >= 3) {
+            Print() << "Chebyshev smoother: estimated max eigenvalue of D^{-1}A at level "
+                    << n << " " << cheb_lmax[n] << std::endl;
+        }
+    }
+
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        for (int n=0; n<nlevs_mg; ++n) {
+            rhs_fc_mg[n][d].setVal(0.);
+            phi_fc_mg[n][d].setVal(0.);
+        }
     }
 }
 
@@ -688,7 +1017,7 @@ int StagMGSolver::ComputeNlevsMG(const BoxArray& ba) {
     return nlevs_mg;
 }
 
-void StagMGSolver::CCRestriction(MultiFab& phi_c, const MultiFab& phi_f, const Geometry& geom_c)
+void StagMGSolver::CCRestriction(StagMGFab& phi_c, const StagMGFab& phi_f, const Geometry& geom_c)
 {
     BL_PROFILE_VAR("CCRestriction()",CCRestriction);
 
@@ -698,8 +1027,8 @@ void StagMGSolver::CCRestriction(MultiFab& phi_c, const MultiFab& phi_f, const G
         // Get the index space of the valid region
         const Box& bx = mfi.tilebox();
 
-        Array4<Real      > const& phi_c_fab = phi_c.array(mfi);
-        Array4<Real const> const& phi_f_fab = phi_f.array(mfi);
+        Array4<StagMGReal      > const& phi_c_fab = phi_c.array(mfi);
+        Array4<StagMGReal const> const& phi_f_fab = phi_f.array(mfi);
 
         amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
 #if (AMREX_SPACEDIM==2)
@@ -720,8 +1049,8 @@ void StagMGSolver::CCRestriction(MultiFab& phi_c, const MultiFab& phi_f, const G
     phi_c.FillBoundary(geom_c.periodicity());
 }
 
-void StagMGSolver::StagRestriction(std::array< MultiFab, AMREX_SPACEDIM >& phi_c,
-                     const std::array< MultiFab, AMREX_SPACEDIM >& phi_f,
+void StagMGSolver::StagRestriction(std::array< StagMGFab, AMREX_SPACEDIM >& phi_c,
+                     const std::array< StagMGFab, AMREX_SPACEDIM >& phi_f,
                      int simple_stencil)
 {
 
@@ -738,13 +1067,13 @@ void StagMGSolver::StagRestriction(std::array< MultiFab, AMREX_SPACEDIM >& phi_c
 
         const Box& index_bounds = amrex::getIndexBounds(AMREX_D_DECL(bx_x, bx_y, bx_z));
 
-        AMREX_D_TERM(Array4<Real> const& phix_c_fab = phi_c[0].array(mfi);,
-                     Array4<Real> const& phiy_c_fab = phi_c[1].array(mfi);,
-                     Array4<Real> const& phiz_c_fab = phi_c[2].array(mfi););
+        AMREX_D_TERM(Array4<StagMGReal> const& phix_c_fab = phi_c[0].array(mfi);,
+                     Array4<StagMGReal> const& phiy_c_fab = phi_c[1].array(mfi);,
+                     Array4<StagMGReal> const& phiz_c_fab = phi_c[2].array(mfi););
 
-        AMREX_D_TERM(Array4<Real const> const& phix_f_fab = phi_f[0].array(mfi);,
-                     Array4<Real const> const& phiy_f_fab = phi_f[1].array(mfi);,
-                     Array4<Real const> const& phiz_f_fab = phi_f[2].array(mfi););
+        AMREX_D_TERM(Array4<StagMGReal const> const& phix_f_fab = phi_f[0].array(mfi);,
+                     Array4<StagMGReal const> const& phiy_f_fab = phi_f[1].array(mfi);,
+                     Array4<StagMGReal const> const& phiz_f_fab = phi_f[2].array(mfi););
 
         if (simple_stencil == 0) {
 
@@ -826,7 +1155,7 @@ void StagMGSolver::StagRestriction(std::array< MultiFab, AMREX_SPACEDIM >& phi_c
     }
 }
 
-void StagMGSolver::NodalRestriction(MultiFab& phi_c, const MultiFab& phi_f)
+void StagMGSolver::NodalRestriction(StagMGFab& phi_c, const StagMGFab& phi_f)
 {
     BL_PROFILE_VAR("NodalRestriction()",NodalRestriction);
 
@@ -838,8 +1167,8 @@ void StagMGSolver::NodalRestriction(MultiFab& phi_c, const MultiFab& phi_f)
         // note this is NODAL
         const Box& bx = mfi.tilebox();
 
-        Array4<Real      > const& phi_c_fab = phi_c.array(mfi);
-        Array4<Real const> const& phi_f_fab = phi_f.array(mfi);
+        Array4<StagMGReal      > const& phi_c_fab = phi_c.array(mfi);
+        Array4<StagMGReal const> const& phi_f_fab = phi_f.array(mfi);
 
         amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
         {
@@ -848,8 +1177,8 @@ void StagMGSolver::NodalRestriction(MultiFab& phi_c, const MultiFab& phi_f)
     }
 }
 
-void StagMGSolver::EdgeRestriction(std::array< MultiFab, NUM_EDGE >& phi_c,
-                     const std::array< MultiFab, NUM_EDGE >& phi_f)
+void StagMGSolver::EdgeRestriction(std::array< StagMGFab, NUM_EDGE >& phi_c,
+                     const std::array< StagMGFab, NUM_EDGE >& phi_f)
 {
     BL_PROFILE_VAR("EdgeRestriction()",EdgeRestriction);
 
@@ -868,13 +1197,13 @@ void StagMGSolver::EdgeRestriction(std::array< MultiFab, NUM_EDGE >& phi_c,
 
         const Box& index_bounds = amrex::getIndexBounds(bx_xy, bx_xz, bx_yz);
 
-        Array4<Real> const& phixy_c_fab = phi_c[0].array(mfi);
-        Array4<Real> const& phixz_c_fab = phi_c[1].array(mfi);
-        Array4<Real> const& phiyz_c_fab = phi_c[2].array(mfi);
+        Array4<StagMGReal> const& phixy_c_fab = phi_c[0].array(mfi);
+        Array4<StagMGReal> const& phixz_c_fab = phi_c[1].array(mfi);
+        Array4<StagMGReal> const& phiyz_c_fab = phi_c[2].array(mfi);
 
-        Array4<Real const> const& phixy_f_fab = phi_f[0].array(mfi);
-        Array4<Real const> const& phixz_f_fab = phi_f[1].array(mfi);
-        Array4<Real const> const& phiyz_f_fab = phi_f[2].array(mfi);
+        Array4<StagMGReal const> const& phixy_f_fab = phi_f[0].array(mfi);
+        Array4<StagMGReal const> const& phixz_f_fab = phi_f[1].array(mfi);
+        Array4<StagMGReal const> const& phiyz_f_fab = phi_f[2].array(mfi);
 
         amrex::ParallelFor(bx_xy, bx_xz, bx_yz, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
         {
@@ -891,8 +1220,8 @@ void StagMGSolver::EdgeRestriction(std::array< MultiFab, NUM_EDGE >& phi_c,
     }
 }
 
-void StagMGSolver::StagProlongation(const std::array< MultiFab, AMREX_SPACEDIM >& phi_c_in,
-                                    std::array< MultiFab, AMREX_SPACEDIM >& phi_f_in)
+void StagMGSolver::StagProlongation(const std::array< StagMGFab, AMREX_SPACEDIM >& phi_c_in,
+                                    std::array< StagMGFab, AMREX_SPACEDIM >& phi_f_in)
 {
 
     BL_PROFILE_VAR("StagProlongation()",StagProlongation);
@@ -906,13 +1235,13 @@ void StagMGSolver::StagProlongation(const std::array< MultiFab, AMREX_SPACEDIM >
                      Box bx_y = mfi.tilebox(nodal_flag_y);,
                      Box bx_z = mfi.tilebox(nodal_flag_z););
 
-        AMREX_D_TERM(Array4<Real const> const& phix_c = phi_c_in[0].array(mfi);,
-                     Array4<Real const> const& phiy_c = phi_c_in[1].array(mfi);,
-                     Array4<Real const> const& phiz_c = phi_c_in[2].array(mfi););
+        AMREX_D_TERM(Array4<StagMGReal const> const& phix_c = phi_c_in[0].array(mfi);,
+                     Array4<StagMGReal const> const& phiy_c = phi_c_in[1].array(mfi);,
+                     Array4<StagMGReal const> const& phiz_c = phi_c_in[2].array(mfi););
 
-        AMREX_D_TERM(Array4<Real> const& phix_f = phi_f_in[0].array(mfi);,
-                     Array4<Real> const& phiy_f = phi_f_in[1].array(mfi);,
-                     Array4<Real> const& phiz_f = phi_f_in[2].array(mfi););
+        AMREX_D_TERM(Array4<StagMGReal> const& phix_f = phi_f_in[0].array(mfi);,
+                     Array4<StagMGReal> const& phiy_f = phi_f_in[1].array(mfi);,
+                     Array4<StagMGReal> const& phiz_f = phi_f_in[2].array(mfi););
 
 #if (AMREX_SPACEDIM == 2)
         amrex::ParallelFor(bx_x, bx_y, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
@@ -1049,18 +1378,18 @@ void stag_mg_update_visc_p1 (Box const& tbx,
                              AMREX_D_DECL(Box const& xbx,
                                           Box const& ybx,
                                           Box const& zbx),
-                             AMREX_D_DECL(Array4<Real> const& phix,
-                                          Array4<Real> const& phiy,
-                                          Array4<Real> const& phiz),
-                             AMREX_D_DECL(Array4<Real const> const& rhsx,
-                                          Array4<Real const> const& rhsy,
-                                          Array4<Real const> const& rhsz),
-                             AMREX_D_DECL(Array4<Real const> const& Lpx,
-                                          Array4<Real const> const& Lpy,
-                                          Array4<Real const> const& Lpz),
-                             AMREX_D_DECL(Array4<Real const> const& alphax,
-                                          Array4<Real const> const& alphay,
-                                          Array4<Real const> const& alphaz),
+                             AMREX_D_DECL(Array4<StagMGReal> const& phix,
+                                          Array4<StagMGReal> const& phiy,
+                                          Array4<StagMGReal> const& phiz),
+                             AMREX_D_DECL(Array4<StagMGReal const> const& rhsx,
+                                          Array4<StagMGReal const> const& rhsy,
+                                          Array4<StagMGReal const> const& rhsz),
+                             AMREX_D_DECL(Array4<StagMGReal const> const& Lpx,
+                                          Array4<StagMGReal const> const& Lpy,
+                                          Array4<StagMGReal const> const& Lpz),
+                             AMREX_D_DECL(Array4<StagMGReal const> const& alphax,
+                                          Array4<StagMGReal const> const& alphay,
+                                          Array4<StagMGReal const> const& alphaz),
                              AMREX_D_DECL(bool do_x,
                                           bool do_y,
                                           bool do_z),
@@ -1159,23 +1488,23 @@ void stag_mg_update_visc_m1 (Box const& tbx,
                              AMREX_D_DECL(Box const& xbx,
                                           Box const& ybx,
                                           Box const& zbx),
-                             AMREX_D_DECL(Array4<Real> const& phix,
-                                          Array4<Real> const& phiy,
-                                          Array4<Real> const& phiz),
-                             AMREX_D_DECL(Array4<Real const> const& rhsx,
-                                          Array4<Real const> const& rhsy,
-                                          Array4<Real const> const& rhsz),
-                             AMREX_D_DECL(Array4<Real const> const& Lpx,
-                                          Array4<Real const> const& Lpy,
-                                          Array4<Real const> const& Lpz),
-                             AMREX_D_DECL(Array4<Real const> const& alphax,
-                                          Array4<Real const> const& alphay,
-                                          Array4<Real const> const& alphaz),
-                             Array4<Real const> const& beta,
-                             Array4<Real const> const& beta_xy,
+                             AMREX_D_DECL(Array4<StagMGReal> const& phix,
+                                          Array4<StagMGReal> const& phiy,
+                                          Array4<StagMGReal> const& phiz),
+                             AMREX_D_DECL(Array4<StagMGReal const> const& rhsx,
+                                          Array4<StagMGReal const> const& rhsy,
+                                          Array4<StagMGReal const> const& rhsz),
+                             AMREX_D_DECL(Array4<StagMGReal const> const& Lpx,
+                                          Array4<StagMGReal const> const& Lpy,
+                                          Array4<StagMGReal const> const& Lpz),
+                             AMREX_D_DECL(Array4<StagMGReal const> const& alphax,
+                                          Array4<StagMGReal const> const& alphay,
+                                          Array4<StagMGReal const> const& alphaz),
+                             Array4<StagMGReal const> const& beta,
+                             Array4<StagMGReal const> const& beta_xy,
 #if (AMREX_SPACEDIM == 3)
-                             Array4<Real const> const& beta_xz,
-                             Array4<Real const> const& beta_yz,
+                             Array4<StagMGReal const> const& beta_xz,
+                             Array4<StagMGReal const> const& beta_yz,
 #endif
                              AMREX_D_DECL(bool do_x,
                                           bool do_y,
@@ -1298,18 +1627,18 @@ void stag_mg_update_visc_p2 (Box const& tbx,
                              AMREX_D_DECL(Box const& xbx,
                                           Box const& ybx,
                                           Box const& zbx),
-                             AMREX_D_DECL(Array4<Real> const& phix,
-                                          Array4<Real> const& phiy,
-                                          Array4<Real> const& phiz),
-                             AMREX_D_DECL(Array4<Real const> const& rhsx,
-                                          Array4<Real const> const& rhsy,
-                                          Array4<Real const> const& rhsz),
-                             AMREX_D_DECL(Array4<Real const> const& Lpx,
-                                          Array4<Real const> const& Lpy,
-                                          Array4<Real const> const& Lpz),
-                             AMREX_D_DECL(Array4<Real const> const& alphax,
-                                          Array4<Real const> const& alphay,
-                                          Array4<Real const> const& alphaz),
+                             AMREX_D_DECL(Array4<StagMGReal> const& phix,
+                                          Array4<StagMGReal> const& phiy,
+                                          Array4<StagMGReal> const& phiz),
+                             AMREX_D_DECL(Array4<StagMGReal const> const& rhsx,
+                                          Array4<StagMGReal const> const& rhsy,
+                                          Array4<StagMGReal const> const& rhsz),
+                             AMREX_D_DECL(Array4<StagMGReal const> const& Lpx,
+                                          Array4<StagMGReal const> const& Lpy,
+                                          Array4<StagMGReal const> const& Lpz),
+                             AMREX_D_DECL(Array4<StagMGReal const> const& alphax,
+                                          Array4<StagMGReal const> const& alphay,
+                                          Array4<StagMGReal const> const& alphaz),
                              AMREX_D_DECL(bool do_x,
                                           bool do_y,
                                           bool do_z),
@@ -1408,23 +1737,23 @@ void stag_mg_update_visc_m2 (Box const& tbx,
                              AMREX_D_DECL(Box const& xbx,
                                           Box const& ybx,
                                           Box const& zbx),
-                             AMREX_D_DECL(Array4<Real> const& phix,
-                                          Array4<Real> const& phiy,
-                                          Array4<Real> const& phiz),
-                             AMREX_D_DECL(Array4<Real const> const& rhsx,
-                                          Array4<Real const> const& rhsy,
-                                          Array4<Real const> const& rhsz),
-                             AMREX_D_DECL(Array4<Real const> const& Lpx,
-                                          Array4<Real const> const& Lpy,
-                                          Array4<Real const> const& Lpz),
-                             AMREX_D_DECL(Array4<Real const> const& alphax,
-                                          Array4<Real const> const& alphay,
-                                          Array4<Real const> const& alphaz),
-                             Array4<Real const> const& beta,
-                             Array4<Real const> const& beta_xy,
+                             AMREX_D_DECL(Array4<StagMGReal> const& phix,
+                                          Array4<StagMGReal> const& phiy,
+                                          Array4<StagMGReal> const& phiz),
+                             AMREX_D_DECL(Array4<StagMGReal const> const& rhsx,
+                                          Array4<StagMGReal const> const& rhsy,
+                                          Array4<StagMGReal const> const& rhsz),
+                             AMREX_D_DECL(Array4<StagMGReal const> const& Lpx,
+                                          Array4<StagMGReal const> const& Lpy,
+                                          Array4<StagMGReal const> const& Lpz),
+                             AMREX_D_DECL(Array4<StagMGReal const> const& alphax,
+                                          Array4<StagMGReal const> const& alphay,
+                                          Array4<StagMGReal const> const& alphaz),
+                             Array4<StagMGReal const> const& beta,
+                             Array4<StagMGReal const> const& beta_xy,
 #if (AMREX_SPACEDIM == 3)
-                             Array4<Real const> const& beta_xz,
-                             Array4<Real const> const& beta_yz,
+                             Array4<StagMGReal const> const& beta_xz,
+                             Array4<StagMGReal const> const& beta_yz,
 #endif
                              AMREX_D_DECL(bool do_x,
                                           bool do_y,
@@ -1539,18 +1868,18 @@ void stag_mg_update_visc_p3 (Box const& tbx,
                              AMREX_D_DECL(Box const& xbx,
                                           Box const& ybx,
                                           Box const& zbx),
-                             AMREX_D_DECL(Array4<Real> const& phix,
-                                          Array4<Real> const& phiy,
-                                          Array4<Real> const& phiz),
-                             AMREX_D_DECL(Array4<Real const> const& rhsx,
-                                          Array4<Real const> const& rhsy,
-                                          Array4<Real const> const& rhsz),
-                             AMREX_D_DECL(Array4<Real const> const& Lpx,
-                                          Array4<Real const> const& Lpy,
-                                          Array4<Real const> const& Lpz),
-                             AMREX_D_DECL(Array4<Real const> const& alphax,
-                                          Array4<Real const> const& alphay,
-                                          Array4<Real const> const& alphaz),
+                             AMREX_D_DECL(Array4<StagMGReal> const& phix,
+                                          Array4<StagMGReal> const& phiy,
+                                          Array4<StagMGReal> const& phiz),
+                             AMREX_D_DECL(Array4<StagMGReal const> const& rhsx,
+                                          Array4<StagMGReal const> const& rhsy,
+                                          Array4<StagMGReal const> const& rhsz),
+                             AMREX_D_DECL(Array4<StagMGReal const> const& Lpx,
+                                          Array4<StagMGReal const> const& Lpy,
+                                          Array4<StagMGReal const> const& Lpz),
+                             AMREX_D_DECL(Array4<StagMGReal const> const& alphax,
+                                          Array4<StagMGReal const> const& alphay,
+                                          Array4<StagMGReal const> const& alphaz),
                              AMREX_D_DECL(bool do_x,
                                           bool do_y,
                                           bool do_z),
@@ -1650,25 +1979,25 @@ void stag_mg_update_visc_m3 (Box const& tbx,
                              AMREX_D_DECL(Box const& xbx,
                                           Box const& ybx,
                                           Box const& zbx),
-                             AMREX_D_DECL(Array4<Real> const& phix,
-                                          Array4<Real> const& phiy,
-                                          Array4<Real> const& phiz),
-                             AMREX_D_DECL(Array4<Real const> const& rhsx,
-                                          Array4<Real const> const& rhsy,
-                                          Array4<Real const> const& rhsz),
-                             AMREX_D_DECL(Array4<Real const> const& Lpx,
-                                          Array4<Real const> const& Lpy,
-                                          Array4<Real const> const& Lpz),
-                             AMREX_D_DECL(Array4<Real const> const& alphax,
-                                          Array4<Real const> const& alphay,
-                                          Array4<Real const> const& alphaz),
-                             Array4<Real const> const& beta,
-                             Array4<Real const> const& beta_xy,
+                             AMREX_D_DECL(Array4<StagMGReal> const& phix,
+                                          Array4<StagMGReal> const& phiy,
+                                          Array4<StagMGReal> const& phiz),
+                             AMREX_D_DECL(Array4<StagMGReal const> const& rhsx,
+                                          Array4<StagMGReal const> const& rhsy,
+                                          Array4<StagMGReal const> const& rhsz),
+                             AMREX_D_DECL(Array4<StagMGReal const> const& Lpx,
+                                          Array4<StagMGReal const> const& Lpy,
+                                          Array4<StagMGReal const> const& Lpz),
+                             AMREX_D_DECL(Array4<StagMGReal const> const& alphax,
+                                          Array4<StagMGReal const> const& alphay,
+                                          Array4<StagMGReal const> const& alphaz),
+                             Array4<StagMGReal const> const& beta,
+                             Array4<StagMGReal const> const& beta_xy,
 #if (AMREX_SPACEDIM == 3)
-                             Array4<Real const> const& beta_xz,
-                             Array4<Real const> const& beta_yz,
+                             Array4<StagMGReal const> const& beta_xz,
+                             Array4<StagMGReal const> const& beta_yz,
 #endif
-                             Array4<Real const> const& gamma,
+                             Array4<StagMGReal const> const& gamma,
                              AMREX_D_DECL(bool do_x,
                                           bool do_y,
                                           bool do_z),
@@ -1786,14 +2115,15 @@ void stag_mg_update_visc_m3 (Box const& tbx,
 
 }
 
-void StagMGSolver::StagMGUpdate (std::array< MultiFab, AMREX_SPACEDIM >& phi_fc,
-                                 const std::array< MultiFab, AMREX_SPACEDIM >& rhs_fc,
-                                 const std::array< MultiFab, AMREX_SPACEDIM >& Lphi_fc,
-                                 const std::array< MultiFab, AMREX_SPACEDIM >& alpha_fc,
-                                 const MultiFab& beta_cc,
-                                 const std::array< MultiFab, NUM_EDGE >& beta_ed,
-                                 const MultiFab& gamma_cc,
+void StagMGSolver::StagMGUpdate (std::array< StagMGFab, AMREX_SPACEDIM >& phi_fc,
+                                 const std::array< StagMGFab, AMREX_SPACEDIM >& rhs_fc,
+                                 const std::array< StagMGFab, AMREX_SPACEDIM >& Lphi_fc,
+                                 const std::array< StagMGFab, AMREX_SPACEDIM >& alpha_fc,
+                                 const StagMGFab& beta_cc,
+                                 const std::array< StagMGFab, NUM_EDGE >& beta_ed,
+                                 const StagMGFab& gamma_cc,
                                  const Real* dx,
+                                 const Real& omega,
                                  const int& color)
 {
     BL_PROFILE_VAR("StagMGUpdate()",StagMGUpdate);
@@ -1840,29 +2170,29 @@ void StagMGSolver::StagMGUpdate (std::array< MultiFab, AMREX_SPACEDIM >& phi_fc,
         // Get the index space of the valid region
         const Box& bx = mfi.tilebox();
 
-        AMREX_D_TERM(Array4<Real> const& phix_fab = phi_fc[0].array(mfi);,
-                     Array4<Real> const& phiy_fab = phi_fc[1].array(mfi);,
-                     Array4<Real> const& phiz_fab = phi_fc[2].array(mfi););
+        AMREX_D_TERM(Array4<StagMGReal> const& phix_fab = phi_fc[0].array(mfi);,
+                     Array4<StagMGReal> const& phiy_fab = phi_fc[1].array(mfi);,
+                     Array4<StagMGReal> const& phiz_fab = phi_fc[2].array(mfi););
 
-        AMREX_D_TERM(Array4<Real const> const& rhsx_fab = rhs_fc[0].array(mfi);,
-                     Array4<Real const> const& rhsy_fab = rhs_fc[1].array(mfi);,
-                     Array4<Real const> const& rhsz_fab = rhs_fc[2].array(mfi););
+        AMREX_D_TERM(Array4<StagMGReal const> const& rhsx_fab = rhs_fc[0].array(mfi);,
+                     Array4<StagMGReal const> const& rhsy_fab = rhs_fc[1].array(mfi);,
+                     Array4<StagMGReal const> const& rhsz_fab = rhs_fc[2].array(mfi););
 
-        AMREX_D_TERM(Array4<Real const> const& Lphix_fab = Lphi_fc[0].array(mfi);,
-                     Array4<Real const> const& Lphiy_fab = Lphi_fc[1].array(mfi);,
-                     Array4<Real const> const& Lphiz_fab = Lphi_fc[2].array(mfi););
+        AMREX_D_TERM(Array4<StagMGReal const> const& Lphix_fab = Lphi_fc[0].array(mfi);,
+                     Array4<StagMGReal const> const& Lphiy_fab = Lphi_fc[1].array(mfi);,
+                     Array4<StagMGReal const> const& Lphiz_fab = Lphi_fc[2].array(mfi););
 
-        AMREX_D_TERM(Array4<Real const> const& alphax_fab = alpha_fc[0].array(mfi);,
-                     Array4<Real const> const& alphay_fab = alpha_fc[1].array(mfi);,
-                     Array4<Real const> const& alphaz_fab = alpha_fc[2].array(mfi););
+        AMREX_D_TERM(Array4<StagMGReal const> const& alphax_fab = alpha_fc[0].array(mfi);,
+                     Array4<StagMGReal const> const& alphay_fab = alpha_fc[1].array(mfi);,
+                     Array4<StagMGReal const> const& alphaz_fab = alpha_fc[2].array(mfi););
 
-        Array4<Real const> const& beta_cc_fab = beta_cc.array(mfi);
-        Array4<Real const> const& gamma_cc_fab = gamma_cc.array(mfi);
+        Array4<StagMGReal const> const& beta_cc_fab = beta_cc.array(mfi);
+        Array4<StagMGReal const> const& gamma_cc_fab = gamma_cc.array(mfi);
 
-        Array4<Real const> const& beta_xy_fab = beta_ed[0].array(mfi);
+        Array4<StagMGReal const> const& beta_xy_fab = beta_ed[0].array(mfi);
 #if (AMREX_SPACEDIM == 3)
-        Array4<Real const> const& beta_xz_fab = beta_ed[1].array(mfi);
-        Array4<Real const> const& beta_yz_fab = beta_ed[2].array(mfi);
+        Array4<StagMGReal const> const& beta_xz_fab = beta_ed[1].array(mfi);
+        Array4<StagMGReal const> const& beta_yz_fab = beta_ed[2].array(mfi);
 #endif
 
         AMREX_D_TERM(const Box& bx_x = mfi.nodaltilebox(0);,
@@ -1879,8 +2209,6 @@ void StagMGSolver::StagMGUpdate (std::array< MultiFab, AMREX_SPACEDIM >& phi_fc,
             c = gamma_cc_fab(lo.x,lo.y,lo.z);
         }
 
-        Real omega = stag_mg_omega;
-
         if (visc_type == 1) {
 
             AMREX_LAUNCH_HOST_DEVICE_LAMBDA(index_bounds, tbx,
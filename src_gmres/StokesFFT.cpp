@@ -0,0 +1,354 @@
+#include "StokesFFT.H"
+
+#include "gmres_functions.H"
+
+StokesFFT::StokesFFT (const BoxArray& ba_in,
+                      const DistributionMapping& dmap_in,
+                      const Geometry& geom_in) {
+
+    BL_PROFILE_VAR("StokesFFT::StokesFFT()", StokesFFT);
+
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        if (!geom_in.isPeriodic(d)) {
+            Abort("StokesFFT: requires a fully periodic domain");
+        }
+    }
+
+    ba = ba_in;
+    dmap = dmap_in;
+    domain = geom_in.Domain();
+
+    // single grid for the transforms
+    ba_onegrid.define(domain);
+    dmap_onegrid.define(ba_onegrid);
+
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        u_onegrid[d].define(convert(ba_onegrid, nodal_flag_dir[d]), dmap_onegrid, 1, 0);
+    }
+    p_onegrid.define(ba_onegrid, dmap_onegrid, 1, 0);
+
+    const int ncomp = AMREX_SPACEDIM+1;
+
+    // only the rank that owns the single grid enters this loop
+    for (MFIter mfi(p_onegrid); mfi.isValid(); ++mfi) {
+
+        IntVect fft_size = domain.length();
+
+        // the 0th component is 'halved plus 1' for the real-to-complex transform
+        IntVect spectral_size = fft_size;
+        spectral_size[0] = fft_size[0]/2 + 1;
+        Box spectral_bx(IntVect(0), spectral_size - IntVect(1));
+
+        real_field = std::make_unique<FArrayBox>(domain, ncomp, The_Device_Arena());
+        spectral_field = std::make_unique<BaseFab<GpuComplex<Real> > >(spectral_bx, ncomp,
+                                                                       The_Device_Arena());
+
+        // FFTW and cuFFT are row-major, so the dimensions are reversed compared to AMReX
+        int n[AMREX_SPACEDIM];
+        for (int d=0; d<AMREX_SPACEDIM; ++d) {
+            n[d] = fft_size[AMREX_SPACEDIM-1-d];
+        }
+
+        int rdist = domain.numPts();
+        int cdist = spectral_bx.numPts();
+
+#ifdef AMREX_USE_CUDA
+        cufftResult result = cufftPlanMany(&forward_plan, AMREX_SPACEDIM, n,
+                                           NULL, 1, rdist,
+                                           NULL, 1, cdist,
+                                           CUFFT_D2Z, ncomp);
+        if (result != CUFFT_SUCCESS) {
+            Abort("StokesFFT: cufftPlanMany forward failed");
+        }
+        result = cufftPlanMany(&backward_plan, AMREX_SPACEDIM, n,
+                               NULL, 1, cdist,
+                               NULL, 1, rdist,
+                               CUFFT_Z2D, ncomp);
+        if (result != CUFFT_SUCCESS) {
+            Abort("StokesFFT: cufftPlanMany backward failed");
+        }
+#else
+        forward_plan = fftw_plan_many_dft_r2c(AMREX_SPACEDIM, n, ncomp,
+                                              real_field->dataPtr(),
+                                              NULL, 1, rdist,
+                                              reinterpret_cast<fftw_complex*>
+                                              (spectral_field->dataPtr()),
+                                              NULL, 1, cdist,
+                                              FFTW_ESTIMATE);
+        backward_plan = fftw_plan_many_dft_c2r(AMREX_SPACEDIM, n, ncomp,
+                                               reinterpret_cast<fftw_complex*>
+                                               (spectral_field->dataPtr()),
+                                               NULL, 1, cdist,
+                                               real_field->dataPtr(),
+                                               NULL, 1, rdist,
+                                               FFTW_ESTIMATE);
+#endif
+        have_plans = true;
+    }
+}
+
+StokesFFT::~StokesFFT () {
+
+    if (have_plans) {
+#ifdef AMREX_USE_CUDA
+        cufftDestroy(forward_plan);
+        cufftDestroy(backward_plan);
+#else
+        fftw_destroy_plan(forward_plan);
+        fftw_destroy_plan(backward_plan);
+#endif
+    }
+}
+
+bool StokesFFT::DefinedOn (const BoxArray& ba_in,
+                           const DistributionMapping& dmap_in,
+                           const Geometry& geom_in) const {
+
+    return ba == ba_in && dmap == dmap_in && domain == geom_in.Domain();
+}
+
+bool StokesFFT::Exact (const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
+                       const Real & theta_alpha,
+                       const Geometry & geom) {
+
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        if (!geom.isPeriodic(d)) {
+            return false;
+        }
+    }
+
+    // for positive visc_types, beta and gamma are constant in space
+    if (visc_type < 1 || visc_type > 3) {
+        return false;
+    }
+
+    if (theta_alpha != 0.) {
+        Real alpha_min = alpha_fc[0].min(0);
+        Real alpha_max = alpha_fc[0].max(0);
+        for (int d=1; d<AMREX_SPACEDIM; ++d) {
+            alpha_min = amrex::min(alpha_min, alpha_fc[d].min(0));
+            alpha_max = amrex::max(alpha_max, alpha_fc[d].max(0));
+        }
+        if (alpha_min != alpha_max) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// In Fourier space (wavenumber index m, theta_d = 2 pi m_d / n_d) the face-to-cell
+// divergence and the cell-to-face gradient in direction d are multiplications by
+//   D_d = (exp(i theta_d) - 1) / dx_d,   G_d = (1 - exp(-i theta_d)) / dx_d,
+// and D_d G_d = -s2_d with s2_d = 2 (1 - cos theta_d) / dx_d^2.
+// With S2 = sum_d s2_d, the viscous operator is (beta S2) u_d - c G_d (D.u), where
+// c = 0, beta, beta/3 + gamma for abs(visc_type) = 1, 2, 3.
+// Writing a = theta_alpha*alpha + beta S2 and sigma = D.u = -b_p, the system
+//   a u_d - c G_d sigma + G_d p = b_u_d
+// gives p = ((a + c S2) sigma - D.b_u) / S2, u_d = (b_u_d - G_d p + c G_d sigma) / a.
+void StokesFFT::Solve (const std::array<MultiFab, AMREX_SPACEDIM> & b_u,
+                       const MultiFab & b_p,
+                       std::array<MultiFab, AMREX_SPACEDIM> & x_u,
+                       MultiFab & x_p,
+                       const std::array<MultiFab, AMREX_SPACEDIM> & alpha_fc,
+                       const MultiFab & beta,
+                       const MultiFab & gamma,
+                       const Real & theta_alpha,
+                       const Geometry & geom) {
+
+    BL_PROFILE_VAR("StokesFFT::Solve()", StokesFFT_Solve);
+
+    if (geom.Domain() != domain) {
+        Abort("StokesFFT::Solve() - domain does not match the one used to build the solver");
+    }
+
+    // domain-averaged coefficients
+    // for constant coefficients these are the coefficients themselves
+    Vector<Real> alpha_avg(AMREX_SPACEDIM);
+    SumStag(alpha_fc, alpha_avg, true);
+
+    Real alpha_mean = 0.;
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        alpha_mean += alpha_avg[d]/AMREX_SPACEDIM;
+    }
+
+    Real beta_mean, gamma_mean;
+    SumCC(beta , 0, beta_mean , true);
+    SumCC(gamma, 0, gamma_mean, true);
+
+    const Real ta = theta_alpha*alpha_mean;
+    const Real bt = beta_mean;
+
+    Real cgd = 0.;
+    if (amrex::Math::abs(visc_type) == 2) {
+        cgd = beta_mean;
+    } else if (amrex::Math::abs(visc_type) == 3) {
+        cgd = beta_mean/3. + gamma_mean;
+    }
+
+    // the k=0 mode of the velocity is undetermined if ta = 0; keep the mean of the guess
+    Vector<Real> mean_u(AMREX_SPACEDIM, 0.);
+    if (ta == 0.) {
+        SumStag(x_u, mean_u, true);
+    }
+
+    // copy the right hand side onto the single grid
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        u_onegrid[d].ParallelCopy(b_u[d], 0, 0, 1);
+    }
+    p_onegrid.ParallelCopy(b_p, 0, 0, 1);
+
+    const GpuArray<Real,AMREX_SPACEDIM> dx = geom.CellSizeArray();
+
+    GpuArray<int,3> n {1,1,1};
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        n[d] = domain.length(d);
+    }
+
+    const Real npts_inv = 1./domain.d_numPts();
+
+    const Real pi = 3.1415926535897932;
+
+    for (MFIter mfi(p_onegrid); mfi.isValid(); ++mfi) {
+
+        Array4<Real> const& field = real_field->array();
+        Array4<GpuComplex<Real> > const& spectral = spectral_field->array();
+
+        AMREX_D_TERM(Array4<Real> const& ux = u_onegrid[0].array(mfi);,
+                     Array4<Real> const& uy = u_onegrid[1].array(mfi);,
+                     Array4<Real> const& uz = u_onegrid[2].array(mfi););
+        Array4<Real> const& pr = p_onegrid.array(mfi);
+
+        // the face at index i in direction d is stored at cell index i; faces on the high side
+        // of the domain are the periodic images of the ones on the low side
+        amrex::ParallelFor(domain, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        {
+            AMREX_D_TERM(field(i,j,k,0) = ux(i,j,k);,
+                         field(i,j,k,1) = uy(i,j,k);,
+                         field(i,j,k,2) = uz(i,j,k););
+            field(i,j,k,AMREX_SPACEDIM) = pr(i,j,k);
+        });
+
+        Gpu::streamSynchronize();
+
+#ifdef AMREX_USE_CUDA
+        cufftSetStream(forward_plan, Gpu::gpuStream());
+        cufftResult result = cufftExecD2Z(forward_plan, real_field->dataPtr(),
+                                          reinterpret_cast<cuDoubleComplex*>
+                                          (spectral_field->dataPtr()));
+        if (result != CUFFT_SUCCESS) {
+            Abort("StokesFFT: forward transform using cufftExec failed");
+        }
+#else
+        fftw_execute(forward_plan);
+#endif
+
+        const Box& spectral_bx = spectral_field->box();
+
+        amrex::ParallelFor(spectral_bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        {
+            const int m[3] = {i,j,k};
+
+            GpuComplex<Real> Gm[AMREX_SPACEDIM];
+            GpuComplex<Real> Dm[AMREX_SPACEDIM];
+            Real S2 = 0.;
+            for (int d=0; d<AMREX_SPACEDIM; ++d) {
+                Real theta = 2.*pi*m[d]/n[d];
+                Real c = std::cos(theta);
+                Real s = std::sin(theta);
+                Gm[d] = GpuComplex<Real>((1.-c)/dx[d], s/dx[d]);
+                Dm[d] = GpuComplex<Real>((c-1.)/dx[d], s/dx[d]);
+                S2 += 2.*(1.-c)/(dx[d]*dx[d]);
+            }
+
+            const Real a = ta + bt*S2;
+
+            if (S2 == 0.) {
+                // mean mode: the pressure has zero mean
+                for (int d=0; d<AMREX_SPACEDIM; ++d) {
+                    spectral(i,j,k,d) = (a != 0.) ? spectral(i,j,k,d)*(npts_inv/a)
+                                                  : GpuComplex<Real>(0.,0.);
+                }
+                spectral(i,j,k,AMREX_SPACEDIM) = GpuComplex<Real>(0.,0.);
+                return;
+            }
+
+            const GpuComplex<Real> sigma = Real(-1.)*spectral(i,j,k,AMREX_SPACEDIM);
+
+            GpuComplex<Real> Db(0.,0.);
+            for (int d=0; d<AMREX_SPACEDIM; ++d) {
+                Db += Dm[d]*spectral(i,j,k,d);
+            }
+
+            const GpuComplex<Real> p = ((a + cgd*S2)*sigma - Db) / S2;
+
+            for (int d=0; d<AMREX_SPACEDIM; ++d) {
+                spectral(i,j,k,d) = (spectral(i,j,k,d) - Gm[d]*p + cgd*Gm[d]*sigma) * (npts_inv/a);
+            }
+            spectral(i,j,k,AMREX_SPACEDIM) = p*npts_inv;
+        });
+
+#ifdef AMREX_USE_CUDA
+        cufftSetStream(backward_plan, Gpu::gpuStream());
+        result = cufftExecZ2D(backward_plan,
+                              reinterpret_cast<cuDoubleComplex*>(spectral_field->dataPtr()),
+                              real_field->dataPtr());
+        if (result != CUFFT_SUCCESS) {
+            Abort("StokesFFT: backward transform using cufftExec failed");
+        }
+#else
+        fftw_execute(backward_plan);
+#endif
+
+        const auto dlo = amrex::lbound(domain);
+        const auto dhi = amrex::ubound(domain);
+
+        for (int d=0; d<AMREX_SPACEDIM; ++d) {
+            Array4<Real> const& u = u_onegrid[d].array(mfi);
+            const Box& bx = mfi.nodaltilebox(d);
+            amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+            {
+                int ii = (i > dhi.x) ? dlo.x : i;
+                int jj = (j > dhi.y) ? dlo.y : j;
+                int kk = (k > dhi.z) ? dlo.z : k;
+                u(i,j,k) = field(ii,jj,kk,d);
+            });
+        }
+
+        amrex::ParallelFor(domain, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        {
+            pr(i,j,k) = field(i,j,k,AMREX_SPACEDIM);
+        });
+    }
+
+    // copy the solution back to the original grids
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        x_u[d].ParallelCopy(u_onegrid[d], 0, 0, 1);
+        if (ta == 0.) {
+            x_u[d].plus(mean_u[d], 0, 1, 0);
+        }
+    }
+    x_p.ParallelCopy(p_onegrid, 0, 0, 1);
+}
+
+StokesFFT& PersistentStokesFFT (const BoxArray& ba_in,
+                                const DistributionMapping& dmap_in,
+                                const Geometry& geom_in) {
+
+    static std::unique_ptr<StokesFFT> stokes_fft;
+    static bool registered = false;
+
+    if (!stokes_fft || !stokes_fft->DefinedOn(ba_in,dmap_in,geom_in)) {
+        // free the old solver before building the new one
+        stokes_fft.reset();
+        stokes_fft = std::make_unique<StokesFFT>(ba_in,dmap_in,geom_in);
+    }
+
+    if (!registered) {
+        // the MultiFabs have to be freed before AMReX shuts down its memory arenas
+        amrex::ExecOnFinalize([] () { stokes_fft.reset(); registered = false; });
+        registered = true;
+    }
+
+    return *stokes_fft;
+}
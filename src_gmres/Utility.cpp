@@ -67,3 +67,235 @@ void CCApplyNegLap(MultiFab& phi,
 
     mlmg.apply({&Lphi},{&phi});
 }
+
+// add fac times the local (this rank only) sums of w*V(n), n=0..nv-1, and w*w to dots
+// for face-centered data (dir >= 0) faces on the boundary of a grid get weight 1/2, as in SumStag
+static void LocalMultiDot(const MultiFab& w,
+                          const MultiFab& V,
+                          int nv,
+                          int dir,
+                          Real fac,
+                          Vector<Real>& dots)
+{
+#ifdef AMREX_USE_GPU
+    // no runtime-sized reduction tuples on the GPU, so one local reduction kernel per vector
+    ReduceOps<ReduceOpSum> reduce_op;
+
+    for (int n=0; n<=nv; ++n) {
+
+        ReduceData<Real> reduce_data(reduce_op);
+        using ReduceTuple = typename decltype(reduce_data)::Type;
+
+        for (MFIter mfi(w,TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+
+            const Box& bx = mfi.tilebox();
+            const Box& bx_grid = mfi.validbox();
+
+            auto const& w_fab = w.const_array(mfi);
+            auto const& v_fab = (n < nv) ? V.const_array(mfi,n) : w.const_array(mfi);
+
+            int lo = (dir >= 0) ? bx_grid.smallEnd(dir) : 0;
+            int hi = (dir >= 0) ? bx_grid.bigEnd(dir)   : 0;
+
+            reduce_op.eval(bx, reduce_data,
+            [=] AMREX_GPU_DEVICE (int i, int j, int k) -> ReduceTuple
+            {
+                Real weight = 1.;
+                if (dir >= 0) {
+                    int idx = (dir == 0) ? i : ((dir == 1) ? j : k);
+                    weight = (idx>lo && idx<hi) ? 1.0 : 0.5;
+                }
+                return {w_fab(i,j,k)*v_fab(i,j,k)*weight};
+            });
+        }
+
+        dots[n] += fac*amrex::get<0>(reduce_data.value());
+    }
+#else
+    // all nv+1 sums in one pass over the data
+#ifdef AMREX_USE_OMP
+#pragma omp parallel
+#endif
+    {
+        Vector<Real> priv(nv+1, 0.);
+
+        for (MFIter mfi(w,TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+
+            const Box& bx = mfi.tilebox();
+            const Box& bx_grid = mfi.validbox();
+
+            auto const& w_fab = w.const_array(mfi);
+            auto const& v_fab = V.const_array(mfi);
+
+            const Dim3 lo = amrex::lbound(bx);
+            const Dim3 hi = amrex::ubound(bx);
+
+            int glo = (dir >= 0) ? bx_grid.smallEnd(dir) : 0;
+            int ghi = (dir >= 0) ? bx_grid.bigEnd(dir)   : 0;
+
+            for (int k = lo.z; k <= hi.z; ++k) {
+            for (int j = lo.y; j <= hi.y; ++j) {
+            for (int i = lo.x; i <= hi.x; ++i) {
+                Real weight = 1.;
+                if (dir >= 0) {
+                    int idx = (dir == 0) ? i : ((dir == 1) ? j : k);
+                    weight = (idx>glo && idx<ghi) ? 1.0 : 0.5;
+                }
+                Real ww = w_fab(i,j,k)*weight;
+                for (int n=0; n<nv; ++n) {
+                    priv[n] += ww*v_fab(i,j,k,n);
+                }
+                priv[nv] += ww*w_fab(i,j,k);
+            }
+            }
+            }
+        }
+
+#ifdef AMREX_USE_OMP
+#pragma omp critical (gmres_multidot)
+#endif
+        for (int n=0; n<=nv; ++n) {
+            dots[n] += fac*priv[n];
+        }
+    }
+#endif
+}
+
+// local part of KrylovMultiDot, without the reduction over ranks
+static void KrylovMultiDotLocal(const std::array<MultiFab, AMREX_SPACEDIM>& w_u,
+                                const MultiFab& w_p,
+                                const std::array<MultiFab, AMREX_SPACEDIM>& V_u,
+                                const MultiFab& V_p,
+                                int nv,
+                                Vector<Real>& dots)
+{
+    dots.resize(nv+1);
+    std::fill(dots.begin(), dots.end(), 0.);
+
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        LocalMultiDot(w_u[d], V_u[d], nv, d, 1., dots);
+    }
+    LocalMultiDot(w_p, V_p, nv, -1, p_norm_weight*p_norm_weight, dots);
+}
+
+void KrylovMultiDot(const std::array<MultiFab, AMREX_SPACEDIM>& w_u,
+                    const MultiFab& w_p,
+                    const std::array<MultiFab, AMREX_SPACEDIM>& V_u,
+                    const MultiFab& V_p,
+                    int nv,
+                    Vector<Real>& dots)
+{
+    BL_PROFILE_VAR("KrylovMultiDot()",KrylovMultiDot);
+
+    KrylovMultiDotLocal(w_u, w_p, V_u, V_p, nv, dots);
+
+    ParallelDescriptor::ReduceRealSum(dots.data(), nv+1);
+}
+
+void KrylovMultiDotBegin(const std::array<MultiFab, AMREX_SPACEDIM>& w_u,
+                         const MultiFab& w_p,
+                         const std::array<MultiFab, AMREX_SPACEDIM>& V_u,
+                         const MultiFab& V_p,
+                         int nv,
+                         Vector<Real>& dots,
+                         MPI_Request& request)
+{
+    BL_PROFILE_VAR("KrylovMultiDotBegin()",KrylovMultiDotBegin);
+
+    KrylovMultiDotLocal(w_u, w_p, V_u, V_p, nv, dots);
+
+#ifdef AMREX_USE_MPI
+    MPI_Iallreduce(MPI_IN_PLACE, dots.data(), nv+1, ParallelDescriptor::Mpi_typemap<Real>::type(),
+                   MPI_SUM, ParallelDescriptor::Communicator(), &request);
+#else
+    amrex::ignore_unused(request);
+#endif
+}
+
+void KrylovMultiDotWait(MPI_Request& request)
+{
+    BL_PROFILE_VAR("KrylovMultiDotWait()",KrylovMultiDotWait);
+
+#ifdef AMREX_USE_MPI
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+#else
+    amrex::ignore_unused(request);
+#endif
+}
+
+void KrylovMultiUpdate(std::array<MultiFab, AMREX_SPACEDIM>& w_u,
+                       MultiFab& w_p,
+                       const std::array<MultiFab, AMREX_SPACEDIM>& V_u,
+                       const MultiFab& V_p,
+                       int nv,
+                       const Vector<Real>& h,
+                       int vcomp)
+{
+    BL_PROFILE_VAR("KrylovMultiUpdate()",KrylovMultiUpdate);
+
+    Gpu::DeviceVector<Real> h_d(nv);
+    Gpu::copy(Gpu::hostToDevice, h.begin(), h.begin()+nv, h_d.begin());
+    const Real* hp = h_d.data();
+
+    for (int d=0; d<=AMREX_SPACEDIM; ++d) {
+
+        MultiFab& w       = (d < AMREX_SPACEDIM) ? w_u[d] : w_p;
+        const MultiFab& V = (d < AMREX_SPACEDIM) ? V_u[d] : V_p;
+
+        for (MFIter mfi(w,TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+
+            const Box& bx = mfi.tilebox();
+
+            auto const& w_fab = w.array(mfi);
+            auto const& v_fab = V.const_array(mfi,vcomp);
+
+            amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+            {
+                Real sum = 0.;
+                for (int n=0; n<nv; ++n) {
+                    sum += hp[n]*v_fab(i,j,k,n);
+                }
+                w_fab(i,j,k) -= sum;
+            });
+        }
+    }
+
+    Gpu::streamSynchronize();
+}
+
+// the product is formed in the precision of b, so a copy of a scaled with FabArray::mult compares equal
+template <class MF>
+static int CountDiffT(const MultiFab& a, const MF& b, Real fac, int ng)
+{
+    using T = typename MF::value_type;
+    const T tfac = static_cast<T>(fac);
+
+    ReduceOps<ReduceOpSum> reduce_op;
+    ReduceData<int> reduce_data(reduce_op);
+    using ReduceTuple = typename decltype(reduce_data)::Type;
+
+    for (MFIter mfi(b,TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+        const Box& bx = mfi.growntilebox(ng);
+        auto const& a_fab = a.const_array(mfi);
+        auto const& b_fab = b.const_array(mfi);
+        reduce_op.eval(bx, reduce_data,
+        [=] AMREX_GPU_DEVICE (int i, int j, int k) -> ReduceTuple
+        {
+            return { (static_cast<T>(a_fab(i,j,k))*tfac != b_fab(i,j,k)) ? 1 : 0 };
+        });
+    }
+
+    return amrex::get<0>(reduce_data.value());
+}
+
+int CountDiff(const MultiFab& a, const MultiFab& b, Real fac, int ng)
+{
+    return CountDiffT(a, b, fac, ng);
+}
+
+#ifdef STAG_MG_FLOAT
+int CountDiff(const MultiFab& a, const StagMGFab& b, Real fac, int ng)
+{
+    return CountDiffT(a, b, fac, ng);
+}
+#endif
@@ -3,6 +3,7 @@
 #include "AMReX_ParmParse.H"
 
 int         gmres::precon_type;
+int         gmres::stokes_solver_type;
 int         gmres::visc_schur_approx;
 amrex::Real gmres::p_norm_weight;
 amrex::Real gmres::scale_factor;
@@ -35,6 +36,7 @@ int         gmres::gmres_max_outer;
 int         gmres::gmres_max_inner;
 int         gmres::gmres_max_iter;
 int         gmres::gmres_min_iter;
+int         gmres::gmres_orthogonalization;
 int         gmres::gmres_spatial_order;
 
 void InitializeGmresNamespace() {
@@ -50,8 +52,15 @@ void InitializeGmresNamespace() {
     //-3 = upper triangular preconditioner with negative sign
     // 4 = Block diagonal preconditioner
     //-4 = Block diagonal preconditioner with negative sign
+    // 7 = exact FFT Stokes solve with the domain-averaged coefficients (fully periodic only)
     precon_type = 1;
 
+    // solver used by advanceStokes
+    // 0 = GMRES
+    // 1 = FFT Stokes solver (StokesFFT) when it is exact, i.e., fully periodic with constant
+    //     coefficients, otherwise GMRES
+    stokes_solver_type = 0;
+
     // use the viscosity-based BFBt Schur complement (from Georg Stadler)
     visc_schur_approx = 0;
 
@@ -82,12 +91,14 @@ void InitializeGmresNamespace() {
     stag_mg_minwidth = 2;            // length of box at coarsest multigrid level
     stag_mg_bottom_solver = 0;       // bottom solver type
     // 0 = smooths only, controlled by mg_nsmooths_bottom
+    // 4 = agglomerate the coarsest level onto a single grid and continue multigrid there,
+    //     with up to stag_mg_max_bottom_nlevels additional levels
     stag_mg_nsmooths_down = 2;       // number of smooths at each level on the way down
     stag_mg_nsmooths_up = 2;         // number of smooths at each level on the way up
     stag_mg_nsmooths_bottom = 8;     // number of smooths at the bottom
     stag_mg_max_bottom_nlevels = 10; // for stag_mg_bottom_solver 4, number of additional levels of multigrid
     stag_mg_omega = 1.;              // weightee-jacobi omega coefficient
-    stag_mg_smoother = 1;            // 0 = jacobi; 1 = 2*dm-color Gauss-Seidel
+    stag_mg_smoother = 1;            // 0 = jacobi; 1 = 2*dm-color Gauss-Seidel; 2 = Chebyshev
     stag_mg_rel_tol = 1.e-9;         // relative tolerance stopping criteria
 
     // GMRES solver parameters
@@ -99,6 +110,14 @@ void InitializeGmresNamespace() {
     gmres_max_iter = 100;      // max number of gmres iterations
     gmres_min_iter = 1;        // min number of gmres iterations
 
+    // orthogonalization of the Krylov vectors
+    // 0 = modified Gram-Schmidt (one reduction per previous vector)
+    // 1 = classical Gram-Schmidt (one fused reduction per Krylov step)
+    // 2 = classical Gram-Schmidt with one reorthogonalization pass (two reductions per step)
+    // 3 = pipelined classical Gram-Schmidt (p(1)-GMRES); the reduction of each step runs in the
+    //     background while the matrix and preconditioner of the next step are applied
+    gmres_orthogonalization = 0;
+
     gmres_spatial_order = 2;   // spatial order of viscous and gradient operators in matrix "A"
 
     ParmParse pp;
@@ -108,6 +127,7 @@ void InitializeGmresNamespace() {
     // pp.getarr and queryarr("string",inputs,start_indx,count); can be used for arrays
 
     pp.query("precon_type",precon_type);
+    pp.query("stokes_solver_type",stokes_solver_type);
     pp.query("visc_schur_approx",visc_schur_approx);
     pp.query("p_norm_weight",p_norm_weight);
     pp.query("scale_factor",scale_factor);
@@ -140,6 +160,7 @@ void InitializeGmresNamespace() {
     pp.query("gmres_max_inner",gmres_max_inner);
     pp.query("gmres_max_iter",gmres_max_iter);
     pp.query("gmres_min_iter",gmres_min_iter);
+    pp.query("gmres_orthogonalization",gmres_orthogonalization);
     pp.query("gmres_spatial_order",gmres_spatial_order);
 
 }
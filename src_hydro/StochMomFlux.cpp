@@ -7,6 +7,8 @@
 #include <AMReX_MultiFabUtil.H>
 #include <AMReX_VisMF.H>
 
+#include <limits>
+
 // initialize n_rngs, geom
 // build MultiFabs to hold random numbers
 StochMomFlux::StochMomFlux(BoxArray ba_in, DistributionMapping dmap_in, Geometry geom_in,
@@ -24,20 +26,39 @@ StochMomFlux::StochMomFlux(BoxArray ba_in, DistributionMapping dmap_in, Geometry
     // keep a local geometry object so we won't always have to pass one in
     geom = geom_in;
 
+    ba = ba_in;
+    dmap = dmap_in;
+
+    in_kernel_noise = (rng_field_type == 2);
+
+    if (in_kernel_noise) {
+        if (n_rngs > 2) {
+            Abort("StochMomFlux: in-kernel noise (rng_field_type=2) supports at most 2 random number stages");
+        }
+        noise_fields.resize(n_rngs);
+    }
+    else {
+        defineNoise();
+    }
+}
+
+// build MultiFabs to hold random numbers
+void StochMomFlux::defineNoise() {
+
     // resize these to hold the number of RNG stages
     mflux_cc.resize(n_rngs);
     mflux_ed.resize(n_rngs);
     //filtering_width=1;
     // Here we store all the random number stages at all spatial locations
     for (int i=0; i<n_rngs; ++i) {
-        mflux_cc[i].define(ba_in, dmap_in, AMREX_SPACEDIM, amrex::max(1,filtering_width));
+        mflux_cc[i].define(ba, dmap, AMREX_SPACEDIM, amrex::max(1,filtering_width));
         mflux_cc[i].setVal(0.);
 #if (AMREX_SPACEDIM == 2)
-        mflux_ed[i][0].define(convert(ba_in,nodal_flag), dmap_in, ncomp_ed, filtering_width);
+        mflux_ed[i][0].define(convert(ba,nodal_flag), dmap, ncomp_ed, filtering_width);
 #elif (AMREX_SPACEDIM == 3)
-        mflux_ed[i][0].define(convert(ba_in,nodal_flag_xy), dmap_in, ncomp_ed, filtering_width);
-        mflux_ed[i][1].define(convert(ba_in,nodal_flag_xz), dmap_in, ncomp_ed, filtering_width);
-        mflux_ed[i][2].define(convert(ba_in,nodal_flag_yz), dmap_in, ncomp_ed, filtering_width);
+        mflux_ed[i][0].define(convert(ba,nodal_flag_xy), dmap, ncomp_ed, filtering_width);
+        mflux_ed[i][1].define(convert(ba,nodal_flag_xz), dmap, ncomp_ed, filtering_width);
+        mflux_ed[i][2].define(convert(ba,nodal_flag_yz), dmap, ncomp_ed, filtering_width);
 #endif
         for (int d=0; d<NUM_EDGE; ++d) {
             mflux_ed[i][d].setVal(0.);
@@ -45,14 +66,14 @@ StochMomFlux::StochMomFlux(BoxArray ba_in, DistributionMapping dmap_in, Geometry
     }
 
     // Temporary storage for linear combinations of random number stages
-    mflux_cc_weighted.define(ba_in, dmap_in, AMREX_SPACEDIM, amrex::max(1,filtering_width));
+    mflux_cc_weighted.define(ba, dmap, AMREX_SPACEDIM, amrex::max(1,filtering_width));
     mflux_cc_weighted.setVal(0.);
 #if (AMREX_SPACEDIM == 2)
-    mflux_ed_weighted[0].define(convert(ba_in,nodal_flag), dmap_in, ncomp_ed, filtering_width);
+    mflux_ed_weighted[0].define(convert(ba,nodal_flag), dmap, ncomp_ed, filtering_width);
 #elif (AMREX_SPACEDIM == 3)
-    mflux_ed_weighted[0].define(convert(ba_in,nodal_flag_xy), dmap_in, ncomp_ed, filtering_width);
-    mflux_ed_weighted[1].define(convert(ba_in,nodal_flag_xz), dmap_in, ncomp_ed, filtering_width);
-    mflux_ed_weighted[2].define(convert(ba_in,nodal_flag_yz), dmap_in, ncomp_ed, filtering_width);
+    mflux_ed_weighted[0].define(convert(ba,nodal_flag_xy), dmap, ncomp_ed, filtering_width);
+    mflux_ed_weighted[1].define(convert(ba,nodal_flag_xz), dmap, ncomp_ed, filtering_width);
+    mflux_ed_weighted[2].define(convert(ba,nodal_flag_yz), dmap, ncomp_ed, filtering_width);
     for (int d=0; d<NUM_EDGE; ++d) {
         mflux_ed_weighted[d].setVal(0.);
     }
@@ -78,6 +99,17 @@ void StochMomFlux::fillMomStochastic() {
     
     BL_PROFILE_VAR("fillMomStochastic()",StochMomFlux);
 
+    // in-kernel noise: only reserve a new stream for each stage and field
+    if (in_kernel_noise) {
+        for (int i=0; i<n_rngs; ++i) {
+            for (int f=0; f<NUM_EDGE+1; ++f) {
+                noise_fields[i][f] = MakeRandomField(geom);
+            }
+        }
+        noise_stored = false;
+        return;
+    }
+
     for (int i=0; i<n_rngs; ++i) {
 
         switch(stoch_stress_form) {
@@ -109,11 +141,46 @@ void StochMomFlux::fillMomStochastic() {
 }
 
 
+// with in-kernel noise, fill mflux_cc and mflux_ed with the same random numbers
+// StochMomFluxDiv generates on the fly, for the variants that read the stored fields
+void StochMomFlux::storeNoise() {
+
+    if (noise_stored) {
+        return;
+    }
+
+    if (!mflux_cc_weighted.ok()) {
+        defineNoise();
+    }
+
+    Real var_cc = (stoch_stress_form == 0) ? 1.0 : 2.0;
+
+    for (int i=0; i<n_rngs; ++i) {
+        for (int n=0; n<AMREX_SPACEDIM; ++n) {
+            MultiFabFillRandomField(mflux_cc[i],n,var_cc,noise_fields[i][0],geom);
+        }
+        for (int d=0; d<NUM_EDGE; ++d) {
+            MultiFabFillRandomField(mflux_ed[i][d],0,1.0,noise_fields[i][d+1],geom);
+            if (stoch_stress_form == 0) {
+                MultiFabFillRandomField(mflux_ed[i][d],1,1.0,noise_fields[i][d+1],geom);
+            } else {
+                MultiFab::Copy(mflux_ed[i][d], mflux_ed[i][d], 0, 1, ncomp_ed-1, 0);
+            }
+        }
+    }
+
+    noise_stored = true;
+}
+
 // create weighted sum of stage RNGs and store in mflux_cc_weighted and mflux_ed_weighted
 void StochMomFlux::weightMomflux(Vector< amrex::Real > weights) {
     
     BL_PROFILE_VAR("weightMomFlux()",weightMomFlux);
 
+    if (in_kernel_noise) {
+        storeNoise();
+    }
+
     mflux_cc_weighted.setVal(0.0);
     for (int d=0; d<NUM_EDGE; ++d) {
         mflux_ed_weighted[d].setVal(0.0);
@@ -684,6 +751,11 @@ void StochMomFlux::StochMomFluxDiv(std::array< MultiFab, AMREX_SPACEDIM >& m_for
 
     BL_PROFILE_VAR("StochMomFluxDiv()",StochMomFluxDiv);
 
+    if (in_kernel_noise) {
+        StochMomFluxDivInKernel(m_force,increment,eta_cc,eta_ed,temp_cc,temp_ed,weights,dt);
+        return;
+    }
+
     // Take linear combination of mflux multifabs at each stage
     StochMomFlux::weightMomflux(weights);
 
@@ -785,6 +857,214 @@ void StochMomFlux::StochMomFluxDiv(std::array< MultiFab, AMREX_SPACEDIM >& m_for
     }
 }
 
+// weighted, scaled noise on cell centers, as stored in mflux_cc_weighted by StochMomFluxDiv
+// zero outside the domain in non-periodic directions
+AMREX_GPU_HOST_DEVICE AMREX_FORCE_INLINE
+Real noise_cc (int i, int j, int k, int n, const StochNoise& noise,
+               Array4<Real const> const& eta, Array4<Real const> const& temp,
+               GpuArray<int,3> const& lo, GpuArray<int,3> const& hi)
+{
+    const int idx[3] = {i,j,k};
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        if (idx[d] < lo[d] || idx[d] > hi[d]) {
+            return 0.;
+        }
+    }
+    return noise(i,j,k,n)*std::sqrt(eta(i,j,k)*temp(i,j,k));
+}
+
+// weighted, scaled noise on nodes (2D) or edges (3D) that are nodal in directions d1 and d2,
+// as stored in mflux_ed_weighted by StochMomFluxDiv, including the wall factors of MomFluxBC
+// for the symmetric form both components are generated from component 0
+AMREX_GPU_HOST_DEVICE AMREX_FORCE_INLINE
+Real noise_ed (int i, int j, int k, int n, const StochNoise& noise,
+               Array4<Real const> const& eta, Array4<Real const> const& temp,
+               int d1, int d2, int sym,
+               GpuArray<int,3> const& lo, GpuArray<int,3> const& hi,
+               GpuArray<Real,3> const& fac_lo, GpuArray<Real,3> const& fac_hi)
+{
+    const int idx[3] = {i,j,k};
+    Real fac = 1.;
+    if (idx[d1] == lo[d1])   fac *= fac_lo[d1];
+    if (idx[d1] == hi[d1]+1) fac *= fac_hi[d1];
+    if (idx[d2] == lo[d2])   fac *= fac_lo[d2];
+    if (idx[d2] == hi[d2]+1) fac *= fac_hi[d2];
+    return fac*noise(i,j,k,sym ? 0 : n)*std::sqrt(eta(i,j,k)*temp(i,j,k));
+}
+
+// compute stochastic momentum flux divergence with the noise generated inside the kernel
+// same result as the stored path of StochMomFluxDiv for the same streams, without filling,
+// weighting, scaling or communicating mflux_cc_weighted and mflux_ed_weighted
+void StochMomFlux::StochMomFluxDivInKernel(std::array< MultiFab, AMREX_SPACEDIM >& m_force,
+                                           const int& increment,
+                                           const MultiFab& eta_cc,
+                                           const std::array< MultiFab, NUM_EDGE >& eta_ed,
+                                           const MultiFab& temp_cc,
+                                           const std::array< MultiFab, NUM_EDGE >& temp_ed,
+                                           const Vector< amrex::Real >& weights,
+                                           const amrex::Real& dt) {
+
+    BL_PROFILE_VAR("StochMomFluxDivInKernel()",StochMomFluxDivInKernel);
+
+    const Real* dx = geom.CellSize();
+    Real dVol = (AMREX_SPACEDIM==2) ? dx[0]*dx[1]*cell_depth : dx[0]*dx[1]*dx[2];
+
+    // Compute variance using computed differential volume
+    Real variance = sqrt(variance_coef_mom*2.0*k_B/(dVol*dt));
+
+    // see fillMomStochastic() for the variances of the cell-centered and edge noise
+    int sym = (stoch_stress_form != 0);
+    Real stddev_cc = sym ? sqrt(2.) : 1.;
+
+    // weighted sum of the (at most 2) stages for the cell-centered field and each edge type
+    std::array< StochNoise, NUM_EDGE+1 > noise;
+    for (int f=0; f<NUM_EDGE+1; ++f) {
+        noise[f].in_kernel = 1;
+        noise[f].A = noise_fields[0][f];
+        noise[f].w_A = weights[0];
+        noise[f].B = (n_rngs > 1) ? noise_fields[1][f] : noise_fields[0][f];
+        noise[f].w_B = (n_rngs > 1) ? weights[1] : 0.;
+        for (int n=0; n<MAX_SPECIES+5; ++n) {
+            noise[f].scale[n] = (f == 0) ? variance*stddev_cc : variance;
+        }
+    }
+
+    // domain bounds; outside the domain the cell-centered noise is only nonzero
+    // across periodic boundaries
+    const Box& dom = geom.Domain();
+    GpuArray<int,3> dom_lo {0,0,0};
+    GpuArray<int,3> dom_hi {0,0,0};
+    GpuArray<int,3> cc_lo {0,0,0};
+    GpuArray<int,3> cc_hi {0,0,0};
+
+    // 1 = slip wall   : multiply fluxes on wall by 0
+    // 2 = no-slip wall: multiply fluxes on wall by sqrt(2)
+    GpuArray<Real,3> fac_lo {1.,1.,1.};
+    GpuArray<Real,3> fac_hi {1.,1.,1.};
+
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        dom_lo[d] = dom.smallEnd(d);
+        dom_hi[d] = dom.bigEnd(d);
+        cc_lo[d] = geom.isPeriodic(d) ? std::numeric_limits<int>::lowest() : dom_lo[d];
+        cc_hi[d] = geom.isPeriodic(d) ? std::numeric_limits<int>::max()    : dom_hi[d];
+
+        if (bc_vel_lo[d] == 1 || bc_vel_lo[d] == 2) {
+            fac_lo[d] = (bc_vel_lo[d] == 1) ? 0. : sqrt(2.);
+        }
+        else if (bc_vel_lo[d] != -1) {
+            Abort("MomFluxBC unsupported bc type");
+        }
+
+        if (bc_vel_hi[d] == 1 || bc_vel_hi[d] == 2) {
+            fac_hi[d] = (bc_vel_hi[d] == 1) ? 0. : sqrt(2.);
+        }
+        else if (bc_vel_hi[d] != -1) {
+            Abort("MomFluxBC unsupported bc type");
+        }
+    }
+
+    // calculate divergence and add to stoch_m_force
+    Real dxinv = 1./(geom.CellSize()[0]);
+
+    // if not incrementing, initialize data to zero
+    if (increment == 0) {
+        for (int dir=0; dir<AMREX_SPACEDIM; ++dir) {
+            m_force[dir].setVal(0.,0,1,0);
+        }
+    }
+
+    const StochNoise n_cc = noise[0];
+#if (AMREX_SPACEDIM == 2)
+    const StochNoise n_nd = noise[1];
+#elif (AMREX_SPACEDIM == 3)
+    const StochNoise n_xy = noise[1];
+    const StochNoise n_xz = noise[2];
+    const StochNoise n_yz = noise[3];
+#endif
+
+    // Loop over boxes
+    for (MFIter mfi(eta_cc); mfi.isValid(); ++mfi) {
+
+        const Array4<Real const> & eta_c  = eta_cc.array(mfi);
+        const Array4<Real const> & temp_c = temp_cc.array(mfi);
+#if (AMREX_SPACEDIM == 2)
+        const Array4<Real const> & eta_nd  = eta_ed[0].array(mfi);
+        const Array4<Real const> & temp_nd = temp_ed[0].array(mfi);
+#elif (AMREX_SPACEDIM == 3)
+        const Array4<Real const> & eta_xy  = eta_ed[0].array(mfi);
+        const Array4<Real const> & eta_xz  = eta_ed[1].array(mfi);
+        const Array4<Real const> & eta_yz  = eta_ed[2].array(mfi);
+        const Array4<Real const> & temp_xy = temp_ed[0].array(mfi);
+        const Array4<Real const> & temp_xz = temp_ed[1].array(mfi);
+        const Array4<Real const> & temp_yz = temp_ed[2].array(mfi);
+#endif
+
+        AMREX_D_TERM(const Array4<Real> & divx = m_force[0].array(mfi);,
+                     const Array4<Real> & divy = m_force[1].array(mfi);,
+                     const Array4<Real> & divz = m_force[2].array(mfi););
+
+        AMREX_D_TERM(Box bx_x = mfi.validbox();,
+                     Box bx_y = mfi.validbox();,
+                     Box bx_z = mfi.validbox(););
+
+        AMREX_D_TERM(bx_x.growHi(0);,
+                     bx_y.growHi(1);,
+                     bx_z.growHi(2););
+
+#if (AMREX_SPACEDIM == 2)
+        amrex::ParallelFor(bx_x,bx_y, [=] AMREX_GPU_DEVICE (int i, int j, int k)
+        {
+            divx(i,j,k) += (noise_cc(i  ,j,k,0,n_cc,eta_c,temp_c,cc_lo,cc_hi) -
+                            noise_cc(i-1,j,k,0,n_cc,eta_c,temp_c,cc_lo,cc_hi) +
+                            noise_ed(i,j+1,k,0,n_nd,eta_nd,temp_nd,0,1,sym,dom_lo,dom_hi,fac_lo,fac_hi) -
+                            noise_ed(i,j  ,k,0,n_nd,eta_nd,temp_nd,0,1,sym,dom_lo,dom_hi,fac_lo,fac_hi)) * dxinv;
+        },
+                                      [=] AMREX_GPU_DEVICE (int i, int j, int k)
+        {
+            divy(i,j,k) += (noise_ed(i+1,j,k,1,n_nd,eta_nd,temp_nd,0,1,sym,dom_lo,dom_hi,fac_lo,fac_hi) -
+                            noise_ed(i  ,j,k,1,n_nd,eta_nd,temp_nd,0,1,sym,dom_lo,dom_hi,fac_lo,fac_hi) +
+                            noise_cc(i,j  ,k,1,n_cc,eta_c,temp_c,cc_lo,cc_hi) -
+                            noise_cc(i,j-1,k,1,n_cc,eta_c,temp_c,cc_lo,cc_hi)) * dxinv;
+        });
+
+#elif (AMREX_SPACEDIM == 3)
+        amrex::ParallelFor(bx_x,bx_y,bx_z, [=] AMREX_GPU_DEVICE (int i, int j, int k)
+        {
+            divx(i,j,k) += (noise_cc(i  ,j,k,0,n_cc,eta_c,temp_c,cc_lo,cc_hi) -
+                            noise_cc(i-1,j,k,0,n_cc,eta_c,temp_c,cc_lo,cc_hi) +
+                            noise_ed(i,j+1,k,0,n_xy,eta_xy,temp_xy,0,1,sym,dom_lo,dom_hi,fac_lo,fac_hi) -
+                            noise_ed(i,j  ,k,0,n_xy,eta_xy,temp_xy,0,1,sym,dom_lo,dom_hi,fac_lo,fac_hi) +
+                            noise_ed(i,j,k+1,0,n_xz,eta_xz,temp_xz,0,2,sym,dom_lo,dom_hi,fac_lo,fac_hi) -
+                            noise_ed(i,j,k  ,0,n_xz,eta_xz,temp_xz,0,2,sym,dom_lo,dom_hi,fac_lo,fac_hi)) * dxinv;
+        },
+                                           [=] AMREX_GPU_DEVICE (int i, int j, int k)
+        {
+            divy(i,j,k) += (noise_ed(i+1,j,k,1,n_xy,eta_xy,temp_xy,0,1,sym,dom_lo,dom_hi,fac_lo,fac_hi) -
+                            noise_ed(i  ,j,k,1,n_xy,eta_xy,temp_xy,0,1,sym,dom_lo,dom_hi,fac_lo,fac_hi) +
+                            noise_cc(i,j  ,k,1,n_cc,eta_c,temp_c,cc_lo,cc_hi) -
+                            noise_cc(i,j-1,k,1,n_cc,eta_c,temp_c,cc_lo,cc_hi) +
+                            noise_ed(i,j,k+1,0,n_yz,eta_yz,temp_yz,1,2,sym,dom_lo,dom_hi,fac_lo,fac_hi) -
+                            noise_ed(i,j,k  ,0,n_yz,eta_yz,temp_yz,1,2,sym,dom_lo,dom_hi,fac_lo,fac_hi)) * dxinv;
+        },
+                                           [=] AMREX_GPU_DEVICE (int i, int j, int k)
+        {
+            divz(i,j,k) += (noise_ed(i+1,j,k,1,n_xz,eta_xz,temp_xz,0,2,sym,dom_lo,dom_hi,fac_lo,fac_hi) -
+                            noise_ed(i  ,j,k,1,n_xz,eta_xz,temp_xz,0,2,sym,dom_lo,dom_hi,fac_lo,fac_hi) +
+                            noise_ed(i,j+1,k,1,n_yz,eta_yz,temp_yz,1,2,sym,dom_lo,dom_hi,fac_lo,fac_hi) -
+                            noise_ed(i,j  ,k,1,n_yz,eta_yz,temp_yz,1,2,sym,dom_lo,dom_hi,fac_lo,fac_hi) +
+                            noise_cc(i,j,k  ,2,n_cc,eta_c,temp_c,cc_lo,cc_hi) -
+                            noise_cc(i,j,k-1,2,n_cc,eta_c,temp_c,cc_lo,cc_hi)) * dxinv;
+        });
+#endif
+    }
+
+    // m_force does not have ghost cells
+    // set the value on physical boundaries to zero
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        MultiFabPhysBCDomainVel(m_force[d], geom, d);
+    }
+}
+
 // compute stochastic momentum flux divergence
 void StochMomFlux::StochMomFluxDivWideSplit(std::array< MultiFab, AMREX_SPACEDIM >& m_force,
                                    const int& increment,
@@ -1354,6 +1634,10 @@ void StochMomFlux::StochMomFluxDivOrder3Split(std::array< MultiFab, AMREX_SPACED
 void StochMomFlux::writeMFs(std::array< MultiFab, AMREX_SPACEDIM >& mfluxdiv) {
     
     BL_PROFILE_VAR("writeMFs()",writeMFs);
+
+    if (in_kernel_noise) {
+        storeNoise();
+    }
     
     std::string plotfilename;
     std::string dimStr = "xyz";
@@ -82,10 +82,18 @@ void advanceStokes(std::array< MultiFab, AMREX_SPACEDIM >& umac,
         }
     }
       
-    // call GMRES
-    GMRES gmres(ba,dmap,geom);
-    gmres.Solve(gmres_rhs_u,gmres_rhs_p,umac,pres,
-                alpha_fc,beta,beta_ed,gamma,theta_alpha,geom,norm_pre_rhs);
+    if (stokes_solver_type == 1 && StokesFFT::Exact(alpha_fc,theta_alpha,geom)) {
+        // fully periodic with constant coefficients: solve exactly with FFTs
+        StokesFFT& stokes_fft = PersistentStokesFFT(ba,dmap,geom);
+        stokes_fft.Solve(gmres_rhs_u,gmres_rhs_p,umac,pres,
+                         alpha_fc,beta,gamma,theta_alpha,geom);
+    }
+    else {
+        // call GMRES
+        GMRES& gmres = PersistentGMRES(ba,dmap,geom);
+        gmres.Solve(gmres_rhs_u,gmres_rhs_p,umac,pres,
+                    alpha_fc,beta,beta_ed,gamma,theta_alpha,geom,norm_pre_rhs);
+    }
 
     for (int i=0; i<AMREX_SPACEDIM; i++) {
         MultiFabPhysBCDomainVel(umac[i], geom, i);
@@ -297,13 +305,13 @@ void advanceLowMach(  std::array< MultiFab, AMREX_SPACEDIM >& umac,
   }
 
   // initial guess for new solution
+  // for pressure use the solution of the previous step as initial guess
   for (int d=0; d<AMREX_SPACEDIM; d++) {
     MultiFab::Copy(umacNew[d], umac[d], 0, 0, 1, 0);
   }
-  pres.setVal(0.);  // initial guess
 
   // call GMRES to compute predictor
-  GMRES gmres(ba,dmap,geom);
+  GMRES& gmres = PersistentGMRES(ba,dmap,geom);
   gmres.Solve(gmres_rhs_u,gmres_rhs_p,umacNew,pres,
               alpha_fc,beta_wtd,beta_ed_wtd,gamma_wtd,
               theta_alpha,geom,norm_pre_rhs);
@@ -353,8 +361,8 @@ void advanceLowMach(  std::array< MultiFab, AMREX_SPACEDIM >& umac,
     // initial guess for new solution
     MultiFab::Copy(umacNew[d], umac[d], 0, 0, 1, 0);
   }
-  
-  pres.setVal(0.);  // initial guess
+
+  // for pressure use the predictor solution as initial guess
 
   // call GMRES here
   gmres.Solve(gmres_rhs_u,gmres_rhs_p,umacNew,pres,
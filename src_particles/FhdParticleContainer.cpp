@@ -37,6 +37,31 @@ FhdParticleContainer::FhdParticleContainer(const Geometry & geom,
         Abort("searchDist is greater than half the domain length");
     }
 
+    if (es_tog == 4) {
+        if (ewald_rcut <= 0.) {
+            Abort("es_tog = 4 requires ewald_rcut > 0");
+        }
+        if (ewald_rcut > n_nbhd*geom.CellSize(0)) {
+            Abort("ewald_rcut is larger than the neighbor list range");
+        }
+
+        // erfc(alpha*ewald_rcut) = ewald_tol by bisection
+        Real alpha_lo = 0.;
+        Real alpha_hi = 10./ewald_rcut;
+        for (int it=0; it<100; ++it) {
+            Real alpha_mid = 0.5*(alpha_lo+alpha_hi);
+            if (std::erfc(alpha_mid*ewald_rcut) > ewald_tol) {
+                alpha_lo = alpha_mid;
+            }
+            else {
+                alpha_hi = alpha_mid;
+            }
+        }
+        ewald_alpha = 0.5*(alpha_lo+alpha_hi);
+
+        Print() << "Ewald splitting parameter: " << ewald_alpha << std::endl;
+    }
+
     if (radialdist_int > 0 || cartdist_int > 0) {
 
         // create enough bins to look within a sphere with radius equal to "half" of the domain
@@ -398,6 +423,12 @@ void FhdParticleContainer::computeForcesNLGPU(const MultiFab& charge, const Mult
                                         m_neighbor_list[lev][index], dx, recount, recountI);
 
         }
+
+        if (es_tog==4)
+        {
+            compute_ewald_sr_nl_gpu(particles, Np, Nn,
+                                    m_neighbor_list[lev][index], ewald_alpha, ewald_rcut, recount, recountI);
+        }
     
     }
 
@@ -417,6 +448,38 @@ void FhdParticleContainer::computeForcesNLGPU(const MultiFab& charge, const Mult
             Print() << recount/2 << " p3m interactions.\n";
             Print() << recountI << " image charge interactions.\n";
     }
+    if(es_tog==4) 
+    {
+            ParallelDescriptor::ReduceRealSum(recount);
+            ParallelDescriptor::ReduceRealSum(recountI);
+
+            Print() << recount/2 << " Ewald real space interactions.\n";
+            Print() << recountI << " image charge interactions.\n";
+    }
+}
+
+void FhdParticleContainer::ESKernels(std::function<Real(Real)>& spread,
+                                     std::function<Real(Real)>& interp, int& support) const
+{
+    // same kernels as collect_charge_gpu and emf_gpu
+    if (pkernel_es[0] == 3) {
+        spread = Kernel3P();
+        interp = Kernel4P();
+        support = 2;
+    }
+    else if (pkernel_es[0] == 4) {
+        spread = Kernel4P();
+        interp = Kernel4P();
+        support = 2;
+    }
+    else if (pkernel_es[0] == 6) {
+        spread = Kernel6P();
+        interp = Kernel6P();
+        support = 3;
+    }
+    else {
+        Abort("ESKernels: pkernel_es has to be 3, 4 or 6");
+    }
 }
 
 void FhdParticleContainer::computeForcesCoulombGPU(long totalParticles) {
@@ -544,6 +607,102 @@ void FhdParticleContainer::computeForcesCoulombGPU(long totalParticles) {
 }
 
 
+// points of the wall mobility table per species and radius, and the h = (z - z0)/a beyond which
+// the laws are replaced by their tails
+static constexpr int wall_mob_table_size = 4096;
+static constexpr Real wall_mob_tail_h = 64.;
+
+void FhdParticleContainer::BuildWallMobTable(const species* particleInfo)
+{
+    BL_PROFILE_VAR("BuildWallMobTable()",BuildWallMobTable);
+
+    // the particles are between a wall and the middle of the domain
+    Real half = 0.;
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        if (bc_vel_lo[d] == 2 && bc_vel_hi[d] == 2) {
+            half = std::max(half, 0.5*(prob_hi[d] - prob_lo[d]));
+        }
+    }
+
+    wallMobSize = 0;
+    wallMobData.clear();
+    wallMobMeta.clear();
+
+    if (half == 0. || wall_mob < 1 || wall_mob > 11) {
+        return;
+    }
+
+    const int nh = wall_mob_table_size;
+    const int nrow = 2*nspecies;
+    const Real z0 = wall_mob_offset(wall_mob);
+
+    Vector<Real> data(nrow*WallMobTable::ncol*nh);
+    Vector<Real> meta(nrow*WallMobTable::nmeta);
+
+    // the law at h from the direct evaluation with a = 1
+    auto law = [&] (Real h, int sw, int spec, Real* vals) {
+        mob_interp_gpu(z0 + h, 1., &vals[0], &vals[1], sw, spec+1);
+        mob_interp_der_gpu(z0 + h, 1., &vals[2], &vals[3], sw, spec+1);
+    };
+
+    for (int spec=0; spec<nspecies; ++spec) {
+        for (int sw=0; sw<2; ++sw) {
+
+            const int row = 2*spec + sw;
+
+            // radius as in get_mobility_diff_gpu
+            const Real diff = (sw == 0) ? particleInfo[spec].wetDiff : particleInfo[spec].totalDiff;
+            const Real a = k_B*T_init[0]/(diff*visc_coef*M_PI*6.0);
+
+            const Real hlo = -z0/a;
+            const Real hhi = std::max(std::min((half - z0)/a, wall_mob_tail_h), hlo + 1.);
+            const Real dh = (hhi - hlo)/(nh - 1);
+
+            Real vals[WallMobTable::ncol];
+            for (int n=0; n<nh; ++n) {
+                law(hlo + n*dh, sw, spec, vals);
+                for (int col=0; col<WallMobTable::ncol; ++col) {
+                    data[(row*WallMobTable::ncol + col)*nh + n] = vals[col];
+                }
+            }
+
+            // tails m + c/h through the laws at hhi/2 and hhi, and e/h^2 through the derivatives at hhi
+            Real* m = meta.dataPtr() + row*WallMobTable::nmeta;
+            m[0] = hlo;
+            m[1] = 1./dh;
+            m[2] = hhi;
+
+            Real vhi[WallMobTable::ncol];
+            law(hhi, sw, spec, vhi);
+            if (hhi > 0.) {
+                Real vmid[WallMobTable::ncol];
+                law(0.5*hhi, sw, spec, vmid);
+                for (int col=0; col<2; ++col) {
+                    const Real c = (vhi[col] - vmid[col])/(1./hhi - 2./hhi);
+                    m[3 + 2*col] = vhi[col] - c/hhi;
+                    m[4 + 2*col] = c;
+                }
+                m[7] = vhi[2]*hhi*hhi;
+                m[8] = vhi[3]*hhi*hhi;
+            }
+            else {
+                m[3] = vhi[0];
+                m[4] = 0.;
+                m[5] = vhi[1];
+                m[6] = 0.;
+                m[7] = 0.;
+                m[8] = 0.;
+            }
+        }
+    }
+
+    wallMobData.resize(data.size());
+    wallMobMeta.resize(meta.size());
+    Gpu::copy(Gpu::hostToDevice, data.begin(), data.end(), wallMobData.begin());
+    Gpu::copy(Gpu::hostToDevice, meta.begin(), meta.end(), wallMobMeta.begin());
+    wallMobSize = nh;
+}
+
 void FhdParticleContainer::MoveIonsCPP(const Real dt, const Real* dxFluid, const Real* dxE, const Geometry geomF,
                                     const std::array<MultiFab, AMREX_SPACEDIM>& umac, const std::array<MultiFab, AMREX_SPACEDIM>& efield,
                                     const std::array<MultiFab, AMREX_SPACEDIM>& RealFaceCoords,
@@ -747,6 +906,10 @@ void FhdParticleContainer::MoveIonsCPP(const Real dt, const Real* dxFluid, const
 
     if((dry_move_tog == 1) || (dry_move_tog == 2))
     {
+        // tabulated wall mobility if BuildWallMobTable was called, otherwise the law is evaluated directly
+        const WallMobTable table = WallMobTableView();
+        const int model = (table.nh > 0) ? wall_mob : 0;
+
         for (MyIBMarIter pti(* this, lev); pti.isValid(); ++pti) {
 
             TileIndex index(pti.index(), pti.LocalTileIndex());
@@ -755,27 +918,21 @@ void FhdParticleContainer::MoveIonsCPP(const Real dt, const Real* dxFluid, const
 	    ParticleType* particles = aos().dataPtr();
             long np = this->GetParticles(lev).at(index).numParticles();
 
-        amrex::ParallelForRNG(np, [=] AMREX_GPU_DEVICE (int i, amrex::RandomEngine const& engine) noexcept
-            //for (int i = 0; i < np; ++ i) 
-	    {
-                ParticleType & part = particles[i];
-                if(part.idata(FHD_intData::pinned) == 0)
-                {
-                        GpuArray<Real, 3> mb;
-                        GpuArray<Real, 3> mbDer;
-                        GpuArray<Real, 3> dry_terms;
-
-                        get_explicit_mobility_gpu(mb, mbDer, part, plo, phi);
-                        
-                        dry_gpu(dt, part,dry_terms, mb, mbDer, engine);
-
-                        for (int d=0; d<AMREX_SPACEDIM; ++d)
-                        {                   
-                            part.rdata(FHD_realData::velx + d) += dry_terms[d];
-                        }
-                }
-
-            });
+            switch (model)
+            {
+                case 1:  dry_move_gpu<1> (particles, np, dt, plo, phi, table); break;
+                case 2:  dry_move_gpu<2> (particles, np, dt, plo, phi, table); break;
+                case 3:  dry_move_gpu<3> (particles, np, dt, plo, phi, table); break;
+                case 4:  dry_move_gpu<4> (particles, np, dt, plo, phi, table); break;
+                case 5:  dry_move_gpu<5> (particles, np, dt, plo, phi, table); break;
+                case 6:  dry_move_gpu<6> (particles, np, dt, plo, phi, table); break;
+                case 7:  dry_move_gpu<7> (particles, np, dt, plo, phi, table); break;
+                case 8:  dry_move_gpu<8> (particles, np, dt, plo, phi, table); break;
+                case 9:  dry_move_gpu<9> (particles, np, dt, plo, phi, table); break;
+                case 10: dry_move_gpu<10>(particles, np, dt, plo, phi, table); break;
+                case 11: dry_move_gpu<11>(particles, np, dt, plo, phi, table); break;
+                default: dry_move_gpu<0> (particles, np, dt, plo, phi, table); break;
+            }
         }
     }
 
@@ -1127,205 +1284,237 @@ void FhdParticleContainer::SpreadIonsGPU(const Real* dxFluid, const Geometry geo
 
 
 
-void FhdParticleContainer::RadialDistribution(long totalParticles, const int step, const species* particleInfo)
-{        
-    const int lev = 0;
-    int bin;
-    double domx, domy, domz, totalDist, temp;
+// partial histograms of the pair statistics per tile on the device (see stats_add)
+#ifdef AMREX_USE_GPU
+static constexpr int stats_partials = 64;
+#else
+static constexpr int stats_partials = 1;
+#endif
 
-    domx = (prob_hi[0] - prob_lo[0]);
-    domy = (prob_hi[1] - prob_lo[1]);
-    domz = (prob_hi[2] - prob_lo[2]);
+// storage for the partial histograms: stats_partials per OpenMP thread
+static void DefinePartialStats(Gpu::DeviceVector<Real>& partial, int nstats)
+{
+    const int nthreads = Gpu::notInLaunchRegion() ? OpenMP::get_max_threads() : 1;
+    partial.resize(nthreads*stats_partials*nstats);
+    partial.assign(partial.size(), 0.);
+}
 
-    Real posx[totalParticles];
-    Real posy[totalParticles];
-    Real posz[totalParticles];
-    int  species[totalParticles];
-    
-    Real charge[totalParticles];
+// the partials of the calling thread
+static Real* PartialStats(Gpu::DeviceVector<Real>& partial, int nstats)
+{
+    const int tid = Gpu::notInLaunchRegion() ? OpenMP::get_thread_num() : 0;
+    return partial.dataPtr() + tid*stats_partials*nstats;
+}
 
-    Print() << "Calculating radial distribution\n";
+// sum of all partials, on the host
+static Vector<Real> CombinePartialStats(const Gpu::DeviceVector<Real>& partial, int nstats)
+{
+    const int ncopy = partial.size()/nstats;
+    const Real* src = partial.dataPtr();
 
-    // collect particle positions onto one processor
-    PullDown(0, posx, -1, totalParticles);
-    Print() << "HERE1\n";
-    PullDown(0, posy, -2, totalParticles);
-        Print() << "HERE2\n";
-    PullDown(0, posz, -3, totalParticles);
-        Print() << "HERE3\n";
-    PullDown(0, charge, 27, totalParticles);
-        Print() << "HERE4\n";
-    PullDownInt(0, species, 4, totalParticles);
-        Print() << "HERE5\n";
-    
-    // outer radial extent
-    totalDist = totalBins*binSize;
+    Gpu::DeviceVector<Real> stats_d(nstats);
+    Real* stats = stats_d.dataPtr();
+    amrex::ParallelFor(nstats, [=] AMREX_GPU_DEVICE (int n) noexcept
+    {
+        Real sum = 0.;
+        for (int c=0; c<ncopy; ++c) {
+            sum += src[c*nstats + n];
+        }
+        stats[n] = sum;
+    });
 
-    // this is the bin "hit count"
-    RealVector radDist   (totalBins, 0.);
-    RealVector radDist_pp(totalBins, 0.);
-    RealVector radDist_pm(totalBins, 0.);
-    RealVector radDist_mm(totalBins, 0.);
+    Vector<Real> stats_h(nstats);
+    Gpu::copy(Gpu::deviceToHost, stats_d.begin(), stats_d.end(), stats_h.begin());
+    return stats_h;
+}
 
-    double nearest[totalParticles*(nspecies+1)];
-    double nn[nspecies*nspecies+1];
+void FhdParticleContainer::FillPairStats()
+{
+    BL_PROFILE_VAR("FillPairStats()",FillPairStats);
 
-    for(int k = 0; k < (nspecies+1)*totalParticles; k++)
-    {
-        nearest[k] = 0;
-    }
+    const int lev = 0;
 
-    for(int k = 0; k < nspecies*nspecies+1; k++)
-    {
-        nn[k] = 0;
-    }
-    
-#ifdef _OPENMP
-#pragma omp parallel
-#endif
-    for (FhdParIter pti(*this, lev); pti.isValid(); ++pti) {
-            
-        const int grid_id = pti.index();
-        const int tile_id = pti.LocalTileIndex();
+    if (!pairStats ||
+        !(pairStats->ParticleBoxArray(lev) == ParticleBoxArray(lev)) ||
+        !(pairStats->ParticleDistributionMap(lev) == ParticleDistributionMap(lev))) {
 
-        auto& particle_tile = GetParticles(lev)[std::make_pair(grid_id,tile_id)];
-        auto& particles = particle_tile.GetArrayOfStructs();
-        const int np = particles.numParticles();   
+        // neighbor cells that cover searchDist
+        const Real* dx = Geom(lev).CellSize();
+        pairStatsCells = 0;
+        for (int d=0; d<AMREX_SPACEDIM; ++d) {
+            pairStatsCells = std::max(pairStatsCells, (int)std::ceil(searchDist/dx[d]));
+        }
 
-        // loop over particles
-        for (int i = 0; i < np; ++i) {
+        pairStats = std::make_unique<PairStatsContainer>(Geom(lev), ParticleDistributionMap(lev),
+                                                         ParticleBoxArray(lev), pairStatsCells);
+    }
 
-            ParticleType & part = particles[i];
+    pairStats->clearParticles();
 
-            int iilo = (part.pos(0)-searchDist <= prob_lo[0]) ? -1 : 0;
-            int iihi = (part.pos(0)+searchDist >= prob_hi[0]) ?  1 : 0;
+    // the ions are already on the right grids and tiles (both containers share the BoxArray and
+    // the tiling parameters), so copy them tile by tile without a Redistribute
+    for (FhdParIter pti(*this, lev); pti.isValid(); ++pti) {
 
-            int jjlo = (part.pos(1)-searchDist <= prob_lo[1]) ? -1 : 0;
-            int jjhi = (part.pos(1)+searchDist >= prob_hi[1]) ?  1 : 0;
+        auto& ptile = pairStats->DefineAndReturnParticleTile(lev, pti.index(), pti.LocalTileIndex());
+        const int np = pti.numParticles();
+        const int old_size = ptile.numParticles();
+        ptile.resize(old_size + np);
 
-            int kklo = (part.pos(2)-searchDist <= prob_lo[2]) ? -1 : 0;
-            int kkhi = (part.pos(2)+searchDist >= prob_hi[2]) ?  1 : 0;
-                
-            double rad, dx, dy, dz;
+        const ParticleType* src = pti.GetArrayOfStructs()().dataPtr();
+        PairStatsContainer::ParticleType* dst = ptile.GetArrayOfStructs()().dataPtr() + old_size;
 
-            int id = part.id() - 1;
-        
-            // loop over other particles
-            for(int j = 0; j < totalParticles; j++) {
-                
-                // assume triply periodic, check the domain and the 8 periodic images
-                for(int ii = iilo; ii <= iihi; ii++) {
-                for(int jj = jjlo; jj <= jjhi; jj++) {
-                for(int kk = kklo; kk <= kkhi; kk++) {
-
-                    // get distance between particles
-                    dx = part.pos(0)-posx[j] - ii*domx;
-                    dy = part.pos(1)-posy[j] - jj*domy;
-                    dz = part.pos(2)-posz[j] - kk*domz;
-
-                    int jSpec = species[j]-1;
-                    rad = sqrt(dx*dx + dy*dy + dz*dz);
-
-                    if((nearest[id*(nspecies+1) + jSpec] == 0 || nearest[id*(nspecies+1) + jSpec] > rad) && rad != 0)
-                    { 
-                        nearest[id*(nspecies +1)+ jSpec] = rad;
-//                        
-                    }
+        amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (int i) noexcept
+        {
+            PairStatsContainer::ParticleType& p = dst[i];
+            p.id()  = src[i].id();
+            p.cpu() = src[i].cpu();
+            for (int d=0; d<AMREX_SPACEDIM; ++d) {
+                p.pos(d) = src[i].pos(d);
+            }
+            p.rdata(0) = src[i].rdata(FHD_realData::q);
+            p.idata(0) = src[i].idata(FHD_intData::species);
+        });
+    }
 
-                    if((nearest[id*(nspecies+1) + nspecies] == 0 || nearest[id*(nspecies+1) + nspecies] > rad) && rad != 0)
-                    { 
-                        nearest[id*(nspecies +1) + nspecies] = rad;
-//                        Print() << "Particle " << i << " species " << jSpec << ", " << nearest[i*nspecies + jSpec] << "\n";
-                    }
+    pairStats->fillNeighbors();
+}
 
-                    // if particles are close enough, increment the bin
-                    if(rad < totalDist && rad > 0.) {
+void FhdParticleContainer::RadialDistribution(long totalParticles, const int step, const species* particleInfo)
+{        
+    BL_PROFILE_VAR("RadialDistribution()",RadialDistribution);
 
-                        bin = (int)amrex::Math::floor(rad/binSize);
-                        radDist[bin]++;
-                            
-                        if (part.rdata(FHD_realData::q) > 0) {
-                            if (charge[j] > 0) {
-                                radDist_pp[bin]++;
-                            }
-                            else if (charge[j] < 0) {
-                                radDist_pm[bin]++;
-                            }
-                        }
-                        else if (part.rdata(FHD_realData::q) < 0) {
-                            if (charge[j] > 0) {
-                                radDist_pm[bin]++;
-                            }
-                            else if (charge[j] < 0) {
-                                radDist_mm[bin]++;
-                            }
-                        }
-                    }
-                }
-                }
-                }                
-            }  // loop over j (total particles)
-        } // loop over i (np; local particles)
-    }
+    const int lev = 0;
 
-    // compute total number density
-    double n0_total = 0.;
-    for (int i=0; i<nspecies; ++i) {
-        n0_total += particleInfo[i].n0;
-    }
-        
-    // collect the hit count
-    ParallelDescriptor::ReduceRealSum(radDist   .dataPtr(),totalBins);
-    ParallelDescriptor::ReduceRealSum(radDist_pp.dataPtr(),totalBins);
-    ParallelDescriptor::ReduceRealSum(radDist_pm.dataPtr(),totalBins);
-    ParallelDescriptor::ReduceRealSum(radDist_mm.dataPtr(),totalBins);
-    ParallelDescriptor::ReduceRealSum(nearest,(nspecies+1)*totalParticles);
+    Print() << "Calculating radial distribution\n";
 
-    int specCount[nspecies];
+    // ions and their neighbors out to searchDist, on the ranks that own them
+    FillPairStats();
 
-    for(int i=0;i<nspecies;i++)
-    {
-        specCount[i] = 0;
-    }
+    // outer radial extent
+    const Real totalDist = totalBins*binSize;
+    const Real rsearch = searchDist;
+    const Real bsize = binSize;
+    const int nbins = totalBins;
+    const int nspec = nspecies;
+
+    // layout of the statistics, all reduced in one go:
+    // bin hit counts of all, ++, +- and -- pairs,
+    // sums of the nearest neighbour distances per species pair and to any species,
+    // number of ions with such a neighbour within searchDist,
+    // number of ions of each species,
+    // bin hit counts of each species pair
+    const int nn_offset = 4*nbins;
+    const int nncount_offset = nn_offset + nspec*nspec + 1;
+    const int count_offset = nncount_offset + nspec*nspec + 1;
+    const int ij_offset = count_offset + nspec;
+    const int nstats = ij_offset + nspec*nspec*nbins;
+
+    Gpu::DeviceVector<Real> partial;
+    DefinePartialStats(partial, nstats);
 
-    for(int i=0;i<totalParticles;i++)
-    {
-        int iSpec = species[i]-1;
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+    for (PairStatsContainer::ParIterType pti(*pairStats, lev); pti.isValid(); ++pti) {
+
+        auto& aos = pti.GetArrayOfStructs();
+        const int np = pti.numParticles();
+        const PairStatsContainer::ParticleType* pstruct = aos().dataPtr();
+        Real* stats = PartialStats(partial, nstats);
 
-        specCount[iSpec]++;
+        // distance from each ion to its nearest neighbour of each species and of any species (0 = none)
+        Gpu::DeviceVector<Real> nearest_d(np*(nspec+1), 0.);
+        Real* nearest = nearest_d.dataPtr();
 
-        for(int j=0;j<nspecies;j++)
+        for_each_stats_pair(aos, np, pti.tilebox(), pairStatsCells, Geom(lev),
+            [=] AMREX_GPU_DEVICE (int i, const PairStatsContainer::ParticleType& p1,
+                                  const PairStatsContainer::ParticleType& p2, const RealVect& dr) noexcept
         {
-            nn[(iSpec)*nspecies + j] = nn[(iSpec)*nspecies + j] + nearest[i*(nspecies+1)+j];
+            const Real rad = std::sqrt(dr.dotProduct(dr));
 
-            //std::cout << (iSpec)*nspecies + j  << ", " << nearest[i*(nspecies+1)+j] << "\n";
+            if (rad == 0. || rad >= rsearch) return;
 
-        }
+            Real* near_i = nearest + i*(nspec+1);
+            const int iSpec = p1.idata(0)-1;
+            const int jSpec = p2.idata(0)-1;
+            if (near_i[jSpec] == 0. || near_i[jSpec] > rad) {
+                near_i[jSpec] = rad;
+            }
+            if (near_i[nspec] == 0. || near_i[nspec] > rad) {
+                near_i[nspec] = rad;
+            }
 
-        nn[nspecies*nspecies] = nn[nspecies*nspecies] + nearest[i*(nspecies+1)+nspecies];
-    }
+            // if particles are close enough, increment the bin
+            if (rad < totalDist) {
 
-    for(int i=0;i<nspecies;i++)
-    {
-        for(int j=0;j<nspecies;j++)
-        {           
+                Real* hist = stats + (i%stats_partials)*nstats;
 
-            if(i==j)
-            {
-                nn[i*nspecies+j] = nn[i*nspecies+j]/(specCount[i]-1);
+                const int bin = (int)amrex::Math::floor(rad/bsize);
+                stats_add(&hist[bin], 1.);
+                stats_add(&hist[ij_offset + (iSpec*nspec + jSpec)*nbins + bin], 1.);
 
-            }else
-            {
-                nn[i*nspecies+j] = nn[i*nspecies+j]/specCount[i];
+                const Real q1 = p1.rdata(0);
+                const Real q2 = p2.rdata(0);
+                if (q1 > 0 && q2 > 0) {
+                    stats_add(&hist[nbins + bin], 1.);
+                }
+                else if ((q1 > 0 && q2 < 0) || (q1 < 0 && q2 > 0)) {
+                    stats_add(&hist[2*nbins + bin], 1.);
+                }
+                else if (q1 < 0 && q2 < 0) {
+                    stats_add(&hist[3*nbins + bin], 1.);
+                }
+            }
+        });
 
+        amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (int i) noexcept
+        {
+            Real* hist = stats + (i%stats_partials)*nstats;
+            const int iSpec = pstruct[i].idata(0)-1;
+            const Real* near_i = nearest + i*(nspec+1);
+            for (int j=0; j<nspec; ++j) {
+                if (near_i[j] > 0.) {
+                    stats_add(&hist[nn_offset + iSpec*nspec + j], near_i[j]);
+                    stats_add(&hist[nncount_offset + iSpec*nspec + j], 1.);
+                }
+            }
+            if (near_i[nspec] > 0.) {
+                stats_add(&hist[nn_offset + nspec*nspec], near_i[nspec]);
+                stats_add(&hist[nncount_offset + nspec*nspec], 1.);
             }
+            stats_add(&hist[count_offset + iSpec], 1.);
+        });
 
-            //Print() << nn[i*nspecies+j] << "\n";
+        Gpu::streamSynchronize();
+    }
 
-        }
+    Vector<Real> stats_h = CombinePartialStats(partial, nstats);
+
+    // collect the hit count, nearest neighbour sums and species counts
+    ParallelDescriptor::ReduceRealSum(stats_h.dataPtr(), nstats);
+
+    // compute total number density
+    double n0_total = 0.;
+    for (int i=0; i<nspecies; ++i) {
+        n0_total += particleInfo[i].n0;
     }
 
-    nn[nspecies*nspecies] = nn[nspecies*nspecies]/(totalParticles - 1);
+    // this is the bin "hit count"
+    RealVector radDist   (stats_h.begin()          , stats_h.begin() +   nbins);
+    RealVector radDist_pp(stats_h.begin() +   nbins, stats_h.begin() + 2*nbins);
+    RealVector radDist_pm(stats_h.begin() + 2*nbins, stats_h.begin() + 3*nbins);
+    RealVector radDist_mm(stats_h.begin() + 3*nbins, stats_h.begin() + 4*nbins);
+
+    Vector<Real> nn(stats_h.begin() + nn_offset, stats_h.begin() + nncount_offset);
+    Vector<Real> nnCount(stats_h.begin() + nncount_offset, stats_h.begin() + count_offset);
+    Vector<Real> specCount(stats_h.begin() + count_offset, stats_h.begin() + ij_offset);
+    RealVector radDist_ij(stats_h.begin() + ij_offset, stats_h.end());
+
+    // mean over the ions that have a neighbour of that species (of any species) within searchDist
+    for(int i=0;i<nspecies*nspecies+1;i++)
+    {
+        nn[i] = (nnCount[i] > 0.) ? nn[i]/nnCount[i] : 0.;
+    }
 
     //Print() << nn[nspecies*nspecies+1] << "\n";
         
@@ -1338,6 +1527,16 @@ void FhdParticleContainer::RadialDistribution(long totalParticles, const int ste
         radDist_mm[i] *= 1./(n0_total*binVolRadial[i]*(double)totalParticles);
     }
 
+    // g_ij normalized by 1 / (number density of j * bin volume * count of i)
+    for(int i=0;i<nspecies;i++) {
+        for(int j=0;j<nspecies;j++) {
+            for(int b=0;b<totalBins;b++) {
+                Real norm = particleInfo[j].n0*binVolRadial[b]*specCount[i];
+                radDist_ij[(i*nspecies+j)*totalBins+b] *= (norm > 0.) ? 1./norm : 0.;
+            }
+        }
+    }
+
     // increment number of snapshots
     radialStatsCount++;
     int stepsminusone = radialStatsCount - 1;
@@ -1351,6 +1550,11 @@ void FhdParticleContainer::RadialDistribution(long totalParticles, const int ste
         meanRadialDistribution_mm[i] = (meanRadialDistribution_mm[i]*stepsminusone + radDist_mm[i])*stepsinv;
     }
 
+    meanRadialDistribution_ij.resize(radDist_ij.size(), 0.);
+    for(int i=0;i<(int)radDist_ij.size();i++) {
+        meanRadialDistribution_ij[i] = (meanRadialDistribution_ij[i]*stepsminusone + radDist_ij[i])*stepsinv;
+    }
+
     for(int i=0;i<(nspecies*nspecies + 1);i++) {
 
     //Print() << i << ", " << nn[i]<< "\n";
@@ -1375,6 +1579,19 @@ void FhdParticleContainer::RadialDistribution(long totalParticles, const int ste
                     << meanRadialDistribution_mm[i] << std::endl;
             }
             ofs.close();
+
+            // species resolved g_ij(r), one column per species pair (i,j) with j fastest
+            std::string filename_ij = Concatenate("radialDistributionSpecies",step,9);
+            std::ofstream ofs_ij(filename_ij, std::ofstream::out);
+
+            for(int b=0;b<totalBins;b++) {
+                ofs_ij << (b+0.5)*binSize;
+                for(int ij=0;ij<nspecies*nspecies;ij++) {
+                    ofs_ij << " " << meanRadialDistribution_ij[ij*totalBins+b];
+                }
+                ofs_ij << std::endl;
+            }
+            ofs_ij.close();
         }
     }
 
@@ -1411,6 +1628,8 @@ void FhdParticleContainer::RadialDistribution(long totalParticles, const int ste
             meanRadialDistribution_mm[i] = 0;
         }
 
+        std::fill(meanRadialDistribution_ij.begin(), meanRadialDistribution_ij.end(), 0.);
+
         for(int i=0;i<nspecies*nspecies;i++) {
             nearestN[i] = 0;
         }
@@ -1419,44 +1638,38 @@ void FhdParticleContainer::RadialDistribution(long totalParticles, const int ste
 
 void FhdParticleContainer::potentialDistribution(long totalParticles, const int step, const species* particleInfo)
 {        
+    BL_PROFILE_VAR("potentialDistribution()",potentialDistribution);
+
     const int lev = 0;
-    int bin;
-    Real totalDist;
     
     Print() << "Calculating potential distribution\n";
 
-    // outer radial extent
-    totalDist = totalBins*binSize;
+    const Real bsize = binSize;
+    const int nbins = totalBins;
 
     // this is the bin "hit count"
-    RealVector radDist   (totalBins, 0.);
-    
+    Gpu::DeviceVector<Real> partial;
+    DefinePartialStats(partial, nbins);
+
 #ifdef _OPENMP
-#pragma omp parallel
+#pragma omp parallel if (Gpu::notInLaunchRegion())
 #endif
     for (FhdParIter pti(*this, lev); pti.isValid(); ++pti) {
-            
-        const int grid_id = pti.index();
-        const int tile_id = pti.LocalTileIndex();
-
-        auto& particle_tile = GetParticles(lev)[std::make_pair(grid_id,tile_id)];
-        auto& particles = particle_tile.GetArrayOfStructs();
-        const int np = particles.numParticles();   
-
-        // loop over particles
-        for (int i = 0; i < np; ++i) {
-
-            ParticleType & part = particles[i];
 
-            Real potential = part.rdata(FHD_realData::potential);
+        const int np = pti.numParticles();
+        const ParticleType* pstruct = pti.GetArrayOfStructs()().dataPtr();
+        Real* stats = PartialStats(partial, nbins);
 
-            int bin = (int)floor(potential/binSize);
-            if(bin < totalBins)
-            {
-                radDist[bin]++;
+        amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (int i) noexcept
+        {
+            const int bin = (int)amrex::Math::floor(pstruct[i].rdata(FHD_realData::potential)/bsize);
+            if (bin >= 0 && bin < nbins) {
+                stats_add(&stats[(i%stats_partials)*nbins + bin], 1.);
             }
-        } // loop over i (np; local particles)
+        });
     }
+
+    Vector<Real> radDist = CombinePartialStats(partial, nbins);
         
     // collect the hit count
     ParallelDescriptor::ReduceRealSum(radDist   .dataPtr(),totalBins);
@@ -1511,185 +1724,90 @@ void FhdParticleContainer::CartesianDistribution(long totalParticles, const int
     BL_PROFILE_VAR("CartesianDistribution()",CartesianDistribution);
     
     const int lev = 0;
-    int bin;
-    double domx, domy, domz, totalDist, temp;
-
-    domx = (prob_hi[0] - prob_lo[0]);
-    domy = (prob_hi[1] - prob_lo[1]);
-    domz = (prob_hi[2] - prob_lo[2]);
-
-    Real posx[totalParticles];
-    Real posy[totalParticles];
-    Real posz[totalParticles];
-    
-    Real charge[totalParticles];
 
     Print() << "Calculating Cartesian distribution\n";
 
-    // collect particle positions onto one processor
-    PullDown(0, posx, -1, totalParticles);
-    PullDown(0, posy, -2, totalParticles);
-    PullDown(0, posz, -3, totalParticles);
-    PullDown(0, charge, 27, totalParticles);
+    // ions and their neighbors out to searchDist, on the ranks that own them
+    FillPairStats();
 
     // outer extent
-    totalDist = totalBins*binSize;
+    const Real totalDist = totalBins*binSize;
+    const Real rsearch = searchDist;
+    const Real bsize = binSize;
+    const int nbins = totalBins;
 
-    // this is the bin "hit count"
-    RealVector XDist   (totalBins, 0.);
-    RealVector XDist_pp(totalBins, 0.);
-    RealVector XDist_pm(totalBins, 0.);
-    RealVector XDist_mm(totalBins, 0.);
-    RealVector YDist   (totalBins, 0.);
-    RealVector YDist_pp(totalBins, 0.);
-    RealVector YDist_pm(totalBins, 0.);
-    RealVector YDist_mm(totalBins, 0.);
-    RealVector ZDist   (totalBins, 0.);
-    RealVector ZDist_pp(totalBins, 0.);
-    RealVector ZDist_pm(totalBins, 0.);
-    RealVector ZDist_mm(totalBins, 0.);
+    // bin hit counts of all, ++, +- and -- pairs for the x, y and z separations,
+    // at [(4*dir + kind)*totalBins + bin], all reduced in one go
+    const int nstats = 12*nbins;
+    Gpu::DeviceVector<Real> partial;
+    DefinePartialStats(partial, nstats);
 
 #ifdef _OPENMP
-#pragma omp parallel
+#pragma omp parallel if (Gpu::notInLaunchRegion())
 #endif
-    for (FhdParIter pti(*this, lev); pti.isValid(); ++pti) {
-            
-        const int grid_id = pti.index();
-        const int tile_id = pti.LocalTileIndex();
+    for (PairStatsContainer::ParIterType pti(*pairStats, lev); pti.isValid(); ++pti) {
 
-        auto& particle_tile = GetParticles(lev)[std::make_pair(grid_id,tile_id)];
-        auto& particles = particle_tile.GetArrayOfStructs();
-        const int np = particles.numParticles();
-        
-        // loop over particles
-        for (int i = 0; i < np; ++i) {
-            
-            ParticleType & part = particles[i];
+        Real* stats = PartialStats(partial, nstats);
 
-            int iilo = (part.pos(0)-searchDist <= prob_lo[0]) ? -1 : 0;
-            int iihi = (part.pos(0)+searchDist >= prob_hi[0]) ?  1 : 0;
+        for_each_stats_pair(pti.GetArrayOfStructs(), pti.numParticles(), pti.tilebox(), pairStatsCells, Geom(lev),
+            [=] AMREX_GPU_DEVICE (int i, const PairStatsContainer::ParticleType& p1,
+                                  const PairStatsContainer::ParticleType& p2, const RealVect& dr) noexcept
+        {
+            if (dr.dotProduct(dr) == 0.) return;
 
-            int jjlo = (part.pos(1)-searchDist <= prob_lo[1]) ? -1 : 0;
-            int jjhi = (part.pos(1)+searchDist >= prob_hi[1]) ?  1 : 0;
+            const Real dist[3] = {amrex::Math::abs(dr[0]), amrex::Math::abs(dr[1]), amrex::Math::abs(dr[2])};
 
-            int kklo = (part.pos(2)-searchDist <= prob_lo[2]) ? -1 : 0;
-            int kkhi = (part.pos(2)+searchDist >= prob_hi[2]) ?  1 : 0;
-            
-            double dist, dx, dy, dz;
-            // loop over other particles
-            for(int j = 0; j < totalParticles; j++)
-            {
-                // assume triply periodic, check the domain and the 8 periodic images
-                for(int ii = iilo; ii <= iihi; ii++)
-                {
-                for(int jj = jjlo; jj <= jjhi; jj++)
-                {
-                for(int kk = kklo; kk <= kkhi; kk++)
-                {
-                    // get distance between particles
-                    dx = amrex::Math::abs(part.pos(0)-posx[j] - ii*domx);
-                    dy = amrex::Math::abs(part.pos(1)-posy[j] - jj*domy);
-                    dz = amrex::Math::abs(part.pos(2)-posz[j] - kk*domz);
-
-                    dist = sqrt(dx*dx + dy*dy + dz*dz);
-
-                    // if particles are close enough, increment the bin
-                    if (dist > 0.) {
-                        if(dx < totalDist && dy < searchDist && dz < searchDist) {
-                            
-                            bin = (int)amrex::Math::floor(dx/binSize);
-                            XDist[bin]++;
-                            
-                            if (part.rdata(FHD_realData::q) > 0) {
-                                if (charge[j] > 0) {
-                                    XDist_pp[bin]++;
-                                }
-                                else if (charge[j] < 0) {
-                                    XDist_pm[bin]++;
-                                }
-                            }
-                            else if (part.rdata(FHD_realData::q) < 0) {
-                                if (charge[j] > 0) {
-                                    XDist_pm[bin]++;
-                                }
-                                else if (charge[j] < 0) {
-                                    XDist_mm[bin]++;
-                                }
-                            }
-                            
-                        }
-                        if(dy < totalDist && dx < searchDist && dz < searchDist) {
-                            
-                            bin = (int)amrex::Math::floor(dy/binSize);
-                            YDist[bin]++;
-                            
-                            if (part.rdata(FHD_realData::q) > 0) {
-                                if (charge[j] > 0) {
-                                    YDist_pp[bin]++;
-                                }
-                                else if (charge[j] < 0) {
-                                    YDist_pm[bin]++;
-                                }
-                            }
-                            else if (part.rdata(FHD_realData::q) < 0) {
-                                if (charge[j] > 0) {
-                                    YDist_pm[bin]++;
-                                }
-                                else if (charge[j] < 0) {
-                                    YDist_mm[bin]++;
-                                }
-                            }
-                            
-                        }
-                        if(dz < totalDist && dx < searchDist && dy < searchDist) {
-                            
-                            bin = (int)amrex::Math::floor(dz/binSize);                            
-                            ZDist[bin]++;
-                            
-                            if (part.rdata(FHD_realData::q) > 0) {
-                                if (charge[j] > 0) {
-                                    ZDist_pp[bin]++;
-                                }
-                                else if (charge[j] < 0) {
-                                    ZDist_pm[bin]++;
-                                }
-                            }
-                            else if (part.rdata(FHD_realData::q) < 0) {
-                                if (charge[j] > 0) {
-                                    ZDist_pm[bin]++;
-                                }
-                                else if (charge[j] < 0) {
-                                    ZDist_mm[bin]++;
-                                }
-                            }
-                        }
+            const Real q1 = p1.rdata(0);
+            const Real q2 = p2.rdata(0);
+            int kind = 0;
+            if (q1 > 0 && q2 > 0) {
+                kind = 1;
+            }
+            else if ((q1 > 0 && q2 < 0) || (q1 < 0 && q2 > 0)) {
+                kind = 2;
+            }
+            else if (q1 < 0 && q2 < 0) {
+                kind = 3;
+            }
+
+            // if particles are close enough, increment the bin
+            Real* hist = stats + (i%stats_partials)*nstats;
+            for (int d=0; d<3; ++d) {
+                if (dist[d] < totalDist && dist[(d+1)%3] < rsearch && dist[(d+2)%3] < rsearch) {
+                    const int bin = (int)amrex::Math::floor(dist[d]/bsize);
+                    stats_add(&hist[4*d*nbins + bin], 1.);
+                    if (kind > 0) {
+                        stats_add(&hist[(4*d + kind)*nbins + bin], 1.);
                     }
                 }
-                }
-                }                
             }
-        }
+        });
     }
 
+    Vector<Real> stats_h = CombinePartialStats(partial, nstats);
+
+    // collect the hit count
+    ParallelDescriptor::ReduceRealSum(stats_h.dataPtr(), nstats);
+
     // compute total number density
     double n0_total = 0.;
     for (int i=0; i<nspecies; ++i) {
         n0_total += particleInfo[i].n0;
     }
- 
-    // collect the hit count
-    ParallelDescriptor::ReduceRealSum(XDist   .dataPtr(),totalBins);
-    ParallelDescriptor::ReduceRealSum(XDist_pp.dataPtr(),totalBins);
-    ParallelDescriptor::ReduceRealSum(XDist_pm.dataPtr(),totalBins);
-    ParallelDescriptor::ReduceRealSum(XDist_mm.dataPtr(),totalBins);
-    ParallelDescriptor::ReduceRealSum(YDist   .dataPtr(),totalBins);
-    ParallelDescriptor::ReduceRealSum(YDist_pp.dataPtr(),totalBins);
-    ParallelDescriptor::ReduceRealSum(YDist_pm.dataPtr(),totalBins);
-    ParallelDescriptor::ReduceRealSum(YDist_mm.dataPtr(),totalBins);
-    ParallelDescriptor::ReduceRealSum(ZDist   .dataPtr(),totalBins);
-    ParallelDescriptor::ReduceRealSum(ZDist_pp.dataPtr(),totalBins);
-    ParallelDescriptor::ReduceRealSum(ZDist_pm.dataPtr(),totalBins);
-    ParallelDescriptor::ReduceRealSum(ZDist_mm.dataPtr(),totalBins);
+
+    // this is the bin "hit count"
+    RealVector XDist   (stats_h.begin()           , stats_h.begin() +  1*nbins);
+    RealVector XDist_pp(stats_h.begin() +  1*nbins, stats_h.begin() +  2*nbins);
+    RealVector XDist_pm(stats_h.begin() +  2*nbins, stats_h.begin() +  3*nbins);
+    RealVector XDist_mm(stats_h.begin() +  3*nbins, stats_h.begin() +  4*nbins);
+    RealVector YDist   (stats_h.begin() +  4*nbins, stats_h.begin() +  5*nbins);
+    RealVector YDist_pp(stats_h.begin() +  5*nbins, stats_h.begin() +  6*nbins);
+    RealVector YDist_pm(stats_h.begin() +  6*nbins, stats_h.begin() +  7*nbins);
+    RealVector YDist_mm(stats_h.begin() +  7*nbins, stats_h.begin() +  8*nbins);
+    RealVector ZDist   (stats_h.begin() +  8*nbins, stats_h.begin() +  9*nbins);
+    RealVector ZDist_pp(stats_h.begin() +  9*nbins, stats_h.begin() + 10*nbins);
+    RealVector ZDist_pm(stats_h.begin() + 10*nbins, stats_h.begin() + 11*nbins);
+    RealVector ZDist_mm(stats_h.begin() + 11*nbins, stats_h.begin() + 12*nbins);
 
     // normalize by 1 / (number density * bin volume * total particle count)
     for(int i=0;i<totalBins;i++) {
@@ -1835,39 +1953,28 @@ void FhdParticleContainer::EvaluateStats(MultiFab& particleInstant,
     BL_PROFILE_VAR("EvaluateStats()",EvaluateStats);
     
     const int lev = 0;
-    const double Neff = particleInfo.Neff;
-    const double n0 = particleInfo.n0;
-    const double T0 = particleInfo.T;
-
-    double tp = 0;
-    double te = 0;
-    double tm = 0;
-
-    double totalMass;
 
-    Gpu::DeviceVector<Real> avcurrent_tile (3);
-
-//    GpuArray<int, 3> avcurrent_tile = {0,0,0};
-    RealVector avcurrent_proc(3);
-
-    std::fill(avcurrent_proc.begin(), avcurrent_proc.end(), 0.);
-    std::fill(avcurrent_tile.begin(), avcurrent_tile.end(), 0.);
-
-    Real* avc_tile = avcurrent_tile.dataPtr();
-    
     BoxArray ba = particleMeans.boxArray();
     long cellcount = ba.numPts();
 
     const Real* dx = Geom(lev).CellSize();
-    const Real dxInv = 1.0/dx[0];
-    const Real cellVolInv = 1.0/(dx[0]*dx[0]*dx[0]);
+    const GpuArray<Real, 3> dxInv = {1.0/dx[0], 1.0/dx[1], 1.0/dx[2]};
+    const GpuArray<Real, 3> plo = Geom(lev).ProbLoArray();
+    const Real cellVolInv = 1.0/(dx[0]*dx[1]*dx[2]);
 
     const Real stepsInv = 1.0/steps;
     const int stepsMinusOne = steps-1;
+    const int nspec = nspecies;
 
-    // zero instantaneous values
-    particleInstant.setVal(0.);
-    
+    // sum of the mean current density over the cells
+    ReduceOps<ReduceOpSum, ReduceOpSum, ReduceOpSum> reduce_op;
+    ReduceData<Real, Real, Real> reduce_data(reduce_op);
+    using ReduceTuple = typename decltype(reduce_data)::Type;
+
+    // every component of every cell of particleInstant is written below, so it is not zeroed first
+#ifdef _OPENMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
     for (FhdParIter pti(*this, lev); pti.isValid(); ++pti) 
     {
 
@@ -1879,90 +1986,92 @@ void FhdParticleContainer::EvaluateStats(MultiFab& particleInstant,
         const Box& tile_box  = pti.tilebox();
 	    ParticleType* particles = aos().dataPtr();
 
-        tp = tp + np;
-
-        GpuArray<int, 3> bx_lo = {tile_box.loVect()[0], tile_box.loVect()[1], tile_box.loVect()[2]};
-        GpuArray<int, 3> bx_hi = {tile_box.hiVect()[0], tile_box.hiVect()[1], tile_box.hiVect()[2]};
-
-//        Array4<Real> part_inst = (&particleInstant[pti])->array();
+        const Dim3 lo = amrex::lbound(tile_box);
+        const Dim3 hi = amrex::ubound(tile_box);
+        const int nx = hi.x - lo.x + 1;
+        const int ny = hi.y - lo.y + 1;
+        const int ncell = tile_box.numPts();
 
         Array4<Real> part_inst = particleInstant[pti].array();
         Array4<Real> part_mean = particleMeans[pti].array();
 
-        //const Array4<Real>& data = charge.array(mfi);
-		  // Updates multfab
-        AMREX_FOR_1D( np, ni,
-        {
-            ParticleType & part = particles[ni];
-
-            int i = floor(part.pos(0)*dxInv);
-            int j = floor(part.pos(1)*dxInv);
-            int k = floor(part.pos(2)*dxInv);
-            
-            amrex::Gpu::Atomic::Add(&part_inst(i,j,k,0), 1.0);
-            amrex::Gpu::Atomic::Add(&part_inst(i,j,k,1), part.rdata(FHD_realData::mass));
-
-            amrex::Gpu::Atomic::Add(&part_inst(i,j,k,2), part.rdata(FHD_realData::velx));
-            amrex::Gpu::Atomic::Add(&part_inst(i,j,k,3), part.rdata(FHD_realData::vely));
-            amrex::Gpu::Atomic::Add(&part_inst(i,j,k,4), part.rdata(FHD_realData::velz));
-
-            amrex::Gpu::Atomic::Add(&part_inst(i,j,k,5), part.rdata(FHD_realData::velx)*part.rdata(FHD_realData::q));
-            amrex::Gpu::Atomic::Add(&part_inst(i,j,k,6), part.rdata(FHD_realData::vely)*part.rdata(FHD_realData::q));
-            amrex::Gpu::Atomic::Add(&part_inst(i,j,k,7), part.rdata(FHD_realData::velz)*part.rdata(FHD_realData::q));
-
-            amrex::Gpu::Atomic::Add(&part_inst(i,j,k,7+part.idata(FHD_intData::species)), part.rdata(FHD_realData::q));
-
-        });
-
-        amrex::ParallelFor(tile_box,[=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        // group the particles by cell; particles outside the tile go to the extra bin ncell and are skipped
+        DenseBins<ParticleType> bins;
+        bins.build(np, particles, ncell+1,
+                   [=] AMREX_GPU_HOST_DEVICE (const ParticleType& part) noexcept -> unsigned int
+                   {
+                       int i = (int)amrex::Math::floor((part.pos(0)-plo[0])*dxInv[0]);
+                       int j = (int)amrex::Math::floor((part.pos(1)-plo[1])*dxInv[1]);
+                       int k = (int)amrex::Math::floor((part.pos(2)-plo[2])*dxInv[2]);
+                       if (i < lo.x || i > hi.x || j < lo.y || j > hi.y || k < lo.z || k > hi.z) {
+                           return ncell;
+                       }
+                       return (i-lo.x) + nx*((j-lo.y) + ny*(k-lo.z));
+                   });
+
+        const auto offsets = bins.offsetsPtr();
+        const auto perm = bins.permutationPtr();
+
+        // sum over the particles of each cell, normalize and update the means in one pass
+        reduce_op.eval(tile_box, reduce_data,
+        [=] AMREX_GPU_DEVICE (int i, int j, int k) -> ReduceTuple
         {
-            Real membersInv = 1.0/part_inst(i,j,k,0);
+            const int b = (i-lo.x) + nx*((j-lo.y) + ny*(k-lo.z));
+
+            Real members = 0.;
+            Real mass = 0.;
+            Real vel[3] = {0., 0., 0.};
+            Real cur[3] = {0., 0., 0.};
+            Real qspec[MAX_SPECIES];
+            for(int l=0;l<nspec;l++)
+            {
+                qspec[l] = 0.;
+            }
 
-            part_inst(i,j,k,1) = part_inst(i,j,k,1)*cellVolInv;
+            for (auto n = offsets[b]; n < offsets[b+1]; ++n)
+            {
+                const ParticleType & part = particles[perm[n]];
+                const Real q = part.rdata(FHD_realData::q);
 
-            part_inst(i,j,k,2) = part_inst(i,j,k,2)*membersInv;
-            part_inst(i,j,k,3) = part_inst(i,j,k,3)*membersInv;
-            part_inst(i,j,k,4) = part_inst(i,j,k,4)*membersInv;
+                members += 1.0;
+                mass += part.rdata(FHD_realData::mass);
+                for (int d=0; d<3; ++d)
+                {
+                    vel[d] += part.rdata(FHD_realData::velx + d);
+                    cur[d] += part.rdata(FHD_realData::velx + d)*q;
+                }
+                qspec[part.idata(FHD_intData::species)-1] += q;
+            }
 
-            part_inst(i,j,k,5) = part_inst(i,j,k,5)*cellVolInv;
-            part_inst(i,j,k,6) = part_inst(i,j,k,6)*cellVolInv;
-            part_inst(i,j,k,7) = part_inst(i,j,k,7)*cellVolInv;
+            const Real membersInv = (members > 0.) ? 1.0/members : 0.;
 
-            for(int l=0;l<nspecies;l++)
+            part_inst(i,j,k,0) = members;
+            part_inst(i,j,k,1) = mass*cellVolInv;
+            for (int d=0; d<3; ++d)
             {
-                part_inst(i,j,k,8 + l) = part_inst(i,j,k,8 + l)*cellVolInv;
-            }          
-             
-        });
-
-        amrex::ParallelFor(tile_box,[=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
-        {
-
-            part_mean(i,j,k,1)  = (part_mean(i,j,k,1)*stepsMinusOne + part_inst(i,j,k,1))*stepsInv;
-            part_mean(i,j,k,2)  = (part_mean(i,j,k,2)*stepsMinusOne + part_inst(i,j,k,2))*stepsInv;
-            part_mean(i,j,k,3)  = (part_mean(i,j,k,3)*stepsMinusOne + part_inst(i,j,k,3))*stepsInv;
-            part_mean(i,j,k,4)  = (part_mean(i,j,k,4)*stepsMinusOne + part_inst(i,j,k,4))*stepsInv;
-            part_mean(i,j,k,5)  = (part_mean(i,j,k,5)*stepsMinusOne + part_inst(i,j,k,5))*stepsInv;
-            part_mean(i,j,k,6)  = (part_mean(i,j,k,6)*stepsMinusOne + part_inst(i,j,k,6))*stepsInv;
-            part_mean(i,j,k,7)  = (part_mean(i,j,k,7)*stepsMinusOne + part_inst(i,j,k,7))*stepsInv;
+                part_inst(i,j,k,2 + d) = vel[d]*membersInv;
+                part_inst(i,j,k,5 + d) = cur[d]*cellVolInv;
+            }
+            for(int l=0;l<nspec;l++)
+            {
+                part_inst(i,j,k,8 + l) = qspec[l]*cellVolInv;
+            }
 
-            for(int l=0;l<nspecies;l++)
+            for(int l=1;l<8+nspec;l++)
             {
-                part_mean(i,j,k,8 + l)  = (part_mean(i,j,k,8 + l)*stepsMinusOne + part_inst(i,j,k,8 + l))*stepsInv;
+                part_mean(i,j,k,l) = (part_mean(i,j,k,l)*stepsMinusOne + part_inst(i,j,k,l))*stepsInv;
             }
-            
-            avc_tile[0] = avc_tile[0] + part_mean(i,j,k,5);           
-            avc_tile[1] = avc_tile[1] + part_mean(i,j,k,6);
-            avc_tile[2] = avc_tile[2] + part_mean(i,j,k,7);
-             
-        });
 
-        for (int i=0; i<3; ++i) {
-            avcurrent_proc[i] += avcurrent_tile[i];
-        }
+            return {part_mean(i,j,k,5), part_mean(i,j,k,6), part_mean(i,j,k,7)};
+        });
 
+        // the bins go out of scope
+        Gpu::streamSynchronize();
     }
-    
+
+    ReduceTuple hv = reduce_data.value();
+    RealVector avcurrent_proc = {amrex::get<0>(hv), amrex::get<1>(hv), amrex::get<2>(hv)};
+
     // gather statistics
     ParallelDescriptor::ReduceRealSum(avcurrent_proc.dataPtr(),3);
 
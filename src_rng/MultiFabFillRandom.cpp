@@ -2,11 +2,70 @@
 
 #include "rng_functions.H"
 
+#include <chrono>
+
+// key of the counter-based generator
+// every rank calls MultiFabFillRandom in the same order, so the stream counter agrees
+// across ranks without communication and each call gets its own stream
+static bool          rng_field_key_set = false;
+static std::uint32_t rng_field_seed    = 0;
+static std::uint32_t rng_field_stream  = 0;
+
+// seed of the counter-based generator; with seed=0 a clock-based value is shared by all ranks
+// with seed<0 (restart) the seed must have been restored from the checkpoint with SetRandomFieldSeed
+static std::uint32_t RandomFieldSeed ()
+{
+    if (!rng_field_key_set) {
+        if (seed > 0) {
+            rng_field_seed = seed;
+        } else if (seed < 0) {
+            Abort("RandomFieldSeed: seed < 0 with rng_field_type >= 1 needs a checkpoint that stores the random field seed");
+        } else {
+            long clock_seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+            ParallelDescriptor::Bcast(&clock_seed, 1, ParallelDescriptor::IOProcessorNumber());
+            rng_field_seed = std::uint32_t(clock_seed) ^ std::uint32_t(clock_seed >> 32);
+        }
+        rng_field_key_set = true;
+    }
+    return rng_field_seed;
+}
+
+unsigned int GetRandomFieldStream ()
+{
+    return rng_field_stream;
+}
+
+void SetRandomFieldStream (const unsigned int& stream)
+{
+    rng_field_stream = stream;
+}
+
+unsigned int NextRandomFieldStream ()
+{
+    return rng_field_stream++;
+}
+
+unsigned int GetRandomFieldSeed ()
+{
+    return RandomFieldSeed();
+}
+
+void SetRandomFieldSeed (const unsigned int& field_seed)
+{
+    rng_field_seed = field_seed;
+    rng_field_key_set = true;
+}
+
 void MultiFabFillRandom(MultiFab& mf, const int& comp, const amrex::Real& variance,
                         const Geometry& geom, const int& ng)
 {
     BL_PROFILE_VAR("MultiFabFillRandom()",MultiFabFillRandom);
 
+    if (rng_field_type >= 1) {
+        MultiFabFillRandomCounter(mf, comp, variance, geom, ng);
+        return;
+    }
+
     for (MFIter mfi(mf); mfi.isValid(); ++mfi) {
         const Box& bx = (ng==0) ? mfi.validbox() : mfi.growntilebox(ng);
         const Array4<Real>& mf_fab = mf.array(mfi);
@@ -29,3 +88,65 @@ void MultiFabFillRandom(MultiFab& mf, const int& comp, const amrex::Real& varian
 
 //----------------------------------------
 }
+
+// same as MultiFabFillRandom, but the variate of each point only depends on the seed, the
+// number of previous fills, the component, and the global index of the point
+// faces/nodes shared by two boxes therefore agree, and periodic images are found by wrapping
+// the index, so all ghost cells that FillBoundary would fill are filled directly
+// the result is independent of the number of ranks, the box layout and the tiling
+void MultiFabFillRandomCounter(MultiFab& mf, const int& comp, const amrex::Real& variance,
+                               const Geometry& geom, const int& ng)
+{
+    BL_PROFILE_VAR("MultiFabFillRandomCounter()",MultiFabFillRandomCounter);
+
+    MultiFabFillRandomField(mf, comp, variance, MakeRandomField(geom), geom, ng);
+}
+
+RandomField MakeRandomField(const Geometry& geom)
+{
+    RandomField field;
+    field.key0 = RandomFieldSeed();
+    field.key1 = NextRandomFieldStream();
+
+    const Box domain = geom.Domain();
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        field.dom_lo[d] = domain.smallEnd(d);
+        field.period[d] = geom.isPeriodic(d) ? domain.length(d) : 0;
+    }
+    return field;
+}
+
+StochNoise MakeStochNoise(const Geometry& geom)
+{
+    StochNoise noise;
+    noise.in_kernel = 1;
+    noise.A = MakeRandomField(geom);
+    noise.B = MakeRandomField(geom);
+    for (int n=0; n<MAX_SPECIES+5; ++n) {
+        noise.scale[n] = 1.;
+    }
+    return noise;
+}
+
+// store the variates of a counter-based stream in component comp of mf
+void MultiFabFillRandomField(MultiFab& mf, const int& comp, const amrex::Real& variance,
+                             const RandomField& field, const Geometry& geom, const int& ng)
+{
+    const Real stddev = std::sqrt(variance);
+
+    // points to fill: the domain (in the index space of mf), ng ghost cells outside of it,
+    // and all ghost cells across periodic boundaries
+    Box fill_region = amrex::convert(geom.Domain(), mf.ixType());
+    for (int d=0; d<AMREX_SPACEDIM; ++d) {
+        fill_region.grow(d, geom.isPeriodic(d) ? std::max(ng, mf.nGrow(d)) : ng);
+    }
+
+    for (MFIter mfi(mf,TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+        const Box& bx = mfi.growntilebox() & fill_region;
+        const Array4<Real>& mf_fab = mf.array(mfi);
+        amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        {
+            mf_fab(i,j,k,comp) = stddev*field(i,j,k,comp);
+        });
+    }
+}